@@ -0,0 +1,411 @@
+/*
+    AnbUI Miniature Text UI Lib for Burger Enjoyers(tm)
+
+    ad_async: Optional render thread
+
+    ad_present hands finished frames to a render thread, which compares
+    them against the screen and talks to the HAL. A slow console (serial
+    line, congested SSH...) then only holds up the render thread and not
+    the application.
+
+    Commands go through a bounded single-producer / single-consumer ring.
+    With AD_ASYNC_DROP_FRAMES, frames skip the ring and go through a
+    triple buffer instead, where a newer frame simply replaces one that
+    hasn't been picked up yet, so ad_present never has to wait.
+
+    The mutex and condition variables are only there to let a thread
+    sleep while there is nothing to do, the queue itself is lock-free.
+
+    Each context has its own render thread, which works with that
+    context as its current one.
+
+    Tip of the day: Two cooks, one grill. One flips, one serves.
+    Never let the one serving flip the burger.
+
+    (C) 2026 E. Voirin (oerg866) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "anbui.h"
+#include "ad_priv.h"
+#include "ad_hal.h"
+#include "ad_thrd.h"
+
+#if defined(AD_HAL_HAS_THREADS) && defined(AD_HAS_ATOMICS)
+
+typedef enum {
+    AD_ASYNC_CMD_FRAME = 0,
+    AD_ASYNC_CMD_RESTORE_CONSOLE,
+    AD_ASYNC_CMD_STOP
+} ad_AsyncCommandType;
+
+typedef struct {
+    ad_AsyncCommandType type;
+    ad_Char            *cells;          /* Frame contents, each ring slot has its own buffer */
+} ad_AsyncCommand;
+
+/* Set in the mailbox while the frame in it hasn't been picked up yet */
+#define AD_ASYNC_FRESH 0x80000000UL
+
+typedef struct ad_AsyncState {
+    bool                running;
+    ad_AsyncPolicy      policy;
+    ad_Hal             *hal;
+    size_t              frameSize;
+    ad_Char            *front;          /* What the render thread has put on the screen */
+
+    ad_AsyncCommand    *ring;
+    ad_Char            *ringCells;
+    uint32_t            ringSize;       /* Power of two, so the indices can wrap around */
+    ad_AtomicU32        head;           /* Next slot to be written, only moved by the producer */
+    ad_AtomicU32        tail;           /* Next slot to be read, only moved by the render thread */
+
+    ad_Char            *frames[3];      /* Triple buffer for AD_ASYNC_DROP_FRAMES */
+    uint32_t            producerFrame;
+    uint32_t            consumerFrame;
+    bool                consumerHasFrame;
+    ad_AtomicU32        mailbox;        /* Index of the frame in the middle + AD_ASYNC_FRESH */
+
+    ad_AsyncStats       stats;          /* Producer side */
+    ad_AtomicU32        framesRendered;
+
+    ad_Thread           thread;
+    ad_Mutex            lock;
+    ad_Cond             workAvailable;
+    ad_Cond             spaceAvailable;
+} ad_AsyncState;
+
+/* The render thread state of the current context, allocated by ad_asyncStart */
+#define s_async (*ad_s_ctx->async)
+
+static bool ad_asyncIsRunning(void) {
+    return ad_s_ctx->async != NULL && s_async.running;
+}
+
+static void ad_asyncSignal(ad_Cond *cond) {
+    ad_mutexLock(&s_async.lock);
+    ad_condSignal(cond);
+    ad_mutexUnlock(&s_async.lock);
+}
+
+/* Render thread */
+
+static bool ad_asyncHasWork(void) {
+    return ad_atomicLoadAcquire(&s_async.head) != ad_atomicLoad(&s_async.tail)
+        || (ad_atomicLoadAcquire(&s_async.mailbox) & AD_ASYNC_FRESH) != 0;
+}
+
+static void ad_asyncRenderFrame(const ad_Char *cells) {
+    ad_presentBuffer(s_async.hal, cells, s_async.front);
+    ad_atomicAdd(&s_async.framesRendered, 1);
+}
+
+/* Renders the newest frame of the triple buffer, if there is one that wasn't shown yet */
+static bool ad_asyncTakeMailbox(void) {
+    if ((ad_atomicLoadAcquire(&s_async.mailbox) & AD_ASYNC_FRESH) == 0) {
+        return false;
+    }
+
+    s_async.consumerFrame = ad_atomicExchange(&s_async.mailbox, s_async.consumerFrame) & ~AD_ASYNC_FRESH;
+    s_async.consumerHasFrame = true;
+    ad_asyncRenderFrame(s_async.frames[s_async.consumerFrame]);
+    return true;
+}
+
+/* Executes the oldest command in the ring. Returns false if it was AD_ASYNC_CMD_STOP. */
+static bool ad_asyncExecute(const ad_AsyncCommand *cmd) {
+    switch (cmd->type) {
+        case AD_ASYNC_CMD_FRAME:
+            ad_asyncRenderFrame(cmd->cells);
+            return true;
+        case AD_ASYNC_CMD_RESTORE_CONSOLE:
+            s_async.hal->restoreConsole(s_async.hal);
+            memset(s_async.front, 0, s_async.frameSize);
+            /* Frames from the triple buffer may have overtaken the restore, show the last one again */
+            if (s_async.consumerHasFrame) {
+                ad_asyncRenderFrame(s_async.frames[s_async.consumerFrame]);
+            }
+            return true;
+        case AD_ASYNC_CMD_STOP:
+        default:
+            ad_asyncTakeMailbox();
+            return false;
+    }
+}
+
+static void ad_asyncRenderLoop(void) {
+    bool keepRunning = true;
+
+    while (keepRunning) {
+        uint32_t tail = ad_atomicLoad(&s_async.tail);
+
+        if (tail != ad_atomicLoadAcquire(&s_async.head)) {
+            keepRunning = ad_asyncExecute(&s_async.ring[tail & (s_async.ringSize - 1)]);
+            ad_atomicStoreRelease(&s_async.tail, tail + 1);
+            ad_asyncSignal(&s_async.spaceAvailable);
+            continue;
+        }
+
+        if (ad_asyncTakeMailbox()) {
+            continue;
+        }
+
+        ad_mutexLock(&s_async.lock);
+        while (!ad_asyncHasWork()) {
+            ad_condWait(&s_async.workAvailable, &s_async.lock);
+        }
+        ad_mutexUnlock(&s_async.lock);
+    }
+}
+
+AD_THREAD_FUNC(ad_asyncThread, arg) {
+    ad_s_ctx = (ad_Context *) arg;
+    ad_asyncRenderLoop();
+    AD_THREAD_RETURN;
+}
+
+/* Producer (UI thread) */
+
+/* Returns the next free ring slot, waits for the render thread if there is none */
+static ad_AsyncCommand *ad_asyncReserve(void) {
+    uint32_t head = ad_atomicLoad(&s_async.head);
+
+    if (head - ad_atomicLoadAcquire(&s_async.tail) >= s_async.ringSize) {
+        s_async.stats.producerWaits++;
+
+        ad_mutexLock(&s_async.lock);
+        while (head - ad_atomicLoadAcquire(&s_async.tail) >= s_async.ringSize) {
+            ad_condWait(&s_async.spaceAvailable, &s_async.lock);
+        }
+        ad_mutexUnlock(&s_async.lock);
+    }
+
+    return &s_async.ring[head & (s_async.ringSize - 1)];
+}
+
+/* Hands the slot returned by ad_asyncReserve to the render thread */
+static void ad_asyncCommit(void) {
+    ad_atomicStoreRelease(&s_async.head, ad_atomicLoad(&s_async.head) + 1);
+    ad_asyncSignal(&s_async.workAvailable);
+}
+
+static void ad_asyncPush(ad_AsyncCommandType type) {
+    ad_asyncReserve()->type = type;
+    ad_asyncCommit();
+}
+
+bool ad_asyncSubmitFrame(const ad_Char *cells) {
+    uint32_t previous;
+
+    if (!ad_asyncIsRunning()) {
+        return false;
+    }
+
+    s_async.stats.framesSubmitted++;
+
+    if (s_async.policy == AD_ASYNC_BLOCK) {
+        ad_AsyncCommand *cmd = ad_asyncReserve();
+        cmd->type = AD_ASYNC_CMD_FRAME;
+        memcpy(cmd->cells, cells, s_async.frameSize);
+        ad_asyncCommit();
+        return true;
+    }
+
+    memcpy(s_async.frames[s_async.producerFrame], cells, s_async.frameSize);
+    previous = ad_atomicExchange(&s_async.mailbox, s_async.producerFrame | AD_ASYNC_FRESH);
+
+    if (previous & AD_ASYNC_FRESH) {
+        s_async.stats.framesDropped++;
+    }
+
+    s_async.producerFrame = previous & ~AD_ASYNC_FRESH;
+    ad_asyncSignal(&s_async.workAvailable);
+    return true;
+}
+
+bool ad_asyncRestoreConsole(void) {
+    if (!ad_asyncIsRunning()) {
+        return false;
+    }
+
+    ad_asyncPush(AD_ASYNC_CMD_RESTORE_CONSOLE);
+    return true;
+}
+
+static void ad_asyncFreeBuffers(void) {
+    size_t i;
+
+    free(s_async.ring);
+    free(s_async.ringCells);
+    free(s_async.front);
+
+    for (i = 0; i < AD_ARRAY_SIZE(s_async.frames); i++) {
+        free(s_async.frames[i]);
+        s_async.frames[i] = NULL;
+    }
+
+    s_async.ring = NULL;
+    s_async.ringCells = NULL;
+    s_async.front = NULL;
+}
+
+bool ad_asyncStart(ad_AsyncPolicy policy, size_t queueLength) {
+    size_t      cellCount = ad_screenGetCellCount();
+    size_t      i;
+    bool        ok = true;
+
+    if (ad_asyncIsRunning()) {
+        return true;
+    }
+
+    if (cellCount == 0) {
+        return false;
+    }
+
+    if (ad_s_ctx->async == NULL) {
+        ad_s_ctx->async = malloc(sizeof(ad_AsyncState));
+        AD_RETURN_ON_NULL(ad_s_ctx->async, false);
+    }
+
+    memset(&s_async, 0, sizeof(s_async));
+
+    s_async.policy      = policy;
+    s_async.hal         = ad_s_hal;
+    s_async.frameSize   = cellCount * sizeof(ad_Char);
+    s_async.ringSize    = 2;
+
+    while (s_async.ringSize < queueLength && s_async.ringSize < 0x10000) {
+        s_async.ringSize *= 2;
+    }
+
+    s_async.ring  = calloc(s_async.ringSize, sizeof(ad_AsyncCommand));
+    s_async.front = malloc(s_async.frameSize);
+    ok = (s_async.ring != NULL && s_async.front != NULL);
+
+    if (ok && policy == AD_ASYNC_BLOCK) {
+        /* Every slot carries a frame */
+        s_async.ringCells = malloc(s_async.ringSize * s_async.frameSize);
+        ok = (s_async.ringCells != NULL);
+
+        for (i = 0; ok && i < s_async.ringSize; i++) {
+            s_async.ring[i].cells = &s_async.ringCells[i * cellCount];
+        }
+    } else {
+        for (i = 0; ok && i < AD_ARRAY_SIZE(s_async.frames); i++) {
+            s_async.frames[i] = malloc(s_async.frameSize);
+            ok = (s_async.frames[i] != NULL);
+        }
+    }
+
+    if (!ok) {
+        ad_asyncFreeBuffers();
+        return false;
+    }
+
+    /* Carry on from what is on the screen right now */
+    memcpy(s_async.front, ad_screenGetFront(), s_async.frameSize);
+
+    ad_atomicStore(&s_async.head, 0);
+    ad_atomicStore(&s_async.tail, 0);
+    ad_atomicStore(&s_async.framesRendered, 0);
+    ad_atomicStore(&s_async.mailbox, 1);
+    s_async.producerFrame = 0;
+    s_async.consumerFrame = 2;
+
+    ad_mutexInit(&s_async.lock);
+    ad_condInit(&s_async.workAvailable);
+    ad_condInit(&s_async.spaceAvailable);
+
+    ok = ad_threadStart(&s_async.thread, ad_asyncThread, ad_s_ctx);
+
+    if (!ok) {
+        ad_condDestroy(&s_async.spaceAvailable);
+        ad_condDestroy(&s_async.workAvailable);
+        ad_mutexDestroy(&s_async.lock);
+        ad_asyncFreeBuffers();
+        return false;
+    }
+
+    s_async.running = true;
+    return true;
+}
+
+void ad_asyncStop(void) {
+    if (!ad_asyncIsRunning()) {
+        return;
+    }
+
+    /* Everything queued before this still gets shown */
+    ad_asyncPush(AD_ASYNC_CMD_STOP);
+
+    ad_threadJoin(s_async.thread);
+
+    /* Synchronous presenting continues from what the render thread left on the screen */
+    memcpy(ad_screenGetFront(), s_async.front, s_async.frameSize);
+
+    ad_condDestroy(&s_async.spaceAvailable);
+    ad_condDestroy(&s_async.workAvailable);
+    ad_mutexDestroy(&s_async.lock);
+    ad_asyncFreeBuffers();
+
+    s_async.stats.framesRendered = ad_atomicLoad(&s_async.framesRendered);
+    s_async.running = false;
+}
+
+void ad_asyncGetStats(ad_AsyncStats *stats) {
+    if (stats == NULL) {
+        return;
+    }
+
+    if (ad_s_ctx->async == NULL) {
+        memset(stats, 0, sizeof(ad_AsyncStats));
+        return;
+    }
+
+    *stats = s_async.stats;
+
+    if (s_async.running) {
+        stats->framesRendered = ad_atomicLoad(&s_async.framesRendered);
+    }
+}
+
+void ad_asyncRelease(void) {
+    ad_asyncStop();
+    free(ad_s_ctx->async);
+    ad_s_ctx->async = NULL;
+}
+
+#else
+
+/* No threads on this platform, everything stays synchronous */
+
+bool ad_asyncStart(ad_AsyncPolicy policy, size_t queueLength) {
+    AD_UNUSED_PARAMETER(policy);
+    AD_UNUSED_PARAMETER(queueLength);
+    return false;
+}
+
+void ad_asyncStop(void) {
+}
+
+void ad_asyncGetStats(ad_AsyncStats *stats) {
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(ad_AsyncStats));
+    }
+}
+
+bool ad_asyncSubmitFrame(const ad_Char *cells) {
+    AD_UNUSED_PARAMETER(cells);
+    return false;
+}
+
+bool ad_asyncRestoreConsole(void) {
+    return false;
+}
+
+void ad_asyncRelease(void) {
+}
+
+#endif
@@ -0,0 +1,450 @@
+/*
+    AnbUI Miniature Text UI Lib for Burger Enjoyers(tm)
+
+    ad_bench: Rendering benchmark
+
+    Runs every UI component headlessly on the in-memory HAL with scripted
+    keys and reports what each operation costs: HAL calls, cells printed
+    and wall time. Where there is the ANSI terminal HAL, all output is
+    mirrored into one on /dev/null, so the bytes and writes it would send
+    to a real terminal are reported too.
+
+    Usage: ad_bench [iterations]
+
+    Tip of the day: The fastest burger is the one you have already eaten.
+
+    (C) 2026 E. Voirin (oerg866) */
+
+#if defined(__unix__) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L     /* clock_gettime */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define AD_BENCH_HAS_TERMINAL
+#endif
+
+#include "anbui.h"
+#include "ad_priv.h"
+#include "ad_hal.h"
+
+#define AD_BENCH_DEFAULT_ITERATIONS 100
+#define AD_BENCH_TEXT_FILE          "adbench.txt"
+#define AD_BENCH_TEXT_LINES         5000
+
+typedef struct {
+    uint16_t    width;
+    uint16_t    height;
+} ad_BenchSize;
+
+static const ad_BenchSize ad_benchSizes[] = {
+    {  80,  25 },
+    { 200,  60 },
+    { 400, 120 },
+};
+
+typedef struct {
+    const char *name;
+    uint32_t    count;
+    uint32_t    bytes;
+    uint32_t    writes;
+    uint32_t    calls;
+    uint32_t    cells;
+    double      seconds;
+} ad_BenchResult;
+
+typedef enum {
+    AD_BENCH_MENU_PAINT = 0,
+    AD_BENCH_MENU_MOVE,
+    AD_BENCH_TEXT_SCROLL,
+    AD_BENCH_TEXT_PAGE,
+    AD_BENCH_PROGRESS_UPDATE,
+    AD_BENCH_PROGRESS_UPDATE_30HZ,
+    AD_BENCH_MULTISELECTOR_CHANGE,
+    AD_BENCH_SCREEN_SAVE,
+    AD_BENCH_SCREEN_RESTORE,
+    AD_BENCH_PRESENT_UNCHANGED,
+    AD_BENCH_FILL,
+    AD_BENCH_COUNT
+} ad_BenchOperation;
+
+static const char *ad_benchOperationNames[AD_BENCH_COUNT] = {
+    "menu paint",
+    "menu selection move",
+    "text box scroll",
+    "text box page",
+    "progress update",
+    "progress update 30 Hz",
+    "multiselector change",
+    "screen save",
+    "screen restore",
+    "present unchanged",
+    "fill screen",
+};
+
+static ad_Hal          *s_mem;
+static ad_Hal          *s_terminal;         /* Encodes the mirrored output into escape sequences, NULL if there is none */
+static ad_Hal          *s_mirror;
+static ad_Hal          *s_counter;
+static uint32_t       (*s_counterGetKey)(ad_Hal *hal);
+
+static ad_BenchResult   s_results[AD_BENCH_COUNT];
+static ad_BenchResult  *s_current;          /* Measurement in progress */
+static ad_BenchResult  *s_keyResult;        /* Where the cost of handling a scripted key goes */
+static ad_OutputStats   s_startStats;
+
+#if defined(AD_BENCH_HAS_TERMINAL)
+static int              s_nullFd;
+#endif
+static double           s_startTime;
+
+#if defined(__unix__) || defined(__APPLE__)
+static double ad_benchNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+#else
+static double ad_benchNow(void) {
+    return (double) clock() / (double) CLOCKS_PER_SEC;
+}
+#endif
+
+static void ad_benchOutputStats(ad_OutputStats *stats) {
+    if (s_terminal != NULL) {
+        s_terminal->getOutputStats(s_terminal, stats);
+    } else {
+        memset(stats, 0, sizeof(ad_OutputStats));
+    }
+}
+
+static void ad_benchStart(ad_BenchResult *result) {
+    s_current = result;
+    ad_halCounterReset(s_counter);
+    ad_benchOutputStats(&s_startStats);
+    s_startTime = ad_benchNow();
+}
+
+static void ad_benchStop(void) {
+    double          now = ad_benchNow();
+    ad_HalCounters  c;
+    ad_OutputStats  stats;
+
+    if (s_current == NULL) {
+        return;
+    }
+
+    ad_halCounterGet(s_counter, &c);
+    ad_benchOutputStats(&stats);
+
+    s_current->count++;
+    s_current->seconds += now - s_startTime;
+    s_current->bytes += stats.totalBytes - s_startStats.totalBytes;
+    s_current->writes += stats.totalWrites - s_startStats.totalWrites;
+    s_current->calls += c.setColor + c.setCursorPosition + c.flush + c.putString + c.putChar + c.putSpan + c.scrollRows;
+    s_current->cells += c.cells;
+    s_current = NULL;
+}
+
+/*  Every key read means the UI component is done with the previous key,
+    so this is where one measurement ends and the next one begins. */
+static uint32_t ad_benchGetKey(ad_Hal *hal) {
+    uint32_t key;
+
+    ad_benchStop();
+
+    key = s_counterGetKey(hal);
+
+    if (key != AD_KEY_ENTER && s_keyResult != NULL) {
+        ad_benchStart(s_keyResult);
+    }
+
+    return key;
+}
+
+static void ad_benchSetKeys(uint32_t key, size_t count) {
+    uint32_t   *keys = malloc((count + 1) * sizeof(uint32_t));
+    size_t      i;
+
+    if (keys == NULL) {
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        keys[i] = key;
+    }
+
+    keys[count] = AD_KEY_ENTER;
+    ad_halMemorySetKeys(s_mem, keys, count + 1);
+    free(keys);
+}
+
+static ad_Menu *ad_benchMenuCreate(size_t itemCount) {
+    ad_Menu    *menu = ad_menuCreate("Menu Bench", "Select your favorite burger:", true, false);
+    size_t      i;
+
+    for (i = 0; i < itemCount; i++) {
+        ad_menuAddItemFormatted(menu, "Item %u: Burger Cheese is Cheese on Burger", (unsigned) i);
+    }
+
+    return menu;
+}
+
+static void ad_benchMenu(uint16_t height, uint32_t iterations) {
+    ad_Menu    *menu;
+    uint32_t    i;
+
+    /* Every round paints the menu, moves the selection once and closes it again */
+    for (i = 0; i < iterations; i++) {
+        menu = ad_benchMenuCreate(AD_MAX(height / 2, 3));
+        ad_benchSetKeys(AD_KEY_DOWN, 1);
+        s_keyResult = &s_results[AD_BENCH_MENU_MOVE];
+        ad_benchStart(&s_results[AD_BENCH_MENU_PAINT]);
+        ad_menuExecute(menu);
+        s_keyResult = NULL;
+        ad_menuDestroy(menu);
+    }
+}
+
+static bool ad_benchWriteTextFile(void) {
+    FILE   *out = fopen(AD_BENCH_TEXT_FILE, "w");
+    size_t  i;
+
+    AD_RETURN_ON_NULL(out, false);
+
+    for (i = 0; i < AD_BENCH_TEXT_LINES; i++) {
+        fprintf(out, "%05u: Anby Demara's Burger Handbook, chapter %u, on the cheesing of burgers.\n", (unsigned) i, (unsigned) (i / 100));
+    }
+
+    fclose(out);
+    return true;
+}
+
+static void ad_benchTextBox(uint32_t iterations) {
+    uint32_t   *keys = malloc((2 * iterations + 1) * sizeof(uint32_t));
+    uint32_t    i;
+
+    if (keys == NULL) {
+        return;
+    }
+
+    /* Line by line, stays well inside the file */
+    ad_benchSetKeys(AD_KEY_DOWN, AD_MIN(iterations, AD_BENCH_TEXT_LINES / 2));
+    s_keyResult = &s_results[AD_BENCH_TEXT_SCROLL];
+    ad_textFileBox("Text Box Bench", AD_BENCH_TEXT_FILE);
+
+    /* Page down/up alternating, so every key moves a full page */
+    for (i = 0; i < iterations; i++) {
+        keys[2 * i]     = AD_KEY_PGDN;
+        keys[2 * i + 1] = AD_KEY_PGUP;
+    }
+
+    keys[2 * iterations] = AD_KEY_ENTER;
+    ad_halMemorySetKeys(s_mem, keys, 2 * iterations + 1);
+    s_keyResult = &s_results[AD_BENCH_TEXT_PAGE];
+    ad_textFileBox("Text Box Bench", AD_BENCH_TEXT_FILE);
+
+    s_keyResult = NULL;
+    free(keys);
+}
+
+static void ad_benchProgressRun(uint32_t iterations, uint32_t refreshesPerSecond, ad_BenchResult *result) {
+    ad_ProgressBox *pb = ad_progressBoxSingleCreate("Progress Bench", iterations, "Cheesing the burger...");
+    uint32_t        i;
+
+    ad_progressBoxSetRefreshRate(pb, refreshesPerSecond);
+
+    for (i = 1; i <= iterations; i++) {
+        ad_benchStart(result);
+        ad_progressBoxUpdate(pb, i);
+        ad_benchStop();
+    }
+
+    ad_progressBoxDestroy(pb);
+}
+
+static void ad_benchProgress(uint32_t iterations) {
+    ad_benchProgressRun(iterations, 0,  &s_results[AD_BENCH_PROGRESS_UPDATE]);
+    ad_benchProgressRun(iterations, 30, &s_results[AD_BENCH_PROGRESS_UPDATE_30HZ]);
+}
+
+static void ad_benchMultiSelector(uint32_t iterations) {
+    static const char *buns[]   = { "Sesame", "Brioche" };
+    static const char *cheese[] = { "Cheddar", "American", "None" };
+    ad_MultiSelector  *sel      = ad_multiSelectorCreate("Multiselector Bench", "Please select your burger ingredients", true);
+
+    ad_multiSelectorAddItem(sel, "What kind of bun?",    2, 0, buns);
+    ad_multiSelectorAddItem(sel, "What kind of cheese?", 3, 0, cheese);
+
+    ad_benchSetKeys(AD_KEY_RIGHT, iterations);
+    s_keyResult = &s_results[AD_BENCH_MULTISELECTOR_CHANGE];
+    ad_multiSelectorExecute(sel);
+    s_keyResult = NULL;
+
+    ad_multiSelectorDestroy(sel);
+}
+
+static void ad_benchScreenState(uint32_t iterations) {
+    ad_ProgressBox *pb;
+    uint32_t        i;
+
+    for (i = 0; i < iterations; i++) {
+        ad_benchStart(&s_results[AD_BENCH_SCREEN_SAVE]);
+        ad_screenSaveState();
+        ad_benchStop();
+
+        /* Something to restore over */
+        pb = ad_progressBoxSingleCreate("Screen Bench", 2, "Drawing over the screen...");
+        ad_progressBoxUpdate(pb, 1);
+
+        ad_benchStart(&s_results[AD_BENCH_SCREEN_RESTORE]);
+        ad_screenLoadState();
+        ad_benchStop();
+
+        ad_progressBoxDestroy(pb);
+    }
+}
+
+/* Cost of comparing a whole frame that didn't change, and of filling the whole screen */
+static void ad_benchPresent(uint16_t height, uint32_t iterations) {
+    uint32_t i;
+    uint16_t y;
+
+    for (i = 0; i < iterations; i++) {
+        ad_benchStart(&s_results[AD_BENCH_PRESENT_UNCHANGED]);
+        ad_present();
+        ad_benchStop();
+    }
+
+    for (i = 0; i < iterations; i++) {
+        ad_benchStart(&s_results[AD_BENCH_FILL]);
+        for (y = 0; y < height; y++) {
+            ad_fill(ad_s_con.width, (i & 1) ? '#' : ' ', 0, y, COLOR_BLUE, COLOR_WHITE);
+        }
+        ad_benchStop();
+    }
+}
+
+static void ad_benchPrintResults(const ad_BenchSize *size) {
+    size_t i;
+
+    for (i = 0; i < AD_BENCH_COUNT; i++) {
+        const ad_BenchResult *r = &s_results[i];
+        double count = (r->count > 0) ? (double) r->count : 1.0;
+
+        printf("%3ux%-3u  %-22s %8lu ", (unsigned) size->width, (unsigned) size->height, r->name, (unsigned long) r->count);
+
+        if (s_terminal != NULL) {
+            printf("%12.1f %10.2f ", (double) r->bytes / count, (double) r->writes / count);
+        } else {
+            printf("%12s %10s ", "-", "-");
+        }
+
+        printf("%10.1f %10.1f %10.2f\n", (double) r->calls / count, (double) r->cells / count, r->seconds * 1e6 / count);
+    }
+}
+
+static bool ad_benchRunSize(const ad_BenchSize *size, uint32_t iterations) {
+    size_t i;
+
+    /* Large screens don't fit into a segment on 16-bit targets */
+    if ((uint32_t) size->width * size->height * sizeof(ad_Char) > (uint32_t) ((size_t) -1)) {
+        printf("%3ux%-3u  skipped, screen buffer too large for this target\n", (unsigned) size->width, (unsigned) size->height);
+        return true;
+    }
+
+    s_mem = ad_halMemoryCreate(size->width, size->height);
+    AD_RETURN_ON_NULL(s_mem, false);
+    s_mirror = s_mem;
+
+#if defined(AD_BENCH_HAS_TERMINAL)
+    s_terminal = ad_halTerminalCreate(s_nullFd, s_nullFd);
+    AD_RETURN_ON_NULL(s_terminal, false);
+    ad_halTerminalSetSize(s_terminal, size->width, size->height);
+    s_mirror = ad_halMirrorCreate(s_mem, s_terminal);
+    AD_RETURN_ON_NULL(s_mirror, false);
+#endif
+
+    s_counter = ad_halCounterCreate(s_mirror);
+    AD_RETURN_ON_NULL(s_counter, false);
+
+    s_counterGetKey = s_counter->getKey;
+    s_counter->getKey = ad_benchGetKey;
+
+    memset(s_results, 0, sizeof(s_results));
+    for (i = 0; i < AD_BENCH_COUNT; i++) {
+        s_results[i].name = ad_benchOperationNames[i];
+    }
+
+    ad_initWithHal("AnbUI Super Burger Edition - The Benchmark(tm)", s_counter);
+
+    ad_benchMenu(size->height, iterations);
+    ad_benchTextBox(iterations);
+    ad_benchProgress(iterations);
+    ad_benchMultiSelector(iterations);
+    ad_benchScreenState(iterations);
+    ad_benchPresent(size->height, iterations);
+
+    ad_deinit();
+
+    ad_halDestroy(s_counter);
+
+    if (s_mirror != s_mem) {
+        ad_halDestroy(s_mirror);
+    }
+
+    ad_benchPrintResults(size);
+
+    ad_halDestroy(s_terminal);
+    ad_halDestroy(s_mem);
+    s_terminal = NULL;
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t    iterations = AD_BENCH_DEFAULT_ITERATIONS;
+    size_t      i;
+    bool        ok = true;
+
+    if (argc > 1) {
+        iterations = (uint32_t) strtoul(argv[1], NULL, 10);
+        iterations = AD_MAX(iterations, 1);
+    }
+
+    if (!ad_benchWriteTextFile()) {
+        printf("Could not write %s\n", AD_BENCH_TEXT_FILE);
+        return 1;
+    }
+
+#if defined(AD_BENCH_HAS_TERMINAL)
+    s_nullFd = open("/dev/null", O_RDWR);
+
+    if (s_nullFd < 0) {
+        printf("Could not open /dev/null\n");
+        return 1;
+    }
+#endif
+
+    printf("Cell kernels: %s\n", ad_cellsKernelName());
+    printf("size     operation                 count     bytes/op  writes/op   calls/op   cells/op    usec/op\n");
+
+    for (i = 0; i < AD_ARRAY_SIZE(ad_benchSizes) && ok; i++) {
+        ok = ad_benchRunSize(&ad_benchSizes[i], iterations);
+    }
+
+    remove(AD_BENCH_TEXT_FILE);
+
+#if defined(AD_BENCH_HAS_TERMINAL)
+    close(s_nullFd);
+#endif
+
+    return ok ? 0 : 1;
+}
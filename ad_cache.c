@@ -0,0 +1,331 @@
+/*
+    AnbUI Miniature Text UI Lib for Burger Enjoyers(tm)
+
+    ad_cache: Line index cache
+
+    The line index of a file can be kept on disk, so a file that is shown
+    again doesn't have to be looked through for its lines again. A cache
+    file belongs to exactly one version of a file: device, inode, size and
+    modification time are in its header, and if any of those differ, it
+    is ignored.
+
+    Line starts are stored as the distance to the previous one, seven
+    bits per byte with the top bit meaning "more to come". Lines are
+    rarely longer than 127 characters, so that's about one byte per line.
+
+    The cache file is mapped into memory to be read. Everything in it is
+    checked before it is used, a cache file that doesn't add up is simply
+    ignored.
+
+    Tip of the day: Write down what's in the secret sauce. You won't
+    remember it tomorrow.
+
+    (C) 2026 E. Voirin (oerg866) */
+
+#if defined(__unix__) || defined(__APPLE__)
+# define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "anbui.h"
+#include "ad_priv.h"
+#include "ad_hal.h"
+
+#if defined(AD_HAL_HAS_MMAP)
+
+#if defined(_WIN32)
+# include <windows.h>
+#else
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+#define AD_CACHE_MAGIC          "ADLX"
+#define AD_CACHE_VERSION        1
+#define AD_CACHE_HEADER_SIZE    64
+#define AD_CACHE_WRITE_BUFFER   4096
+
+/*  Header, all numbers little endian:
+     0  magic           4 bytes
+     4  version         32 bit
+     8  device          64 bit
+    16  inode           64 bit
+    24  size            64 bit
+    32  mtime           64 bit
+    40  line count      64 bit
+    48  longest line    64 bit
+    56  data size       64 bit, bytes of line starts after the header */
+
+static void ad_cachePut64(uint8_t *dst, uint64_t value) {
+    size_t i;
+
+    for (i = 0; i < 8; i++) {
+        dst[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+static uint64_t ad_cacheGet64(const uint8_t *src) {
+    uint64_t    value = 0;
+    size_t      i;
+
+    for (i = 0; i < 8; i++) {
+        value |= (uint64_t) src[i] << (8 * i);
+    }
+
+    return value;
+}
+
+/* Cache files are named after device and inode, so there is only ever one per file. Returns false if the path doesn't fit. */
+static bool ad_cacheGetPath(char *dst, size_t dstSize, const char *directory, const ad_FileKey *key, const char *suffix) {
+    int length = snprintf(dst, dstSize, "%s/%08lx%08lx-%08lx%08lx.adx%s", directory,
+        (unsigned long) (key->device >> 32), (unsigned long) (key->device & 0xFFFFFFFFUL),
+        (unsigned long) (key->inode >> 32), (unsigned long) (key->inode & 0xFFFFFFFFUL), suffix);
+
+    return length > 0 && (size_t) length < dstSize;
+}
+
+static void ad_cacheWriteHeader(uint8_t *header, const ad_FileKey *key, uint64_t lineCount, uint64_t longestLine, uint64_t dataSize) {
+    memcpy(header, AD_CACHE_MAGIC, 4);
+    header[4] = AD_CACHE_VERSION;
+    header[5] = header[6] = header[7] = 0;
+    ad_cachePut64(&header[8],  key->device);
+    ad_cachePut64(&header[16], key->inode);
+    ad_cachePut64(&header[24], key->size);
+    ad_cachePut64(&header[32], key->mtime);
+    ad_cachePut64(&header[40], lineCount);
+    ad_cachePut64(&header[48], longestLine);
+    ad_cachePut64(&header[56], dataSize);
+}
+
+/* Decodes the line starts, returns false if the data doesn't add up */
+static bool ad_cacheDecode(const uint8_t *data, size_t dataSize, ad_FileOffset fileSize, ad_FileOffset *offsets, size_t count) {
+    const uint8_t  *end     = data + dataSize;
+    ad_FileOffset   offset  = 0;
+    size_t          i;
+
+    offsets[0] = 0;
+
+    for (i = 1; i < count; i++) {
+        uint64_t    delta = 0;
+        unsigned    shift = 0;
+
+        do {
+            if (data == end || shift > 63) {
+                return false;
+            }
+
+            delta |= (uint64_t) (*data & 0x7F) << shift;
+            shift += 7;
+        } while (*data++ & 0x80);
+
+        /* Lines start after a line break, so every one is at least a byte further and still in the file */
+        if (delta == 0 || delta > fileSize - offset) {
+            return false;
+        }
+
+        offset += (ad_FileOffset) delta;
+        offsets[i] = offset;
+    }
+
+    return data == end && offset < fileSize;
+}
+
+/* Checks the mapped cache file and decodes it */
+static bool ad_cacheParse(const uint8_t *cache, uint64_t cacheSize, const ad_FileKey *key, ad_FileOffset **offsets, size_t *count, size_t *longestLine) {
+    uint64_t lineCount;
+    uint64_t longest;
+    uint64_t dataSize;
+
+    if (cacheSize < AD_CACHE_HEADER_SIZE
+        || memcmp(cache, AD_CACHE_MAGIC, 4) != 0
+        || cache[4] != AD_CACHE_VERSION
+        || ad_cacheGet64(&cache[8])  != key->device
+        || ad_cacheGet64(&cache[16]) != key->inode
+        || ad_cacheGet64(&cache[24]) != key->size
+        || ad_cacheGet64(&cache[32]) != key->mtime) {
+        return false;
+    }
+
+    lineCount = ad_cacheGet64(&cache[40]);
+    longest = ad_cacheGet64(&cache[48]);
+    dataSize = ad_cacheGet64(&cache[56]);
+
+    /* Every line but the first takes at least one byte, and no line is longer than the file */
+    if (lineCount == 0 || dataSize != cacheSize - AD_CACHE_HEADER_SIZE || lineCount - 1 > dataSize || lineCount > SIZE_MAX / sizeof(ad_FileOffset)
+        || longest > key->size) {
+        return false;
+    }
+
+    *offsets = malloc((size_t) lineCount * sizeof(ad_FileOffset));
+    AD_RETURN_ON_NULL(*offsets, false);
+
+    if (!ad_cacheDecode(&cache[AD_CACHE_HEADER_SIZE], (size_t) dataSize, (ad_FileOffset) key->size, *offsets, (size_t) lineCount)) {
+        free(*offsets);
+        *offsets = NULL;
+        return false;
+    }
+
+    *count = (size_t) lineCount;
+    *longestLine = (size_t) longest;
+    return true;
+}
+
+#if defined(_WIN32)
+
+bool ad_lineCacheLoad(const char *directory, const ad_FileKey *key, ad_FileOffset **offsets, size_t *count, size_t *longestLine) {
+    char            path[AD_BUF_SIZE];
+    HANDLE          file;
+    HANDLE          mapping     = NULL;
+    const uint8_t  *cache       = NULL;
+    LARGE_INTEGER   size;
+    bool            ok          = false;
+
+    if (!ad_cacheGetPath(path, sizeof(path), directory, key, "")) {
+        return false;
+    }
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    if (GetFileSizeEx(file, &size) && size.QuadPart >= AD_CACHE_HEADER_SIZE && (uint64_t) size.QuadPart <= (uint64_t) SIZE_MAX) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        cache = (mapping != NULL) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    }
+
+    if (cache != NULL) {
+        ok = ad_cacheParse(cache, (uint64_t) size.QuadPart, key, offsets, count, longestLine);
+        UnmapViewOfFile(cache);
+    }
+
+    if (mapping != NULL) CloseHandle(mapping);
+    CloseHandle(file);
+    return ok;
+}
+
+#else
+
+bool ad_lineCacheLoad(const char *directory, const ad_FileKey *key, ad_FileOffset **offsets, size_t *count, size_t *longestLine) {
+    char        path[AD_BUF_SIZE];
+    struct stat st;
+    void       *cache;
+    bool        ok;
+    int         fd;
+
+    if (!ad_cacheGetPath(path, sizeof(path), directory, key, "")) {
+        return false;
+    }
+
+    fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_size < AD_CACHE_HEADER_SIZE || (uint64_t) st.st_size > (uint64_t) SIZE_MAX) {
+        close(fd);
+        return false;
+    }
+
+    cache = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (cache == MAP_FAILED) {
+        return false;
+    }
+
+    ok = ad_cacheParse(cache, (uint64_t) st.st_size, key, offsets, count, longestLine);
+    munmap(cache, (size_t) st.st_size);
+    return ok;
+}
+
+#endif
+
+bool ad_lineCacheStore(const char *directory, const ad_FileKey *key, const ad_FileOffset *offsets, size_t count, size_t longestLine) {
+    char        path[AD_BUF_SIZE];
+    char        tempPath[AD_BUF_SIZE];
+    uint8_t     header[AD_CACHE_HEADER_SIZE];
+    uint8_t     buffer[AD_CACHE_WRITE_BUFFER + 10];
+    size_t      used        = 0;
+    uint64_t    dataSize    = 0;
+    FILE       *out;
+    size_t      i;
+    bool        ok;
+
+    AD_RETURN_ON_NULL(offsets, false);
+
+    if (!ad_cacheGetPath(path, sizeof(path), directory, key, "")
+        || !ad_cacheGetPath(tempPath, sizeof(tempPath), directory, key, ".tmp")) {
+        return false;
+    }
+
+    out = fopen(tempPath, "wb");
+    AD_RETURN_ON_NULL(out, false);
+
+    /* The header goes in last, once the data size is known. A half written file has no magic and gets ignored. */
+    memset(header, 0, sizeof(header));
+    ok = fwrite(header, 1, sizeof(header), out) == sizeof(header);
+
+    for (i = 1; ok && i < count; i++) {
+        uint64_t delta = (uint64_t) (offsets[i] - offsets[i - 1]);
+
+        while (delta >= 0x80) {
+            buffer[used++] = (uint8_t) (delta | 0x80);
+            delta >>= 7;
+        }
+
+        buffer[used++] = (uint8_t) delta;
+
+        if (used >= AD_CACHE_WRITE_BUFFER || i + 1 == count) {
+            ok = fwrite(buffer, 1, used, out) == used;
+            dataSize += used;
+            used = 0;
+        }
+    }
+
+    ad_cacheWriteHeader(header, key, (uint64_t) count, (uint64_t) longestLine, dataSize);
+    ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(header, 1, sizeof(header), out) == sizeof(header);
+    ok = (fclose(out) == 0) && ok;
+
+    /* Only a complete cache file takes the place of the old one. Windows can't rename over an existing file. */
+    if (ok) {
+        remove(path);
+        ok = rename(tempPath, path) == 0;
+    }
+
+    if (!ok) {
+        remove(tempPath);
+    }
+
+    return ok;
+}
+
+#else
+
+bool ad_lineCacheLoad(const char *directory, const ad_FileKey *key, ad_FileOffset **offsets, size_t *count, size_t *longestLine) {
+    AD_UNUSED_PARAMETER(directory);
+    AD_UNUSED_PARAMETER(key);
+    AD_UNUSED_PARAMETER(offsets);
+    AD_UNUSED_PARAMETER(count);
+    AD_UNUSED_PARAMETER(longestLine);
+    return false;
+}
+
+bool ad_lineCacheStore(const char *directory, const ad_FileKey *key, const ad_FileOffset *offsets, size_t count, size_t longestLine) {
+    AD_UNUSED_PARAMETER(directory);
+    AD_UNUSED_PARAMETER(key);
+    AD_UNUSED_PARAMETER(offsets);
+    AD_UNUSED_PARAMETER(count);
+    AD_UNUSED_PARAMETER(longestLine);
+    return false;
+}
+
+#endif
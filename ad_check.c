@@ -0,0 +1,1742 @@
+/*
+    AnbUI Miniature Text UI Lib for Burger Enjoyers(tm)
+
+    ad_check: Behavior checks
+
+    Drives the UI components on the in-memory HAL with scripted keys and
+    checks what they return and what is on the screen while they run.
+    Only what the renderer actually sent ends up in the in-memory HAL
+    (frame diffs, row moves, restored snapshots), so if the screen is
+    wrong here, it is wrong on a real console too.
+
+    Usage: ad_check. Returns 0 if all checks pass.
+
+    Tip of the day: Taste the burger before you serve it.
+
+    (C) 2026 E. Voirin (oerg866) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "anbui.h"
+#include "ad_priv.h"
+#include "ad_hal.h"
+#include "ad_thrd.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+# include <unistd.h>
+# include <fcntl.h>
+#endif
+
+#define AD_CHECK_WIDTH          80
+#define AD_CHECK_HEIGHT         25
+#define AD_CHECK_TEXT_FILE      "adcheck.txt"
+#define AD_CHECK_TEXT_LINES     200
+#define AD_CHECK_OVERLAP_FILE   "adcheck2.txt"
+#define AD_CHECK_LINE_LENGTH    60
+#define AD_CHECK_MAX_WAITS      1000000     /* Waits for a key before a component counts as stuck */
+
+static ad_Hal          *s_mem;
+static uint32_t       (*s_memGetKey)(ad_Hal *hal);
+static void           (*s_onKey)(size_t index);     /* Looks at the screen before key <index> is handed out */
+static size_t           s_keysRead;
+static uint32_t         s_waits;
+static bool             s_keysReady;                /* Keys come right away, for boxes that are never done (following a file) */
+static uint32_t         s_failures;
+static ad_Char          s_background[AD_CHECK_WIDTH * AD_CHECK_HEIGHT];
+
+static void ad_checkThat(bool ok, const char *format, ...) {
+    va_list args;
+
+    if (ok) {
+        return;
+    }
+
+    s_failures++;
+    printf("FAILED: ");
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+}
+
+static uint32_t ad_checkGetKey(ad_Hal *hal) {
+    if (s_onKey != NULL) {
+        s_onKey(s_keysRead);
+    }
+
+    s_keysRead++;
+    s_waits = 0;
+    return s_memGetKey(hal);
+}
+
+/*  Components only wait for keys while they have something going on in the background (searches, indexing).
+    The scripted user doesn't press the next key before that is done, so what is checked doesn't depend on timing. */
+static bool ad_checkWaitForKey(ad_Hal *hal, uint32_t milliseconds) {
+    AD_UNUSED_PARAMETER(hal);
+    AD_UNUSED_PARAMETER(milliseconds);
+
+    if (s_keysReady) {
+        return true;
+    }
+
+    if (++s_waits < AD_CHECK_MAX_WAITS) {
+        return false;
+    }
+
+    ad_checkThat(false, "still busy when key %lu was due", (unsigned long) s_keysRead);
+    return true;
+}
+
+static void ad_checkSetKeys(const uint32_t *keys, size_t count, void (*onKey)(size_t index)) {
+    ad_halMemorySetKeys(s_mem, keys, count);
+    s_onKey = onKey;
+    s_keysRead = 0;
+}
+
+/* Whole screen as it was before a component was shown, it has to look like that again once it is gone */
+static void ad_checkSaveBackground(void) {
+    memcpy(s_background, ad_halMemoryGetCells(s_mem), sizeof(s_background));
+}
+
+static void ad_checkBackgroundRestored(const char *what) {
+    ad_checkThat(memcmp(s_background, ad_halMemoryGetCells(s_mem), sizeof(s_background)) == 0,
+        "%s: screen not restored after closing", what);
+}
+
+/* First row containing <text>, -1 if there is none. <x> gets the column it starts at. */
+static int ad_checkFindRow(const char *text, size_t *x) {
+    char        row[AD_CHECK_WIDTH + 1];
+    const char *found;
+    uint16_t    y;
+
+    for (y = 0; y < AD_CHECK_HEIGHT; y++) {
+        ad_halMemoryGetRowText(s_mem, y, row, sizeof(row));
+        found = strstr(row, text);
+
+        if (found != NULL) {
+            if (x != NULL) *x = (size_t) (found - row);
+            return (int) y;
+        }
+    }
+
+    return -1;
+}
+
+static bool ad_checkIsHighlighted(const char *text) {
+    size_t  x;
+    int     y = ad_checkFindRow(text, &x);
+
+    return y >= 0 && ad_halMemoryGetCells(s_mem)[(size_t) y * AD_CHECK_WIDTH + x].color.bg == ad_s_con.objectFg;
+}
+
+static bool ad_checkFooterHas(const char *text) {
+    char row[AD_CHECK_WIDTH + 1];
+
+    ad_halMemoryGetRowText(s_mem, AD_CHECK_HEIGHT - 1, row, sizeof(row));
+    return strstr(row, text) != NULL;
+}
+
+/* Menu */
+
+static const char *ad_checkMenuItems[] = { "Cheeseburger", "Hamburger", "Veggie Burger", "Fish Burger" };
+
+static int32_t ad_checkMenuRun(const uint32_t *keys, size_t count, void (*onKey)(size_t index)) {
+    ad_Menu    *menu   = ad_menuCreate("Menu Check", "Select your favorite burger:", true, false);
+    size_t      i;
+    int32_t     ret;
+
+    for (i = 0; i < AD_ARRAY_SIZE(ad_checkMenuItems); i++) {
+        ad_menuAddItemFormatted(menu, "%s", ad_checkMenuItems[i]);
+    }
+
+    ad_checkSaveBackground();
+    ad_checkSetKeys(keys, count, onKey);
+    ret = ad_menuExecute(menu);
+    ad_menuDestroy(menu);
+    ad_checkBackgroundRestored("menu");
+
+    return ret;
+}
+
+/* Exactly the expected item is drawn as selected */
+static void ad_checkMenuSelection(size_t expected) {
+    size_t i;
+
+    for (i = 0; i < AD_ARRAY_SIZE(ad_checkMenuItems); i++) {
+        ad_checkThat(ad_checkFindRow(ad_checkMenuItems[i], NULL) >= 0, "menu: item %s not shown", ad_checkMenuItems[i]);
+        ad_checkThat(ad_checkIsHighlighted(ad_checkMenuItems[i]) == (i == expected),
+            "menu: item %s %s", ad_checkMenuItems[i], i == expected ? "not highlighted" : "highlighted");
+    }
+}
+
+static void ad_checkMenuOnKey(size_t index) {
+    /* DOWN DOWN DOWN UP ENTER */
+    static const size_t selections[] = { 0, 1, 2, 3, 2 };
+    ad_checkMenuSelection(selections[index]);
+}
+
+static void ad_checkMenu(void) {
+    static const uint32_t moves[]   = { AD_KEY_DOWN, AD_KEY_DOWN, AD_KEY_DOWN, AD_KEY_UP, AD_KEY_ENTER };
+    static const uint32_t wrap[]    = { AD_KEY_UP, AD_KEY_ENTER };
+    static const uint32_t cancel[]  = { AD_KEY_DOWN, AD_KEY_ESC };
+    int32_t ret;
+
+    ret = ad_checkMenuRun(moves, AD_ARRAY_SIZE(moves), ad_checkMenuOnKey);
+    ad_checkThat(ret == 2, "menu: returned %ld instead of 2", (long) ret);
+
+    ret = ad_checkMenuRun(wrap, AD_ARRAY_SIZE(wrap), NULL);
+    ad_checkThat(ret == 3, "menu: UP from the first item returned %ld instead of 3", (long) ret);
+
+    ret = ad_checkMenuRun(cancel, AD_ARRAY_SIZE(cancel), NULL);
+    ad_checkThat(ret == AD_CANCELED, "menu: ESC returned %ld instead of AD_CANCELED", (long) ret);
+
+    ret = ad_yesNoBox("Yes/No Check", false, "Cheese on the burger?");
+    ad_checkThat(ret == AD_YESNO_YES, "yes/no box: ENTER returned %ld instead of yes", (long) ret);
+}
+
+/* Text file box */
+
+/* Neighboring lines differ everywhere, so scrolling the box makes the renderer move rows instead of rewriting them */
+static void ad_checkLineText(size_t line, char *dst) {
+    char    number[16];
+    size_t  i;
+
+    sprintf(number, "Line %03u: ", (unsigned) line);
+    strcpy(dst, number);
+
+    for (i = strlen(dst); i < AD_CHECK_LINE_LENGTH; i++) {
+        dst[i] = (char) ('a' + (line * 7 + i * 3) % 26);
+    }
+
+    dst[AD_CHECK_LINE_LENGTH] = 0x00;
+}
+
+/* Writes <lines> lines of AD_CHECK_LINE_LENGTH + 1 bytes each, the last one without its line break unless <lastBreak> */
+static bool ad_checkWriteTextFile(const char *fileName, size_t lines, bool lastBreak) {
+    FILE   *out = fopen(fileName, "wb");
+    char    text[AD_CHECK_LINE_LENGTH + 1];
+    size_t  i;
+
+    AD_RETURN_ON_NULL(out, false);
+
+    for (i = 0; i < lines; i++) {
+        ad_checkLineText(i, text);
+        fprintf(out, (i + 1 < lines || lastBreak) ? "%s\n" : "%s", text);
+    }
+
+    fclose(out);
+    return true;
+}
+
+/* Checks that the box shows consecutive lines from <first> on, all the way down. Returns how many rows it has. */
+static size_t ad_checkTextLines(size_t first, const char *what) {
+    char        row[AD_CHECK_WIDTH + 1];
+    char        expected[AD_CHECK_LINE_LENGTH + 1];
+    const char *found;
+    size_t      shown   = 0;
+    unsigned    line;
+    uint16_t    y;
+
+    /* The footer is the last row, it has "Line" in it as well */
+    for (y = 0; y < AD_CHECK_HEIGHT - 1; y++) {
+        ad_halMemoryGetRowText(s_mem, y, row, sizeof(row));
+        found = strstr(row, "Line ");
+
+        if (found == NULL || sscanf(found, "Line %u:", &line) != 1) {
+            continue;
+        }
+
+        ad_checkLineText(first + shown, expected);
+
+        if ((size_t) line != first + shown || strncmp(found, expected, AD_CHECK_LINE_LENGTH) != 0) {
+            ad_checkThat(false, "text box %s: row %u shows \"%.20s...\" instead of line %lu", what, (unsigned) y, found, (unsigned long) (first + shown));
+            return shown;
+        }
+
+        shown++;
+    }
+
+    ad_checkThat(shown > 0, "text box %s: no lines shown", what);
+    return shown;
+}
+
+static size_t s_textRows;
+
+static void ad_checkTextScrollOnKey(size_t index) {
+    /* DOWN DOWN DOWN PGDN UP PGUP END HOME */
+    switch (index) {
+        case 0: s_textRows = ad_checkTextLines(0, "start");                                 break;
+        case 3: ad_checkTextLines(3, "after DOWN");                                         break;
+        case 4: ad_checkTextLines(3 + s_textRows, "after PGDN");                            break;
+        case 5: ad_checkTextLines(2 + s_textRows, "after UP");                              break;
+        case 6: ad_checkTextLines(2, "after PGUP");                                         break;
+        case 7: ad_checkTextLines(AD_CHECK_TEXT_LINES - s_textRows, "after END");
+                ad_checkThat(ad_checkFooterHas("of 200"), "text box: footer doesn't show the line count"); break;
+        case 8: ad_checkTextLines(0, "after HOME");                                         break;
+        default:                                                                            break;
+    }
+}
+
+static void ad_checkTextSearchOnKey(size_t index) {
+    /* / 1 5 0 ENTER n */
+    if (index == 5) {
+        ad_checkTextLines(150, "after searching");
+        ad_checkThat(ad_checkIsHighlighted("150"), "text box: search hit not highlighted");
+        ad_checkThat(ad_checkFooterHas("1 found"), "text box: footer doesn't show the hit count");
+    }
+}
+
+static void ad_checkTextOverlapOnKey(size_t index) {
+    /* / a a ENTER ENTER, "aaaa aaaa" has "aa" in it six times, but only four of them can be highlighted */
+    if (index == 4) {
+        ad_checkThat(ad_checkFooterHas("4 found"), "text box: overlapping hits counted");
+    }
+}
+
+/* Row of the screen that the top of the box is at */
+static int s_nextY;
+
+static void ad_checkTextNextOnKey(size_t index) {
+    /* / a a ENTER n N N ENTER, "aaa" has "aa" in it twice, but only the first one counts. n goes on to the next line with "aaa" in it. */
+    const char *top[] = { "aaa first", "aaa second", "aaa first", "aaa second" };
+
+    if (index == 4) {
+        s_nextY = ad_checkFindRow(top[0], NULL);
+    }
+
+    if (index >= 4 && index <= 7) {
+        ad_checkThat(s_nextY >= 0 && ad_checkFindRow(top[index - 4], NULL) == s_nextY, "text box: after %lu times n / N, \"%s\" isn't at the top",
+            (unsigned long) (index - 4), top[index - 4]);
+    }
+}
+
+/* Going backwards, the hits are the same ones as going forwards. Before 2 in "aaaa", that's the one at 0, not the one at 1. */
+static void ad_checkTextFindBackward(void) {
+    ad_TextView    *view;
+    ad_TextSearch  *find;
+    ad_FileOffset   hit     = 0;
+    bool            found   = false;
+    FILE           *out     = fopen(AD_CHECK_OVERLAP_FILE, "w");
+
+    if (out == NULL) {
+        ad_checkThat(false, "could not write %s", AD_CHECK_OVERLAP_FILE);
+        return;
+    }
+
+    fprintf(out, "aaaa\n");
+    fclose(out);
+
+    view = ad_textViewOpen(AD_CHECK_OVERLAP_FILE, false);
+    find = view != NULL ? ad_textSearchFind(view, "aa", 2, 2, true) : NULL;
+
+    if (find != NULL) {
+        ad_textSearchWait(find);
+        found = ad_textSearchGetHit(find, &hit);
+    }
+
+    ad_checkThat(found && hit == 0, "text search: backwards from 2, found %s at %lu instead of at 0", found ? "a hit" : "nothing", (unsigned long) hit);
+
+    ad_textSearchDestroy(find);
+    ad_textViewClose(view);
+    remove(AD_CHECK_OVERLAP_FILE);
+}
+
+static void ad_checkTextScrolledHitsOnKey(size_t index) {
+    /* / a a ENTER RIGHT ENTER, the first of "aaaa" is scrolled out of the box. The hits are still the ones from the start of the line. */
+    size_t  x;
+    int     y;
+
+    if (index == 5) {
+        y = ad_checkFindRow("aab", &x);
+        ad_checkThat(y >= 0, "text box: scrolled line not shown");
+        ad_checkThat(y >= 0 && ad_halMemoryGetCells(s_mem)[(size_t) y * AD_CHECK_WIDTH + x + 1].color.bg == ad_s_con.objectFg,
+            "text box: hits after scrolling sideways are not the ones counted");
+    }
+}
+
+static void ad_checkTextFileBox(void) {
+    static const uint32_t scroll[] = { AD_KEY_DOWN, AD_KEY_DOWN, AD_KEY_DOWN, AD_KEY_PGDN, AD_KEY_UP, AD_KEY_PGUP, AD_KEY_END, AD_KEY_HOME, AD_KEY_ENTER };
+    static const uint32_t search[] = { '/', '1', '5', '0', AD_KEY_ENTER, AD_KEY_ENTER };
+    static const uint32_t overlap[] = { '/', 'a', 'a', AD_KEY_ENTER, AD_KEY_ENTER };
+    static const uint32_t scrolledHits[] = { '/', 'a', 'a', AD_KEY_ENTER, AD_KEY_RIGHT, AD_KEY_ENTER };
+    static const uint32_t next[] = { '/', 'a', 'a', AD_KEY_ENTER, 'n', 'N', 'N', AD_KEY_ENTER };
+    size_t  rows = (size_t) ad_objectGetMaximumContentHeight();
+    size_t  step = ad_objectGetMaximumContentWidth() / 2;
+    FILE   *out;
+    size_t  i;
+    int32_t ret;
+
+    if (!ad_checkWriteTextFile(AD_CHECK_TEXT_FILE, AD_CHECK_TEXT_LINES, true)) {
+        ad_checkThat(false, "could not write %s", AD_CHECK_TEXT_FILE);
+        return;
+    }
+
+    ad_checkSaveBackground();
+    ad_checkSetKeys(scroll, AD_ARRAY_SIZE(scroll), ad_checkTextScrollOnKey);
+    ret = ad_textFileBox("Text Box Check", AD_CHECK_TEXT_FILE);
+    ad_checkThat(ret != AD_ERROR, "text box: returned AD_ERROR");
+    ad_checkThat(s_keysRead == AD_ARRAY_SIZE(scroll), "text box: read %lu keys instead of %lu", (unsigned long) s_keysRead, (unsigned long) AD_ARRAY_SIZE(scroll));
+    ad_checkBackgroundRestored("text box");
+
+    ad_checkSetKeys(search, AD_ARRAY_SIZE(search), ad_checkTextSearchOnKey);
+    ad_textFileBox("Text Box Check", AD_CHECK_TEXT_FILE);
+    ad_checkBackgroundRestored("text box");
+
+    out = fopen(AD_CHECK_OVERLAP_FILE, "w");
+
+    if (out != NULL) {
+        fprintf(out, "aaaa aaaa\n");
+        fclose(out);
+        ad_checkSetKeys(overlap, AD_ARRAY_SIZE(overlap), ad_checkTextOverlapOnKey);
+        ad_textFileBox("Text Box Check", AD_CHECK_OVERLAP_FILE);
+        remove(AD_CHECK_OVERLAP_FILE);
+    } else {
+        ad_checkThat(false, "could not write %s", AD_CHECK_OVERLAP_FILE);
+    }
+
+    /* "aaaa" starts two characters before where RIGHT scrolls the box to, so the hit shown first is the second one of the line */
+    out = fopen(AD_CHECK_OVERLAP_FILE, "w");
+
+    if (out != NULL) {
+        for (i = 0; i < 3 * 2 * step; i++) {
+            fputc(i >= step - 2 && i < step + 2 ? 'a' : 'b', out);
+        }
+
+        fputc('\n', out);
+        fclose(out);
+        ad_checkSetKeys(scrolledHits, AD_ARRAY_SIZE(scrolledHits), ad_checkTextScrolledHitsOnKey);
+        ad_textFileBox("Text Box Check", AD_CHECK_OVERLAP_FILE);
+        remove(AD_CHECK_OVERLAP_FILE);
+    } else {
+        ad_checkThat(false, "could not write %s", AD_CHECK_OVERLAP_FILE);
+    }
+
+    /* The second line with hits is further down than the box reaches, and the box can be scrolled down to it */
+    out = fopen(AD_CHECK_OVERLAP_FILE, "w");
+
+    if (out != NULL) {
+        for (i = 0; i < 3 * rows + 5; i++) {
+            if (i == 0) {
+                fprintf(out, "aaa first\n");
+            } else if (i == rows + 5) {
+                fprintf(out, "aaa second\n");
+            } else {
+                fprintf(out, "line %lu\n", (unsigned long) i);
+            }
+        }
+
+        fclose(out);
+        ad_checkSetKeys(next, AD_ARRAY_SIZE(next), ad_checkTextNextOnKey);
+        ad_textFileBox("Text Box Check", AD_CHECK_OVERLAP_FILE);
+        remove(AD_CHECK_OVERLAP_FILE);
+    } else {
+        ad_checkThat(false, "could not write %s", AD_CHECK_OVERLAP_FILE);
+    }
+
+    ad_checkTextFindBackward();
+
+    ad_checkSetKeys(NULL, 0, NULL);
+    ret = ad_textFileBox("Text Box Check", "adcheck.does.not.exist");
+    ad_checkThat(ret == AD_ERROR, "text box: missing file returned %ld instead of AD_ERROR", (long) ret);
+
+    remove(AD_CHECK_TEXT_FILE);
+}
+
+/* Scrolling sideways and wrapping lines that are three boxes wide, and a last one that is longer than the whole box */
+
+#define AD_CHECK_WIDE_LINES         40          /* Plus the long one */
+#define AD_CHECK_WIDE_NEEDLE        12          /* Characters searched for in the long line */
+
+static size_t   s_wideWidth;
+static size_t   s_wideX;
+static int      s_wideY;
+
+/* Nothing repeats within a line, so any part of it can only be shown from one column */
+static char ad_checkWideChar(size_t line, size_t column) {
+    uint32_t x = (uint32_t) line * 2654435761UL ^ (uint32_t) column * 40503UL;
+
+    x ^= x >> 13;
+    x *= 0x5BD1E995UL;
+    x ^= x >> 15;
+    return (char) ('a' + x % 26);
+}
+
+/* Rows the long last line takes up when wrapped, more than twice the box. Its last row isn't full. */
+static size_t ad_checkWideLongRows(void) {
+    return 2 * (size_t) ad_objectGetMaximumContentHeight() + 6;
+}
+
+/* Row of the long line that the needle starts in, further down than the box reaches from the start of the line.
+   It goes on in the next row. */
+static size_t ad_checkWideNeedleRow(void) {
+    return (size_t) ad_objectGetMaximumContentHeight() + 2;
+}
+
+static size_t ad_checkWideNeedleColumn(void) {
+    return (ad_checkWideNeedleRow() + 1) * s_wideWidth - AD_CHECK_WIDE_NEEDLE / 2;
+}
+
+/* Whether <count> cells of row <y> from column <x> of the box on are highlighted */
+static bool ad_checkWideHighlighted(int y, size_t x, size_t count) {
+    const ad_Char  *cells   = ad_halMemoryGetCells(s_mem);
+    size_t          i;
+
+    for (i = 0; i < count; i++) {
+        if (y < 0 || cells[(size_t) y * AD_CHECK_WIDTH + s_wideX + x + i].color.bg != ad_s_con.objectFg) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static size_t ad_checkWideLength(size_t line) {
+    return line < AD_CHECK_WIDE_LINES ? 3 * s_wideWidth : (ad_checkWideLongRows() - 1) * s_wideWidth + 7;
+}
+
+/* Checks that row <y> shows <length> characters of line <line> from <column> on, followed by "..." if <cropped> */
+static void ad_checkWideRow(int y, size_t line, size_t column, size_t length, bool cropped, const char *what) {
+    char    row[AD_CHECK_WIDTH + 1];
+    char    expected[AD_CHECK_WIDTH + 4];
+    size_t  i;
+
+    for (i = 0; i < length; i++) {
+        expected[i] = ad_checkWideChar(line, column + i);
+    }
+
+    strcpy(&expected[length], cropped ? "..." : "");
+
+    ad_halMemoryGetRowText(s_mem, (uint16_t) y, row, sizeof(row));
+    ad_checkThat(y >= 0 && strstr(row, expected) != NULL, "text box %s: row %d doesn't show line %lu from column %lu on",
+        what, y, (unsigned long) line, (unsigned long) column);
+}
+
+static void ad_checkTextWideOnKey(size_t index) {
+    /* RIGHT RIGHT LEFT w DOWN UP END HOME / <needle> ENTER ENTER */
+    size_t  width   = s_wideWidth;
+    size_t  step    = width / 2;
+    int     rows    = (int) ad_objectGetMaximumContentHeight();
+    size_t  last    = AD_CHECK_WIDE_LINES;
+    size_t  end     = (ad_checkWideLongRows() - 1) * width;
+    char    start[AD_CHECK_WIDTH + 1];
+    size_t  i;
+
+    switch (index) {
+        case 0: for (i = 0; i < width - 3; i++) start[i] = ad_checkWideChar(0, i);
+                start[width - 3] = 0x00;
+                s_wideY = ad_checkFindRow(start, &s_wideX);
+                ad_checkWideRow(s_wideY, 0, 0, width - 3, true, "at the start");             break;
+        case 1: ad_checkWideRow(s_wideY, 0, step, width - 3, true, "after RIGHT");
+                ad_checkWideRow(s_wideY + 1, 1, step, width - 3, true, "after RIGHT");      break;
+        case 2: ad_checkWideRow(s_wideY, 0, 2 * step, width - 3, true, "after RIGHT RIGHT"); break;
+        case 3: ad_checkWideRow(s_wideY, 0, step, width - 3, true, "after LEFT");           break;
+        case 4: ad_checkWideRow(s_wideY, 0, 0, width, false, "wrapped");
+                ad_checkWideRow(s_wideY + 1, 0, width, width, false, "wrapped");
+                ad_checkWideRow(s_wideY + 2, 0, 2 * width, width, false, "wrapped");
+                ad_checkWideRow(s_wideY + 3, 1, 0, width, false, "wrapped");                break;
+        case 5: ad_checkWideRow(s_wideY, 0, width, width, false, "wrapped after DOWN");
+                ad_checkWideRow(s_wideY + 2, 1, 0, width, false, "wrapped after DOWN");     break;
+        case 6: ad_checkWideRow(s_wideY, 0, 0, width, false, "wrapped after UP");          break;
+        /* The end of the long line is at the bottom, not its start at the top */
+        case 7: ad_checkWideRow(s_wideY + rows - 1, last, end, 7, false, "wrapped after END");
+                ad_checkWideRow(s_wideY, last, end - (size_t) (rows - 1) * width, width, false, "wrapped after END"); break;
+        /* The row with the hit is at the top, not the start of its line, and the hit is highlighted in both rows it is in */
+        case 9 + AD_CHECK_WIDE_NEEDLE + 1:
+                ad_checkWideRow(s_wideY, last, ad_checkWideNeedleRow() * width, width, false, "wrapped after searching");
+                ad_checkThat(ad_checkWideHighlighted(s_wideY, width - AD_CHECK_WIDE_NEEDLE / 2, AD_CHECK_WIDE_NEEDLE / 2)
+                          && ad_checkWideHighlighted(s_wideY + 1, 0, AD_CHECK_WIDE_NEEDLE - AD_CHECK_WIDE_NEEDLE / 2),
+                    "text box wrapped: hit that goes on in the next row isn't highlighted in both");
+                ad_checkThat(ad_checkFooterHas("1 found"), "text box wrapped: footer doesn't show the hit count"); break;
+        default:                                                                            break;
+    }
+}
+
+static void ad_checkTextWide(void) {
+    static const uint32_t moves[] = { AD_KEY_RIGHT, AD_KEY_RIGHT, AD_KEY_LEFT, 'w', AD_KEY_DOWN, AD_KEY_UP, AD_KEY_END, AD_KEY_HOME, '/' };
+    uint32_t    keys[AD_ARRAY_SIZE(moves) + AD_CHECK_WIDE_NEEDLE + 2];
+    FILE       *out = fopen(AD_CHECK_TEXT_FILE, "wb");
+    size_t      i;
+    size_t      j;
+
+    if (out == NULL) {
+        ad_checkThat(false, "could not write %s", AD_CHECK_TEXT_FILE);
+        return;
+    }
+
+    /* More lines than the box has rows, so it is as wide as it gets */
+    s_wideWidth = ad_objectGetMaximumContentWidth();
+
+    for (i = 0; i <= AD_CHECK_WIDE_LINES; i++) {
+        for (j = 0; j < ad_checkWideLength(i); j++) {
+            fputc(ad_checkWideChar(i, j), out);
+        }
+
+        fputc('\n', out);
+    }
+
+    fclose(out);
+
+    memcpy(keys, moves, sizeof(moves));
+
+    for (i = 0; i < AD_CHECK_WIDE_NEEDLE; i++) {
+        keys[AD_ARRAY_SIZE(moves) + i] = (uint32_t) ad_checkWideChar(AD_CHECK_WIDE_LINES, ad_checkWideNeedleColumn() + i);
+    }
+
+    keys[AD_ARRAY_SIZE(keys) - 2] = AD_KEY_ENTER;
+    keys[AD_ARRAY_SIZE(keys) - 1] = AD_KEY_ENTER;
+
+    ad_checkSaveBackground();
+    ad_checkSetKeys(keys, AD_ARRAY_SIZE(keys), ad_checkTextWideOnKey);
+    ad_textFileBox("Text Box Check", AD_CHECK_TEXT_FILE);
+    ad_checkThat(s_keysRead == AD_ARRAY_SIZE(keys), "text box wide: read %lu keys instead of %lu", (unsigned long) s_keysRead, (unsigned long) AD_ARRAY_SIZE(keys));
+    ad_checkBackgroundRestored("text box wide");
+
+    remove(AD_CHECK_TEXT_FILE);
+}
+
+/* Going to lines and places in files with more lines than the checkpoints are apart */
+
+#define AD_CHECK_BIG_LINES          10000
+#define AD_CHECK_CHECKPOINT_LINES   8193        /* The last line is the third checkpoint */
+
+/* What the box has to show before the key <key> is handed out */
+typedef struct {
+    size_t  key;
+    size_t  top;
+    char    footer[AD_CHECK_WIDTH];
+} ad_CheckTextExpect;
+
+static ad_CheckTextExpect   s_textExpect[4];
+static size_t               s_textExpectCount;
+static const char          *s_textWhat;
+
+static void ad_checkTextExpect(size_t key, size_t top, const char *footer) {
+    s_textExpect[s_textExpectCount].key = key;
+    s_textExpect[s_textExpectCount].top = top;
+    strcpy(s_textExpect[s_textExpectCount].footer, footer);
+    s_textExpectCount++;
+}
+
+static void ad_checkTextExpectOnKey(size_t index) {
+    char    what[AD_CHECK_WIDTH];
+    size_t  i;
+
+    for (i = 0; i < s_textExpectCount; i++) {
+        if (s_textExpect[i].key == index) {
+            sprintf(what, "%s, key %lu", s_textWhat, (unsigned long) index);
+            ad_checkTextLines(s_textExpect[i].top, what);
+            ad_checkThat(ad_checkFooterHas(s_textExpect[i].footer), "text box %s: footer doesn't show \"%s\"", what, s_textExpect[i].footer);
+        }
+    }
+}
+
+static void ad_checkTextRunExpected(const char *fileName, const uint32_t *keys, size_t count) {
+    ad_checkSetKeys(keys, count, ad_checkTextExpectOnKey);
+    ad_textFileBox("Text Box Check", fileName);
+    ad_checkThat(s_keysRead == count, "text box %s: read %lu keys instead of %lu", s_textWhat, (unsigned long) s_keysRead, (unsigned long) count);
+    s_textExpectCount = 0;
+}
+
+static void ad_checkTextGoToFile(size_t lines, bool lastBreak) {
+    static const uint32_t jumps[]   = { ':', '5', '0', '0', '0', AD_KEY_ENTER, ':', '5', '0', '%', AD_KEY_ENTER, ':', '9', '9', '9', '9', '9', AD_KEY_ENTER, AD_KEY_ENTER };
+    static const uint32_t end[]     = { AD_KEY_END, ':', '9', '9', '9', '9', '9', AD_KEY_ENTER, AD_KEY_ENTER };
+    char            footer[AD_CHECK_WIDTH];
+    char            what[AD_CHECK_WIDTH];
+    size_t          rows    = ad_objectGetMaximumContentHeight();
+    ad_FileOffset   size    = (ad_FileOffset) lines * (AD_CHECK_LINE_LENGTH + 1) - (lastBreak ? 0 : 1);
+    size_t          half    = (size_t) ((size / 100 * 50 + size % 100 * 50 / 100) / (AD_CHECK_LINE_LENGTH + 1));
+    ad_TextView    *view;
+    bool            complete;
+    size_t          line;
+
+    if (!ad_checkWriteTextFile(AD_CHECK_TEXT_FILE, lines, lastBreak)) {
+        ad_checkThat(false, "could not write %s", AD_CHECK_TEXT_FILE);
+        return;
+    }
+
+    sprintf(what, "with %lu lines%s", (unsigned long) lines, lastBreak ? "" : " and no last line break");
+    s_textWhat = what;
+
+    /* :5000, :50% and going past the end, which leaves the last lines on the screen and all of them counted */
+    ad_checkTextExpect(6, 4999, "Line 5000 of ");
+    sprintf(footer, "Line %lu of ", (unsigned long) half + 1);
+    ad_checkTextExpect(11, half, footer);
+    sprintf(footer, "Line %lu of %lu", (unsigned long) (lines - rows + 1), (unsigned long) lines);
+    ad_checkTextExpect(18, lines - rows, footer);
+    ad_checkTextRunExpected(AD_CHECK_TEXT_FILE, jumps, AD_ARRAY_SIZE(jumps));
+
+    /* END doesn't count lines, that only happens when going past the end afterwards */
+    ad_checkTextExpect(1, lines - rows, "into the file");
+    ad_checkTextExpect(8, lines - rows, footer);
+    ad_checkTextRunExpected(AD_CHECK_TEXT_FILE, end, AD_ARRAY_SIZE(end));
+
+    /* The same, straight on the view: the last line is found through the checkpoints, without indexing */
+    view = ad_textViewOpen(AD_CHECK_TEXT_FILE, false);
+
+    if (view != NULL) {
+        ad_checkThat(ad_textViewIndexTo(view, lines - 1) && !ad_textViewIndexTo(view, lines), "text view %s: last line not found", what);
+        ad_checkThat(ad_textViewGetLineCount(view, &complete) == lines && complete, "text view %s: %lu lines counted instead of %lu",
+            what, (unsigned long) ad_textViewGetLineCount(view, NULL), (unsigned long) lines);
+        ad_checkThat(ad_textViewGetLineStart(view, lines - 1) == (ad_FileOffset) (lines - 1) * (AD_CHECK_LINE_LENGTH + 1), "text view %s: last line starts elsewhere", what);
+        ad_checkThat(ad_textViewLookupLine(view, (ad_FileOffset) (lines - 2) * (AD_CHECK_LINE_LENGTH + 1), &line) && line == lines - 2,
+            "text view %s: line before the last one looked up wrong", what);
+        ad_textViewClose(view);
+    } else {
+        ad_checkThat(false, "text view %s: could not open", what);
+    }
+
+    remove(AD_CHECK_TEXT_FILE);
+}
+
+static void ad_checkTextGoTo(void) {
+    ad_checkTextGoToFile(AD_CHECK_BIG_LINES, true);
+    ad_checkTextGoToFile(AD_CHECK_BIG_LINES, false);
+    ad_checkTextGoToFile(AD_CHECK_CHECKPOINT_LINES, true);
+    ad_checkTextGoToFile(AD_CHECK_CHECKPOINT_LINES, false);
+}
+
+#if defined(AD_HAL_HAS_THREADS)
+
+/* Background indexing, which only happens for files of more than two 1 MB chunks */
+
+#define AD_CHECK_BIG_FILE           "adcheck3.txt"
+#define AD_CHECK_BACKGROUND_LINES   20000
+
+/* Mostly short lines, but some go across one chunk boundary or more */
+static size_t ad_checkBackgroundLineLength(size_t line) {
+    switch (line) {
+        case 1000:  return 700000;
+        case 5000:  return 1500000;
+        case 9000:  return 300000;
+        default:    return line * 131 % 200;
+    }
+}
+
+static void ad_checkBackgroundIndexing(void) {
+    ad_FileOffset  *offsets = malloc(AD_CHECK_BACKGROUND_LINES * sizeof(ad_FileOffset));
+    FILE           *out     = fopen(AD_CHECK_BIG_FILE, "wb");
+    ad_FileOffset   pos     = 0;
+    size_t          longest = 0;
+    size_t          count;
+    bool            complete;
+    ad_TextView    *view;
+    size_t          i;
+    size_t          j;
+
+    if (offsets == NULL || out == NULL) {
+        ad_checkThat(false, "could not write %s", AD_CHECK_BIG_FILE);
+        free(offsets);
+        if (out != NULL) fclose(out);
+        return;
+    }
+
+    for (i = 0; i < AD_CHECK_BACKGROUND_LINES; i++) {
+        size_t length = ad_checkBackgroundLineLength(i);
+
+        for (j = 0; j < length; j++) {
+            fputc('a' + (int) ((i + j) % 26), out);
+        }
+
+        fputc('\n', out);
+        offsets[i] = pos;
+        pos += length + 1;
+        longest = AD_MAX(longest, length);
+    }
+
+    fclose(out);
+
+    view = ad_textViewOpen(AD_CHECK_BIG_FILE, false);
+
+    if (view != NULL) {
+        ad_checkThat(ad_textViewIndexInBackground(view), "background indexing: not started");
+
+        while (ad_textViewIsIndexing(view)) {
+            ad_textViewUpdate(view);
+        }
+
+        count = ad_textViewGetLineCount(view, &complete);
+        ad_checkThat(count == AD_CHECK_BACKGROUND_LINES && complete, "background indexing: %lu lines instead of %lu",
+            (unsigned long) count, (unsigned long) AD_CHECK_BACKGROUND_LINES);
+        ad_checkThat(ad_textViewGetLongestLine(view) == longest, "background indexing: longest line is %lu instead of %lu",
+            (unsigned long) ad_textViewGetLongestLine(view), (unsigned long) longest);
+
+        /* Every 97th line, and the ones around the long lines */
+        for (i = 0; i < AD_CHECK_BACKGROUND_LINES; i++) {
+            if ((i % 97 == 0 || ad_checkBackgroundLineLength(i > 0 ? i - 1 : 0) > 1000 || ad_checkBackgroundLineLength(i) > 1000)
+                && ad_textViewGetLineStart(view, i) != offsets[i]) {
+                ad_checkThat(false, "background indexing: line %lu starts at %lu instead of %lu",
+                    (unsigned long) i, (unsigned long) ad_textViewGetLineStart(view, i), (unsigned long) offsets[i]);
+                break;
+            }
+        }
+
+        ad_textViewClose(view);
+    } else {
+        ad_checkThat(false, "background indexing: could not open %s", AD_CHECK_BIG_FILE);
+    }
+
+    free(offsets);
+    remove(AD_CHECK_BIG_FILE);
+}
+
+#endif
+
+#if defined(AD_HAL_HAS_MMAP)
+
+/* Following a file (not possible on DOS) */
+
+/* Appends lines <from> up to <to> to the text file */
+static void ad_checkAppendLines(size_t from, size_t to) {
+    FILE   *out = fopen(AD_CHECK_TEXT_FILE, "ab");
+    char    text[AD_CHECK_LINE_LENGTH + 1];
+
+    if (out == NULL) {
+        ad_checkThat(false, "could not append to %s", AD_CHECK_TEXT_FILE);
+        return;
+    }
+
+    for (; from < to; from++) {
+        ad_checkLineText(from, text);
+        fprintf(out, "%s\n", text);
+    }
+
+    fclose(out);
+}
+
+/* A mapped file that gets cut short can only be taken in again once nothing else reads it */
+static void ad_checkTruncatedView(void) {
+    ad_TextView        *view;
+    ad_TextViewChange   change;
+    size_t              length;
+
+    if (!ad_checkWriteTextFile(AD_CHECK_TEXT_FILE, 1000, true) || (view = ad_textViewOpen(AD_CHECK_TEXT_FILE, false)) == NULL) {
+        ad_checkThat(false, "truncating: could not open %s", AD_CHECK_TEXT_FILE);
+        return;
+    }
+
+    ad_textViewIndexTo(view, 1000);
+    ad_checkWriteTextFile(AD_CHECK_TEXT_FILE, 3, true);
+    change = ad_textViewCheckFile(view, false);
+    ad_checkThat(change == AD_TEXT_VIEW_BLOCKED, "truncating: gave %d while the data may not move", (int) change);
+    change = ad_textViewCheckFile(view, true);
+    ad_checkThat(change == AD_TEXT_VIEW_RELOADED, "truncating: gave %d instead of reloading", (int) change);
+    ad_checkThat(ad_textViewGetLine(view, 900, &length) == NULL && ad_textViewGetLine(view, 2, &length) != NULL,
+        "truncating: lines of the file as it was still there");
+
+    ad_textViewClose(view);
+    remove(AD_CHECK_TEXT_FILE);
+}
+
+static void ad_checkFollowView(void) {
+    ad_TextView        *view;
+    ad_TextViewChange   change;
+    bool                complete;
+    size_t              count;
+
+    if (!ad_checkWriteTextFile(AD_CHECK_TEXT_FILE, 10, true) || (view = ad_textViewOpen(AD_CHECK_TEXT_FILE, true)) == NULL) {
+        ad_checkThat(false, "follow: could not open %s", AD_CHECK_TEXT_FILE);
+        return;
+    }
+
+    ad_textViewIndexTo(view, 100);
+    ad_checkThat(ad_textViewGetLineCount(view, NULL) == 10, "follow: %lu lines to begin with instead of 10", (unsigned long) ad_textViewGetLineCount(view, NULL));
+
+    /* Appended lines get indexed right away, as the index was complete */
+    ad_checkAppendLines(10, 15);
+    change = ad_textViewCheckFile(view, true);
+    ad_checkThat(change == AD_TEXT_VIEW_GREW || change == AD_TEXT_VIEW_REMAPPED, "follow: appending gave %d", (int) change);
+    count = ad_textViewGetLineCount(view, &complete);
+    ad_checkThat(count == 15 && complete, "follow: %lu lines after appending instead of 15", (unsigned long) count);
+    ad_checkThat(ad_textViewGetLineStart(view, 14) == 14 * (AD_CHECK_LINE_LENGTH + 1), "follow: appended line starts elsewhere");
+    ad_checkThat(ad_textViewCheckFile(view, true) == AD_TEXT_VIEW_UNCHANGED, "follow: changed without anything appended");
+
+    /* A truncated file is only taken in again once nothing else reads the data */
+    ad_checkWriteTextFile(AD_CHECK_TEXT_FILE, 3, true);
+    change = ad_textViewCheckFile(view, false);
+    ad_checkThat(change == AD_TEXT_VIEW_BLOCKED, "follow: truncating gave %d while the data may not move", (int) change);
+    change = ad_textViewCheckFile(view, true);
+    ad_checkThat(change == AD_TEXT_VIEW_RELOADED, "follow: truncating gave %d instead of reloading", (int) change);
+    ad_textViewIndexTo(view, 100);
+    count = ad_textViewGetLineCount(view, &complete);
+    ad_checkThat(count == 3 && complete, "follow: %lu lines after truncating instead of 3", (unsigned long) count);
+
+    ad_textViewClose(view);
+    remove(AD_CHECK_TEXT_FILE);
+}
+
+static void ad_checkFollowBoxOnKey(size_t index) {
+    /* DOWN HOME DOWN ENTER, lines are appended before the first and the third key. The box takes all the room there is. */
+    switch (index) {
+        case 0: ad_checkTextLines(0, "following");
+                ad_checkAppendLines(10, 50);                                                    break;
+        case 1: ad_checkTextLines(50 - ad_objectGetMaximumContentHeight(), "following after appending at the end");
+                ad_checkThat(ad_checkFooterHas("of 50"), "text box: footer doesn't show the appended lines"); break;
+        case 2: ad_checkTextLines(0, "following after HOME");
+                ad_checkAppendLines(50, 60);                                                    break;
+        case 3: ad_checkTextLines(1, "following after appending further down");                 break;
+        default:                                                                                break;
+    }
+}
+
+static void ad_checkFollow(void) {
+    static const uint32_t keys[] = { AD_KEY_DOWN, AD_KEY_HOME, AD_KEY_DOWN, AD_KEY_ENTER };
+
+    ad_checkTruncatedView();
+    ad_checkFollowView();
+
+    /* The box scrolls along while the end of the file is on the screen, and stays put otherwise */
+    if (!ad_checkWriteTextFile(AD_CHECK_TEXT_FILE, 10, true)) {
+        ad_checkThat(false, "could not write %s", AD_CHECK_TEXT_FILE);
+        return;
+    }
+
+    ad_checkSaveBackground();
+    ad_checkSetKeys(keys, AD_ARRAY_SIZE(keys), ad_checkFollowBoxOnKey);
+    s_keysReady = true;
+    ad_textFileBoxFollow("Follow Check", AD_CHECK_TEXT_FILE);
+    s_keysReady = false;
+    ad_checkThat(s_keysRead == AD_ARRAY_SIZE(keys), "text box following: read %lu keys instead of %lu", (unsigned long) s_keysRead, (unsigned long) AD_ARRAY_SIZE(keys));
+    ad_checkBackgroundRestored("text box following");
+
+    remove(AD_CHECK_TEXT_FILE);
+}
+
+/* Line index cache */
+
+#define AD_CHECK_CACHE_LINES    1000
+
+/* Same name ad_cache.c gives the cache file, so it can be tampered with */
+static void ad_checkCachePath(char *dst, const ad_FileKey *key) {
+    sprintf(dst, "./%08lx%08lx-%08lx%08lx.adx",
+        (unsigned long) (key->device >> 32), (unsigned long) (key->device & 0xFFFFFFFFUL),
+        (unsigned long) (key->inode >> 32), (unsigned long) (key->inode & 0xFFFFFFFFUL));
+}
+
+/* Overwrites the cache file from <at> on with <count> bytes of <bytes> */
+static bool ad_checkCachePatch(const ad_FileKey *key, long at, const uint8_t *bytes, size_t count) {
+    char    path[64];
+    FILE   *file;
+    bool    ok;
+
+    ad_checkCachePath(path, key);
+    file = fopen(path, "r+b");
+    AD_RETURN_ON_NULL(file, false);
+
+    ok = fseek(file, at, at < 0 ? SEEK_END : SEEK_SET) == 0 && fwrite(bytes, 1, count, file) == count;
+    return (fclose(file) == 0) && ok;
+}
+
+/* Loads the cache for <key>, which has to be rejected unless <valid> */
+static void ad_checkCacheLoad(const ad_FileKey *key, const ad_FileOffset *offsets, size_t longestLine, bool valid, const char *what) {
+    ad_FileOffset  *loaded      = NULL;
+    size_t          count       = 0;
+    size_t          longest     = 0;
+    bool            ok          = ad_lineCacheLoad(".", key, &loaded, &count, &longest);
+
+    if (!valid) {
+        ad_checkThat(!ok, "line cache: %s not rejected", what);
+    } else if (!ok) {
+        ad_checkThat(false, "line cache: %s not loaded", what);
+    } else {
+        ad_checkThat(count == AD_CHECK_CACHE_LINES, "line cache: %s has %lu lines instead of %lu", what, (unsigned long) count, (unsigned long) AD_CHECK_CACHE_LINES);
+        ad_checkThat(longest == longestLine, "line cache: %s has a longest line of %lu instead of %lu", what, (unsigned long) longest, (unsigned long) longestLine);
+        ad_checkThat(count != AD_CHECK_CACHE_LINES || memcmp(loaded, offsets, count * sizeof(ad_FileOffset)) == 0, "line cache: %s has other line starts", what);
+    }
+
+    free(loaded);
+}
+
+static void ad_checkLineCache(void) {
+    static ad_FileOffset    offsets[AD_CHECK_CACHE_LINES];
+    ad_FileKey              key;
+    ad_FileKey              other;
+    uint8_t                 bytes[8];
+    char                    path[64];
+    size_t                  longest = 0;
+    size_t                  i;
+
+    /* Some lines are longer than 127 characters, their starts take more than one byte */
+    offsets[0] = 0;
+
+    for (i = 1; i < AD_CHECK_CACHE_LINES; i++) {
+        offsets[i] = offsets[i - 1] + 1 + (ad_FileOffset) (i * 37 % 300);
+        longest = AD_MAX(longest, (size_t) (offsets[i] - offsets[i - 1] - 1));
+    }
+
+    key.device = 0xADC4EC;
+    key.inode = 0x123456789ULL;
+    key.size = offsets[AD_CHECK_CACHE_LINES - 1] + 10;
+    key.mtime = 42;
+
+    ad_checkThat(ad_lineCacheStore(".", &key, offsets, AD_CHECK_CACHE_LINES, longest), "line cache: could not store");
+    ad_checkCacheLoad(&key, offsets, longest, true, "stored index");
+
+    other = key;
+    other.size++;
+    ad_checkCacheLoad(&other, offsets, longest, false, "other size");
+
+    other = key;
+    other.mtime++;
+    ad_checkCacheLoad(&other, offsets, longest, false, "other modification time");
+
+    /* The first line start (38) is a single byte, as a 0 it would not be after a line break */
+    bytes[0] = 0x00;
+    ad_checkThat(ad_checkCachePatch(&key, 64, bytes, 1), "line cache: could not patch");
+    ad_checkCacheLoad(&key, offsets, longest, false, "line start of 0");
+
+    /* The last line start is cut off in the middle */
+    ad_lineCacheStore(".", &key, offsets, AD_CHECK_CACHE_LINES, longest);
+    bytes[0] = 0x80;
+    ad_checkThat(ad_checkCachePatch(&key, -1, bytes, 1), "line cache: could not patch");
+    ad_checkCacheLoad(&key, offsets, longest, false, "cut off line start");
+
+    /* A line longer than the whole file */
+    ad_lineCacheStore(".", &key, offsets, AD_CHECK_CACHE_LINES, longest);
+
+    for (i = 0; i < 8; i++) {
+        bytes[i] = (uint8_t) ((key.size + 1) >> (8 * i));
+    }
+
+    ad_checkThat(ad_checkCachePatch(&key, 48, bytes, 8), "line cache: could not patch");
+    ad_checkCacheLoad(&key, offsets, longest, false, "longest line past the file size");
+
+    ad_checkCachePath(path, &key);
+    remove(path);
+}
+
+#endif
+
+/* Progress bars */
+
+#define AD_CHECK_BAR_CHAR       '#'
+#define AD_CHECK_BAR_BLANK      COLOR_GRAY
+#define AD_CHECK_BAR_FILL       COLOR_GREEN
+
+/* Cells of the bar in row <y> that are filled, <width> gets how many it has in all. The bar colors are only used for bars. */
+static size_t ad_checkBarFill(int y, size_t *width) {
+    const ad_Char  *cells   = ad_halMemoryGetCells(s_mem);
+    size_t          filled  = 0;
+    size_t          x;
+
+    *width = 0;
+
+    for (x = 0; y >= 0 && x < AD_CHECK_WIDTH; x++) {
+        const ad_Char *cell = &cells[(size_t) y * AD_CHECK_WIDTH + x];
+
+        if (cell->ascii == AD_CHECK_BAR_CHAR && (cell->color.bg == AD_CHECK_BAR_FILL || cell->color.bg == AD_CHECK_BAR_BLANK)) {
+            filled += cell->color.bg == AD_CHECK_BAR_FILL ? 1 : 0;
+            (*width)++;
+        }
+    }
+
+    return filled;
+}
+
+/* Checks that <filled> of <width> cells is <progress> out of <outOf>, rounded */
+static void ad_checkBarFilled(size_t filled, size_t width, uint32_t progress, uint32_t outOf, const char *label, const char *what) {
+    size_t expected = (2 * width * progress + outOf) / (2 * (size_t) outOf);
+
+    ad_checkThat(width > 0 && filled == expected, "progress %s: bar \"%s\" has %lu of %lu cells filled instead of %lu",
+        what, label, (unsigned long) filled, (unsigned long) width, (unsigned long) expected);
+}
+
+/* Checks that the bar in the row with <label> is filled <progress> out of <outOf> on the screen */
+static void ad_checkBar(const char *label, uint32_t progress, uint32_t outOf, const char *what) {
+    size_t width;
+    size_t filled = ad_checkBarFill(ad_checkFindRow(label, NULL), &width);
+
+    ad_checkBarFilled(filled, width, progress, outOf, label, what);
+}
+
+/* The bar in row s_barRow as it was in the last frame that showed it, a box may be gone from the screen by the time it is looked at */
+static void   (*s_memFlush)(ad_Hal *hal);
+static int      s_barRow;
+static size_t   s_barFilled;
+static size_t   s_barWidth;
+
+static void ad_checkBarFlush(ad_Hal *hal) {
+    size_t width;
+    size_t filled;
+
+    s_memFlush(hal);
+    filled = ad_checkBarFill(s_barRow, &width);
+
+    if (width > 0) {
+        s_barFilled = filled;
+        s_barWidth = width;
+    }
+}
+
+/* Waits until <ms> milliseconds have passed since <start> */
+static void ad_checkWaitUntil(uint32_t start, uint32_t ms) {
+    while (ad_getMilliseconds() - start < ms) {
+    }
+}
+
+/* With a refresh rate, values in between are only recorded. The screen catches up once the interval has passed,
+   on ad_progressBoxRefresh and at the latest when the box is destroyed. */
+#define AD_CHECK_REFRESH_RATE   5           /* Times per second */
+#define AD_CHECK_REFRESH_MS     (1000 / AD_CHECK_REFRESH_RATE)
+
+static void ad_checkRefreshRate(void) {
+    ad_ProgressBox *pb = ad_progressBoxMultiCreate("Progress Check", "%u times a second", (unsigned) AD_CHECK_REFRESH_RATE);
+    uint32_t        start;
+
+    if (pb == NULL) {
+        ad_checkThat(false, "progress rate: could not create the box");
+        return;
+    }
+
+    ad_progressBoxSetCharAndColor(AD_CHECK_BAR_CHAR, AD_CHECK_BAR_BLANK, COLOR_BLACK, AD_CHECK_BAR_FILL, COLOR_BLACK);
+    ad_progressBoxAddItem(pb, "Rated", 100);
+    ad_progressBoxAddItem(pb, "Last", 100);
+    ad_progressBoxPaint(pb);
+    ad_progressBoxSetRefreshRate(pb, AD_CHECK_REFRESH_RATE);
+
+    /* The interval starts with a refresh, so what comes right after it is held back */
+    ad_progressBoxRefresh(pb);
+    start = ad_getMilliseconds();
+    ad_progressBoxMultiUpdate(pb, 0, 25);
+
+    if (ad_getMilliseconds() - start < AD_CHECK_REFRESH_MS) {
+        ad_checkBar("Rated", 0, 100, "rate, update right after a refresh");
+    }
+
+    ad_checkWaitUntil(start, AD_CHECK_REFRESH_MS);
+    ad_progressBoxMultiUpdate(pb, 0, 50);
+    ad_checkBar("Rated", 50, 100, "rate, update after the interval");
+
+    start = ad_getMilliseconds();
+    ad_progressBoxMultiUpdate(pb, 0, 60);
+
+    if (ad_getMilliseconds() - start < AD_CHECK_REFRESH_MS) {
+        ad_checkBar("Rated", 50, 100, "rate, update within the interval");
+    }
+
+    ad_progressBoxRefresh(pb);
+    ad_checkBar("Rated", 60, 100, "rate, after ad_progressBoxRefresh");
+
+    /* Held back until the box goes */
+    start = ad_getMilliseconds();
+    ad_progressBoxMultiUpdate(pb, 1, 75);
+    s_barRow = ad_checkFindRow("Last", NULL);
+
+    if (ad_getMilliseconds() - start < AD_CHECK_REFRESH_MS) {
+        ad_checkBar("Last", 0, 100, "rate, update within the interval");
+    }
+
+    s_memFlush = s_mem->flush;
+    s_mem->flush = ad_checkBarFlush;
+    s_barWidth = 0;
+
+    ad_progressBoxDestroy(pb);
+
+    s_mem->flush = s_memFlush;
+    ad_checkBarFilled(s_barFilled, s_barWidth, 75, 100, "Last", "rate, when the box is destroyed");
+}
+
+#if defined(AD_HAL_HAS_THREADS) && defined(AD_HAS_ATOMICS)
+
+/* Progress published from worker threads */
+
+#define AD_CHECK_PUBLISHERS     4
+#define AD_CHECK_PUBLISH_STEPS  100000
+
+typedef struct {
+    ad_ProgressBox *pb;
+    size_t          worker;
+} ad_CheckPublisher;
+
+static ad_AtomicU32 s_publishersGo;
+static ad_AtomicU32 s_publishersDone;
+
+/* All of them add to the first bar, one of them also sets the others. They start together, so they get in each other's way. */
+AD_THREAD_FUNC(ad_checkPublishThread, arg) {
+    ad_CheckPublisher  *publisher = (ad_CheckPublisher *) arg;
+    size_t              i;
+
+    while (ad_atomicLoadAcquire(&s_publishersGo) == 0) {
+    }
+
+    for (i = 0; i < AD_CHECK_PUBLISH_STEPS; i++) {
+        ad_progressBoxPublishAdd(publisher->pb, 0, 1);
+
+        if (publisher->worker == 0 && i == AD_CHECK_PUBLISH_STEPS / 2) {
+            ad_progressBoxPublishMaxProgress(publisher->pb, 1, 400);
+            ad_progressBoxPublish(publisher->pb, 1, 100);
+            ad_progressBoxPublish(publisher->pb, 2, 50);
+        }
+    }
+
+    ad_atomicAdd(&s_publishersDone, 1);
+    AD_THREAD_RETURN;
+}
+
+/* The UI thread samples while the workers publish. Once they are done, one more sample draws exactly what they published. */
+static void ad_checkPublish(void) {
+    ad_CheckPublisher   publishers[AD_CHECK_PUBLISHERS];
+    ad_Thread           threads[AD_CHECK_PUBLISHERS];
+    bool                started[AD_CHECK_PUBLISHERS];
+    ad_ProgressBox     *pb = ad_progressBoxMultiCreate("Progress Check", "Published from %u threads", (unsigned) AD_CHECK_PUBLISHERS);
+    size_t              i;
+
+    if (pb == NULL) {
+        ad_checkThat(false, "progress published: could not create the box");
+        return;
+    }
+
+    ad_progressBoxSetCharAndColor(AD_CHECK_BAR_CHAR, AD_CHECK_BAR_BLANK, COLOR_BLACK, AD_CHECK_BAR_FILL, COLOR_BLACK);
+    ad_progressBoxAddItem(pb, "Added", 2 * AD_CHECK_PUBLISHERS * AD_CHECK_PUBLISH_STEPS);
+    ad_progressBoxAddItem(pb, "Set", 100);
+    ad_progressBoxAddItem(pb, "Full", 50);
+    ad_progressBoxPaint(pb);
+
+    ad_atomicStore(&s_publishersGo, 0);
+    ad_atomicStore(&s_publishersDone, 0);
+
+    for (i = 0; i < AD_CHECK_PUBLISHERS; i++) {
+        publishers[i].pb = pb;
+        publishers[i].worker = i;
+        started[i] = ad_threadStart(&threads[i], ad_checkPublishThread, &publishers[i]);
+
+        if (!started[i]) {
+            ad_checkThat(false, "progress published: could not start thread %lu", (unsigned long) i);
+            ad_atomicAdd(&s_publishersDone, 1);
+        }
+    }
+
+    ad_atomicStoreRelease(&s_publishersGo, 1);
+
+    while (ad_atomicLoadAcquire(&s_publishersDone) < AD_CHECK_PUBLISHERS) {
+        ad_progressBoxSample(pb);
+    }
+
+    for (i = 0; i < AD_CHECK_PUBLISHERS; i++) {
+        if (started[i]) {
+            ad_threadJoin(threads[i]);
+        }
+    }
+
+    ad_progressBoxSample(pb);
+    ad_checkBar("Added", AD_CHECK_PUBLISHERS * AD_CHECK_PUBLISH_STEPS, 2 * AD_CHECK_PUBLISHERS * AD_CHECK_PUBLISH_STEPS, "published");
+    ad_checkBar("Set", 100, 400, "published");
+    ad_checkBar("Full", 50, 50, "published");
+
+    ad_progressBoxDestroy(pb);
+}
+
+#endif
+
+/* Frames drawn on contexts of their own */
+
+#define AD_CHECK_FRAMES         40
+
+/* Text that scrolls up by a row from one frame to the next, each row in a color of its own, so the renderer moves rows */
+static void ad_checkFrame(size_t frame) {
+    char        text[AD_CHECK_WIDTH];
+    uint16_t    y;
+
+    for (y = 2; y < AD_CHECK_HEIGHT - 1; y++) {
+        sprintf(text, "Burger number %lu", (unsigned long) (frame + y));
+        ad_displayStringCropped(text, 2, y, AD_CHECK_WIDTH - 4, (uint8_t) ((frame + y) % 8), COLOR_WHITE);
+    }
+
+    ad_present();
+}
+
+/* Draws the same frames on the current context, with a restore halfway through */
+static void ad_checkFrames(void) {
+    size_t i;
+
+    for (i = 0; i < AD_CHECK_FRAMES; i++) {
+        if (i == AD_CHECK_FRAMES / 2) {
+            ad_restore();
+        }
+
+        ad_checkFrame(i);
+    }
+}
+
+/* Creates a context that draws through <hal> and makes it the current one */
+static ad_Context *ad_checkContextOn(ad_Hal *hal, const char *title) {
+    ad_Context *ctx = hal != NULL ? ad_contextCreate() : NULL;
+
+    if (ctx != NULL) {
+        ad_contextInit(ctx, title, hal);
+        ad_contextMakeCurrent(ctx);
+    }
+
+    return ctx;
+}
+
+static bool ad_checkSameScreen(ad_Hal *a, ad_Hal *b) {
+    return memcmp(ad_halMemoryGetCells(a), ad_halMemoryGetCells(b), AD_CHECK_WIDTH * AD_CHECK_HEIGHT * sizeof(ad_Char)) == 0;
+}
+
+#if defined(AD_HAL_HAS_THREADS) && defined(AD_HAS_ATOMICS)
+
+/* Render thread */
+
+/* Like a console that something else wrote all over while it was handed over, so everything has to be drawn again */
+static void ad_checkAsyncRestoreConsole(ad_Hal *hal) {
+    uint16_t y;
+
+    hal->setColor(hal, 0, 7);
+
+    for (y = 0; y < AD_CHECK_HEIGHT; y++) {
+        hal->setCursorPosition(hal, 0, y);
+        hal->putChar(hal, '#', AD_CHECK_WIDTH);
+    }
+}
+
+/* Whatever the render thread skipped or reordered, once it is stopped the screen is the same as without it */
+static void ad_checkAsync(void) {
+    static const ad_AsyncPolicy policies[] = { AD_ASYNC_BLOCK, AD_ASYNC_DROP_FRAMES };
+    static const char          *names[]    = { "BLOCK", "DROP_FRAMES" };
+    ad_Hal     *syncHal     = ad_halMemoryCreate(AD_CHECK_WIDTH, AD_CHECK_HEIGHT);
+    ad_Hal     *asyncHal    = ad_halMemoryCreate(AD_CHECK_WIDTH, AD_CHECK_HEIGHT);
+    ad_Context *syncCtx;
+    ad_Context *asyncCtx;
+    size_t      i;
+
+    if (syncHal != NULL && asyncHal != NULL) {
+        syncHal->restoreConsole = ad_checkAsyncRestoreConsole;
+        asyncHal->restoreConsole = ad_checkAsyncRestoreConsole;
+    }
+
+    syncCtx = ad_checkContextOn(syncHal, "AnbUI Render Thread Check");
+    asyncCtx = ad_checkContextOn(asyncHal, "AnbUI Render Thread Check");
+
+    if (syncCtx == NULL || asyncCtx == NULL) {
+        ad_checkThat(false, "render thread: could not create the contexts");
+    } else {
+        /* Both policies on the same context, one render thread after the other */
+        for (i = 0; i < AD_ARRAY_SIZE(policies); i++) {
+            ad_contextMakeCurrent(syncCtx);
+            ad_checkFrames();
+
+            ad_contextMakeCurrent(asyncCtx);
+            ad_checkThat(ad_asyncStart(policies[i], 2), "render thread: %s didn't start", names[i]);
+            ad_checkFrames();
+            ad_asyncStop();
+
+            ad_checkThat(ad_checkSameScreen(syncHal, asyncHal), "render thread: screen with %s differs from the one drawn without it", names[i]);
+        }
+    }
+
+    ad_contextMakeCurrent(NULL);
+    ad_contextDestroy(asyncCtx);
+    ad_contextDestroy(syncCtx);
+    ad_halDestroy(asyncHal);
+    ad_halDestroy(syncHal);
+}
+
+#endif
+
+/* HAL sinks and wrappers */
+
+/* Writes the row number into every row, so moved rows can be told apart */
+static void ad_checkSinkFill(ad_Hal *hal) {
+    char        text[AD_CHECK_WIDTH];
+    uint16_t    y;
+
+    hal->setColor(hal, 1, 7);
+
+    for (y = 0; y < AD_CHECK_HEIGHT; y++) {
+        sprintf(text, "row %u", (unsigned) y);
+        hal->setCursorPosition(hal, 0, y);
+        hal->putString(hal, text);
+    }
+}
+
+/* A mirror only scrolls if both sides can, otherwise neither is touched and the rows get redrawn on both */
+static void ad_checkSinkMirrorScroll(void) {
+    ad_Hal *screen      = ad_halMemoryCreate(AD_CHECK_WIDTH, AD_CHECK_HEIGHT);
+    ad_Hal *copy        = ad_halMemoryCreate(AD_CHECK_WIDTH, AD_CHECK_HEIGHT);
+    ad_Hal *expected    = ad_halMemoryCreate(AD_CHECK_WIDTH, AD_CHECK_HEIGHT);
+    ad_Hal *refusing    = ad_halRecorderCreate(NULL, AD_CHECK_WIDTH, AD_CHECK_HEIGHT);
+    ad_Hal *mirror;
+
+    if (screen == NULL || copy == NULL || expected == NULL || refusing == NULL) {
+        ad_checkThat(false, "sinks: could not create the HALs");
+    } else {
+        ad_checkSinkFill(screen);
+        ad_checkSinkFill(copy);
+        ad_checkSinkFill(expected);
+
+        /* The one that refuses can be either side */
+        mirror = ad_halMirrorCreate(screen, refusing);
+        ad_checkThat(mirror != NULL && !mirror->canScrollRows(mirror) && !mirror->scrollRows(mirror, 1, 5, 2),
+            "sinks: mirror scrolled though the mirrored HAL can't");
+        ad_checkThat(ad_checkSameScreen(screen, expected), "sinks: mirror scrolled its inner HAL though the mirrored one refused");
+        ad_halDestroy(mirror);
+
+        mirror = ad_halMirrorCreate(refusing, copy);
+        ad_checkThat(mirror != NULL && !mirror->scrollRows(mirror, 1, 5, 2), "sinks: mirror scrolled though its inner HAL can't");
+        ad_checkThat(ad_checkSameScreen(copy, expected), "sinks: mirror scrolled the mirrored HAL though the inner one refused");
+        ad_halDestroy(mirror);
+
+        mirror = ad_halMirrorCreate(screen, copy);
+        expected->scrollRows(expected, 1, 5, 2);
+        ad_checkThat(mirror != NULL && mirror->canScrollRows(mirror) && mirror->scrollRows(mirror, 1, 5, 2),
+            "sinks: mirror of two HALs that can scroll didn't");
+        ad_checkThat(ad_checkSameScreen(screen, expected) && ad_checkSameScreen(copy, expected), "sinks: mirror didn't scroll both HALs alike");
+        ad_halDestroy(mirror);
+    }
+
+    ad_halDestroy(refusing);
+    ad_halDestroy(expected);
+    ad_halDestroy(copy);
+    ad_halDestroy(screen);
+}
+
+/* Draws the frames on a context of its own that goes through <hal> */
+static void ad_checkSinkFrames(ad_Hal *hal, const char *what) {
+    ad_Context *ctx = ad_checkContextOn(hal, "AnbUI Sink Check");
+
+    if (ctx == NULL) {
+        ad_checkThat(false, "sinks: could not create a context for the %s", what);
+        return;
+    }
+
+    ad_checkFrames();
+    ad_contextMakeCurrent(NULL);
+    ad_contextDestroy(ctx);
+}
+
+/* Whether the line <text> is in the trace <trace> */
+static bool ad_checkTraceHas(FILE *trace, const char *text) {
+    char line[256];
+
+    rewind(trace);
+
+    while (fgets(line, sizeof(line), trace) != NULL) {
+        if (strncmp(line, text, strlen(text)) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Replaces <*hal> with a new in-memory HAL, so nothing left over from before can pass for what was drawn */
+static ad_Hal *ad_checkSinkScreen(ad_Hal **hal) {
+    ad_halDestroy(*hal);
+    *hal = ad_halMemoryCreate(AD_CHECK_WIDTH, AD_CHECK_HEIGHT);
+    return *hal;
+}
+
+/* What ends up on the screen through any wrapper is what ends up there without one */
+static void ad_checkSinks(void) {
+    ad_Hal             *direct      = NULL;
+    ad_Hal             *screen      = NULL;
+    ad_Hal             *copy        = NULL;
+    ad_Hal             *wrapper;
+    ad_Hal             *counter;
+    ad_HalCounters      counters;
+    ad_OutputStats      stats;
+    FILE               *trace;
+    uint32_t            start;
+    uint32_t            rate;
+
+    ad_checkSinkMirrorScroll();
+
+    if (ad_checkSinkScreen(&direct) == NULL) {
+        ad_checkThat(false, "sinks: could not create the HALs");
+        return;
+    }
+
+    ad_checkSinkFrames(direct, "in-memory HAL");
+
+    /* Recorded behind a HAL that can scroll, so rows get moved. The replay moves them the same way. */
+    wrapper = ad_halRecorderCreate(ad_checkSinkScreen(&screen), AD_CHECK_WIDTH, AD_CHECK_HEIGHT);
+    counter = ad_halCounterCreate(wrapper);
+    ad_checkSinkFrames(counter, "recorder");
+
+    if (counter != NULL && ad_checkSinkScreen(&copy) != NULL) {
+        ad_halCounterGet(counter, &counters);
+        ad_checkThat(counters.scrollRows > 0, "sinks: no rows were moved while recording");
+        ad_checkThat(ad_checkSameScreen(screen, direct), "sinks: screen behind the recorder differs");
+
+        ad_halRecorderReplay(wrapper, copy);
+        ad_checkThat(ad_checkSameScreen(copy, direct), "sinks: replayed screen differs");
+    }
+
+    ad_halDestroy(counter);
+    ad_halDestroy(wrapper);
+
+    /* Recorded without a HAL behind it, nothing can be moved, so everything is drawn */
+    wrapper = ad_halRecorderCreate(NULL, AD_CHECK_WIDTH, AD_CHECK_HEIGHT);
+    ad_checkSinkFrames(wrapper, "recorder without a HAL");
+
+    if (wrapper != NULL && ad_checkSinkScreen(&copy) != NULL) {
+        ad_halRecorderReplay(wrapper, copy);
+        ad_checkThat(ad_checkSameScreen(copy, direct), "sinks: screen replayed from a recorder without a HAL differs");
+    }
+
+    ad_halDestroy(wrapper);
+
+    /* The tracer writes down every call, moved rows as well */
+    trace = tmpfile();
+    wrapper = trace != NULL ? ad_halTracerCreate(ad_checkSinkScreen(&screen), trace) : NULL;
+    ad_checkSinkFrames(wrapper, "tracer");
+
+    if (wrapper != NULL) {
+        ad_checkThat(ad_checkSameScreen(screen, direct), "sinks: screen behind the tracer differs");
+        ad_checkThat(ad_checkTraceHas(trace, "restoreConsole") && ad_checkTraceHas(trace, "putSpan") && ad_checkTraceHas(trace, "flush"),
+            "sinks: trace is missing calls");
+        ad_checkThat(ad_checkTraceHas(trace, "scrollRows"), "sinks: trace doesn't show the moved rows");
+    }
+
+    ad_halDestroy(wrapper);
+
+    if (trace != NULL) {
+        fclose(trace);
+    }
+
+    /* The throttle takes at least as long as the bytes take at its rate, about a fifth of a second here */
+    direct->getOutputStats(direct, &stats);
+    rate = AD_MAX(stats.totalBytes, 1) * 5;
+    wrapper = ad_halThrottleCreate(ad_checkSinkScreen(&screen), rate);
+    start = ad_getMilliseconds();
+    ad_checkSinkFrames(wrapper, "throttle");
+
+    if (wrapper != NULL) {
+        ad_checkThat(ad_checkSameScreen(screen, direct), "sinks: screen behind the throttle differs");
+        ad_checkThat(ad_getMilliseconds() - start >= 150, "sinks: throttle took %lu ms for %lu bytes at %lu bytes per second",
+            (unsigned long) (ad_getMilliseconds() - start), (unsigned long) stats.totalBytes, (unsigned long) rate);
+    }
+
+    ad_halDestroy(wrapper);
+
+    /* Both sides of a mirror can scroll, so both get rows moved */
+    wrapper = ad_halMirrorCreate(ad_checkSinkScreen(&screen), ad_checkSinkScreen(&copy));
+    counter = ad_halCounterCreate(wrapper);
+    ad_checkSinkFrames(counter, "mirror");
+
+    if (counter != NULL) {
+        ad_halCounterGet(counter, &counters);
+        ad_checkThat(counters.scrollRows > 0, "sinks: no rows were moved on the mirror");
+        ad_checkThat(ad_checkSameScreen(screen, direct) && ad_checkSameScreen(copy, direct), "sinks: screens behind the mirror differ");
+    }
+
+    ad_halDestroy(counter);
+    ad_halDestroy(wrapper);
+    ad_halDestroy(copy);
+    ad_halDestroy(screen);
+    ad_halDestroy(direct);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+/* Terminal escape sequences */
+
+/* Terminal HAL writing into a pipe, so what it sends can be compared byte for byte */
+static int s_termPipe[2] = { -1, -1 };
+
+static ad_Hal *ad_checkTermCreate(void) {
+    ad_Hal *hal;
+    char    drain[256];
+
+    if (pipe(s_termPipe) != 0) {
+        return NULL;
+    }
+
+    fcntl(s_termPipe[0], F_SETFL, fcntl(s_termPipe[0], F_GETFL) | O_NONBLOCK);
+
+    hal = ad_halTerminalCreate(s_termPipe[0], s_termPipe[1]);
+
+    if (hal != NULL) {
+        ad_ConsoleConfig cfg;
+
+        ad_halTerminalSetSize(hal, AD_CHECK_WIDTH, AD_CHECK_HEIGHT);
+        hal->initConsole(hal, &cfg);
+        hal->flush(hal);
+
+        while (read(s_termPipe[0], drain, sizeof(drain)) > 0) {
+        }
+    }
+
+    return hal;
+}
+
+static void ad_checkTermDestroy(ad_Hal *hal) {
+    ad_halDestroy(hal);
+    close(s_termPipe[0]);
+    close(s_termPipe[1]);
+}
+
+/* Copies <data> into <out> with the escape characters spelled out */
+static void ad_checkTermShow(char *out, size_t size, const char *data, size_t length) {
+    size_t i;
+    size_t used = 0;
+
+    for (i = 0; i < length && used + 5 < size; i++) {
+        if (data[i] == '\033')      used += (size_t) sprintf(&out[used], "\\e");
+        else if (data[i] == '\r')   used += (size_t) sprintf(&out[used], "\\r");
+        else if (data[i] == '\n')   used += (size_t) sprintf(&out[used], "\\n");
+        else if (data[i] == '\b')   used += (size_t) sprintf(&out[used], "\\b");
+        else                        out[used++] = data[i];
+    }
+
+    out[used] = '\0';
+}
+
+/* Checks that the terminal sent exactly <expected> since the last time */
+static void ad_checkTermSent(ad_Hal *hal, const char *expected, const char *what) {
+    char    sent[256];
+    char    shownSent[256];
+    char    shownExpected[256];
+    ssize_t got;
+    size_t  length = 0;
+
+    hal->flush(hal);
+
+    while (length < sizeof(sent) && (got = read(s_termPipe[0], &sent[length], sizeof(sent) - length)) > 0) {
+        length += (size_t) got;
+    }
+
+    if (length != strlen(expected) || memcmp(sent, expected, length) != 0) {
+        ad_checkTermShow(shownSent, sizeof(shownSent), sent, length);
+        ad_checkTermShow(shownExpected, sizeof(shownExpected), expected, strlen(expected));
+        ad_checkThat(false, "terminal %s: sent \"%s\" instead of \"%s\"", what, shownSent, shownExpected);
+    }
+}
+
+/* Only what changes is sent, in a single sequence. Bold and bright colors are the same thing. */
+static void ad_checkTermStyle(void) {
+    ad_Hal *hal = ad_checkTermCreate();
+    ad_Char cells[4];
+    size_t  i;
+
+    if (hal == NULL) {
+        ad_checkThat(false, "terminal: could not create one on a pipe");
+        return;
+    }
+
+    hal->setColor(hal, COLOR_BLUE, COLOR_WHITE);
+    ad_checkTermSent(hal, "\033[0;1;44;37m", "colors, first");
+    hal->setColor(hal, COLOR_BLUE, COLOR_WHITE);
+    ad_checkTermSent(hal, "", "colors, repeated");
+    hal->setColor(hal, COLOR_BLUE, COLOR_YELLO);
+    ad_checkTermSent(hal, "\033[33m", "colors, foreground changed");
+    hal->setColor(hal, COLOR_RED, COLOR_BROWN);
+    ad_checkTermSent(hal, "\033[22;41m", "colors, background and brightness changed");
+    hal->setColor(hal, COLOR_BLACK, COLOR_LBLUE);
+    ad_checkTermSent(hal, "\033[1;40;34m", "colors, all changed");
+
+    for (i = 0; i < AD_ARRAY_SIZE(cells); i++) {
+        cells[i].ascii = (uint8_t) ('a' + i);
+        cells[i].color.bg = COLOR_BLACK;
+        cells[i].color.fg = COLOR_LBLUE;
+    }
+
+    cells[0].attr = AD_ATTR_UNDERLINE;
+    cells[1].attr = AD_ATTR_UNDERLINE | AD_ATTR_REVERSE;
+    cells[2].attr = 0;
+    cells[3].attr = AD_ATTR_BOLD;
+    cells[3].color.fg = COLOR_BLUE;
+
+    hal->setCursorPosition(hal, 0, 0);
+    ad_checkTermSent(hal, "\033[H", "span, cursor");
+    hal->putSpan(hal, cells, AD_ARRAY_SIZE(cells));
+    ad_checkTermSent(hal, "\033[4ma\033[7mb\033[24;27mcd", "span with attributes");
+
+    /* Someone else may have changed the colors in the meantime */
+    hal->restoreConsole(hal);
+    hal->setColor(hal, COLOR_BLACK, COLOR_LBLUE);
+    ad_checkTermSent(hal, "\033[?25l\033[0;1;40;34m", "colors after restoring the console");
+
+    ad_checkTermDestroy(hal);
+}
+
+/* The cursor is moved with the shortest sequence that gets it there, the absolute position is the fallback */
+static void ad_checkTermCursor(void) {
+    static const struct { uint16_t x; uint16_t y; const char *expected; const char *what; } moves[] = {
+        {  0, 0, "\033[H",          "unknown position" },
+        {  2, 0, "\033[2C",         "right" },
+        {  0, 1, "\r\n",            "start of the next row" },
+        {  0, 1, "",                "same position" },
+        { 10, 1, "\033[10C",        "right" },
+        {  9, 1, "\b",              "one left" },
+        {  3, 1, "\033[6D",         "left" },
+        { 70, 1, "\033[67C",        "far right" },
+        {  5, 1, "\033[6G",         "far left, column is shorter" },
+        {  5, 4, "\033[3B",         "down" },
+        {  7, 2, "\033[3;8H",       "up and right, absolute is shorter" },
+        {  0, 3, "\r\n",            "start of the next row from within a row" },
+        {  0, 0, "\033[H",          "home" },
+    };
+    ad_Hal *hal = ad_checkTermCreate();
+    char    what[64];
+    size_t  i;
+
+    if (hal == NULL) {
+        ad_checkThat(false, "terminal: could not create one on a pipe");
+        return;
+    }
+
+    for (i = 0; i < AD_ARRAY_SIZE(moves); i++) {
+        sprintf(what, "cursor, %s", moves[i].what);
+        hal->setCursorPosition(hal, moves[i].x, moves[i].y);
+        ad_checkTermSent(hal, moves[i].expected, what);
+    }
+
+    /* Printing moves it along, up to the end of the row where it's up to the terminal */
+    hal->putString(hal, "ab");
+    hal->setCursorPosition(hal, 0, 1);
+    ad_checkTermSent(hal, "ab\r\n", "cursor, after printing");
+
+    hal->setCursorPosition(hal, AD_CHECK_WIDTH - 2, 1);
+    hal->putChar(hal, 'x', 2);
+    hal->setCursorPosition(hal, 0, 2);
+    ad_checkTermSent(hal, "\033[78Cxx\033[3;1H", "cursor, after printing up to the end of the row");
+
+    ad_checkTermDestroy(hal);
+}
+
+#endif
+
+int main(void) {
+    s_mem = ad_halMemoryCreate(AD_CHECK_WIDTH, AD_CHECK_HEIGHT);
+    AD_RETURN_ON_NULL(s_mem, 1);
+
+    s_memGetKey = s_mem->getKey;
+    s_mem->getKey = ad_checkGetKey;
+    s_mem->waitForKey = ad_checkWaitForKey;
+
+    ad_initWithHal("AnbUI Super Burger Edition - The Checks(tm)", s_mem);
+
+    ad_checkMenu();
+    ad_checkTextFileBox();
+    ad_checkTextWide();
+    ad_checkTextGoTo();
+#if defined(AD_HAL_HAS_THREADS)
+    ad_checkBackgroundIndexing();
+#endif
+#if defined(AD_HAL_HAS_MMAP)
+    ad_checkFollow();
+    ad_checkLineCache();
+#endif
+    ad_checkRefreshRate();
+#if defined(AD_HAL_HAS_THREADS) && defined(AD_HAS_ATOMICS)
+    ad_checkPublish();
+    ad_checkAsync();
+#endif
+    ad_checkSinks();
+#if defined(__unix__) || defined(__APPLE__)
+    ad_checkTermStyle();
+    ad_checkTermCursor();
+#endif
+
+    ad_deinit();
+    ad_halDestroy(s_mem);
+
+    printf("%s: %lu check(s) failed\n", s_failures == 0 ? "OK" : "FAILED", (unsigned long) s_failures);
+    return s_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+/*
+    AnbUI Miniature Text UI Lib for Burger Enjoyers(tm)
+
+    ad_find: Searching text views
+
+    A search looks for a pattern in the file of a text view, either for
+    the next hit from some position on or for all of them to count them.
+    The file is gone through in blocks with the vectorized pattern kernel
+    (ad_bytesFind in ad_simd.c), so a search can be stopped in between.
+
+    Where there are threads, every search runs on its own, so the UI can
+    show the first hit while the hits are still being counted. Elsewhere
+    (DOS) it is done right away.
+
+    Tip of the day: The pickle is always at the bottom of the bag.
+
+    (C) 2026 E. Voirin (oerg866) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "anbui.h"
+#include "ad_priv.h"
+#include "ad_hal.h"
+#include "ad_thrd.h"
+
+#if defined(AD_HAL_HAS_THREADS) && defined(AD_HAS_ATOMICS)
+# define AD_SEARCH_BACKGROUND
+#endif
+
+/* How much is searched before checking if the search should stop */
+#define AD_SEARCH_BLOCK_SIZE    (1024UL * 1024UL)
+
+typedef enum {
+    AD_SEARCH_FORWARD = 0,
+    AD_SEARCH_BACKWARD,
+    AD_SEARCH_COUNT
+} ad_TextSearchMode;
+
+struct ad_TextSearch {
+    const char         *data;
+    ad_FileOffset       size;
+    char                pattern[AD_TEXT_ELEMENT_SIZE];
+    size_t              patternLength;
+    ad_TextSearchMode   mode;
+    ad_FileOffset       origin;
+    ad_FileOffset       hit;
+    bool                found;
+    ad_AtomicU32        hitCount;
+    ad_AtomicU32        done;               /* Written last, hit and found are valid once it is set */
+    ad_AtomicU32        stop;
+#if defined(AD_SEARCH_BACKGROUND)
+    ad_Thread           thread;
+    bool                threadStarted;
+#endif
+};
+
+/* First hit that starts in [from, to), <to> if there is none */
+static ad_FileOffset ad_textSearchForward(ad_TextSearch *search, ad_FileOffset from, ad_FileOffset to) {
+    while (from < to && !ad_atomicLoad(&search->stop)) {
+        ad_FileOffset   blockEnd    = AD_MIN(from + AD_SEARCH_BLOCK_SIZE, to);
+        /* A hit that starts in the block may end after it */
+        ad_FileOffset   scanEnd     = AD_MIN(blockEnd + search->patternLength - 1, search->size);
+        size_t          scanSize    = (size_t) (scanEnd - from);
+        size_t          pos         = ad_bytesFind(&search->data[from], scanSize, search->pattern, search->patternLength);
+
+        if (pos < scanSize) {
+            return from + pos;
+        }
+
+        from = blockEnd;
+    }
+
+    return to;
+}
+
+/* Last hit that starts in [from, to), <to> if there is none */
+static ad_FileOffset ad_textSearchBackward(ad_TextSearch *search, ad_FileOffset from, ad_FileOffset to) {
+    ad_FileOffset blockEnd = to;
+
+    while (blockEnd > from && !ad_atomicLoad(&search->stop)) {
+        ad_FileOffset   blockStart  = blockEnd - AD_MIN(AD_SEARCH_BLOCK_SIZE, blockEnd - from);
+        ad_FileOffset   last        = to;
+        ad_FileOffset   pos         = blockStart;
+
+        while ((pos = ad_textSearchForward(search, pos, blockEnd)) < blockEnd) {
+            last = pos++;
+        }
+
+        if (last != to) {
+            return last;
+        }
+
+        blockEnd = blockStart;
+    }
+
+    return to;
+}
+
+/*  Last hit that starts in [from, to) of the ones that don't overlap, <to> if there is none.
+    Patterns have no line breaks, so the hits that don't overlap are the same ones when counted from any line start on.
+    They are worked out from the start of the line with the last hit of all, that line is all that is scanned twice. */
+static ad_FileOffset ad_textSearchBackwardApart(ad_TextSearch *search, ad_FileOffset from, ad_FileOffset to) {
+    ad_FileOffset   last    = ad_textSearchBackward(search, from, to);
+    ad_FileOffset   pos     = last;
+    ad_FileOffset   hit;
+
+    if (last == to) {
+        return to;
+    }
+
+    while (pos > from && search->data[pos - 1] != '\n') {
+        pos--;
+    }
+
+    while ((hit = ad_textSearchForward(search, pos, to)) < to) {
+        last = hit;
+        pos = hit + search->patternLength;
+    }
+
+    return last;
+}
+
+static void ad_textSearchRun(ad_TextSearch *search) {
+    ad_FileOffset pos;
+
+    if (search->mode == AD_SEARCH_FORWARD) {
+        search->hit = ad_textSearchForward(search, search->origin, search->size);
+        search->found = search->hit < search->size;
+
+        if (!search->found) {
+            search->hit = ad_textSearchForward(search, 0, search->origin);
+            search->found = search->hit < search->origin;
+        }
+    } else if (search->mode == AD_SEARCH_BACKWARD) {
+        search->hit = ad_textSearchBackwardApart(search, 0, search->origin);
+        search->found = search->hit < search->origin;
+
+        if (!search->found) {
+            search->hit = ad_textSearchBackwardApart(search, search->origin, search->size);
+            search->found = search->hit < search->size;
+        }
+    } else {
+        /* Hits don't overlap, just like they are highlighted: "aa" is in "aaaa" twice */
+        for (pos = 0; (pos = ad_textSearchForward(search, pos, search->size)) < search->size; pos += search->patternLength) {
+            ad_atomicAdd(&search->hitCount, 1);
+        }
+    }
+
+    /* A search that was stopped has found nothing */
+    search->found = search->found && !ad_atomicLoad(&search->stop);
+    ad_atomicStoreRelease(&search->done, 1);
+}
+
+#if defined(AD_SEARCH_BACKGROUND)
+
+AD_THREAD_FUNC(ad_textSearchThread, arg) {
+    ad_textSearchRun((ad_TextSearch *) arg);
+    AD_THREAD_RETURN;
+}
+
+#endif
+
+static ad_TextSearch *ad_textSearchStart(ad_TextView *view, const char *pattern, size_t length, ad_TextSearchMode mode, ad_FileOffset origin) {
+    ad_TextSearch *search;
+
+    AD_RETURN_ON_NULL(view, NULL);
+    AD_RETURN_ON_NULL(pattern, NULL);
+
+    if (length == 0 || length >= AD_TEXT_ELEMENT_SIZE) {
+        return NULL;
+    }
+
+    search = calloc(1, sizeof(ad_TextSearch));
+    AD_RETURN_ON_NULL(search, NULL);
+
+    search->data = ad_textViewGetData(view, &search->size);
+    memcpy(search->pattern, pattern, length);
+    search->patternLength = length;
+    search->mode = mode;
+    search->origin = AD_MIN(origin, search->size);
+
+#if defined(AD_SEARCH_BACKGROUND)
+    search->threadStarted = ad_threadStart(&search->thread, ad_textSearchThread, search);
+
+    if (search->threadStarted) {
+        return search;
+    }
+#endif
+
+    ad_textSearchRun(search);
+    return search;
+}
+
+ad_TextSearch *ad_textSearchFind(ad_TextView *view, const char *pattern, size_t length, ad_FileOffset origin, bool backward) {
+    return ad_textSearchStart(view, pattern, length, backward ? AD_SEARCH_BACKWARD : AD_SEARCH_FORWARD, origin);
+}
+
+ad_TextSearch *ad_textSearchCount(ad_TextView *view, const char *pattern, size_t length) {
+    return ad_textSearchStart(view, pattern, length, AD_SEARCH_COUNT, 0);
+}
+
+bool ad_textSearchIsDone(ad_TextSearch *search) {
+    return search == NULL || ad_atomicLoadAcquire(&search->done) != 0;
+}
+
+bool ad_textSearchGetHit(ad_TextSearch *search, ad_FileOffset *hit) {
+    if (search == NULL || !ad_textSearchIsDone(search) || !search->found) {
+        return false;
+    }
+
+    *hit = search->hit;
+    return true;
+}
+
+uint32_t ad_textSearchGetCount(ad_TextSearch *search) {
+    return search != NULL ? (uint32_t) ad_atomicLoad(&search->hitCount) : 0;
+}
+
+void ad_textSearchWait(ad_TextSearch *search) {
+#if defined(AD_SEARCH_BACKGROUND)
+    if (search != NULL && search->threadStarted) {
+        ad_threadJoin(search->thread);
+        search->threadStarted = false;
+    }
+#else
+    AD_UNUSED_PARAMETER(search);
+#endif
+}
+
+void ad_textSearchDestroy(ad_TextSearch *search) {
+    if (search) {
+#if defined(AD_SEARCH_BACKGROUND)
+        if (search->threadStarted) {
+            ad_atomicStore(&search->stop, 1);
+            ad_threadJoin(search->thread);
+        }
+#endif
+        free(search);
+    }
+}
@@ -14,6 +14,7 @@
 #define _AD_HAL_H_
 
 #include <stdint.h>
+#include <stdio.h>
 
 #include "anbui.h"
 
@@ -21,31 +22,196 @@
 # define AD_HAL_HAS_POPEN
 #endif
 
-/* This is a set of functions that a platform implementation needs to implement */
+#if defined(__unix__) || defined(__APPLE__) || defined(_WIN32)
+# define AD_HAL_HAS_THREADS
+#endif
+
+#if defined(__unix__) || defined(__APPLE__) || defined(_WIN32)
+# define AD_HAL_HAS_MMAP
+#endif
+
+/* Cell attribute flags. Consoles that can't show an attribute ignore it, except for
+   AD_ATTR_REVERSE, which can always be done by swapping the colors (see ad_cellShownBg/Fg). */
+#define AD_ATTR_BOLD        0x01
+#define AD_ATTR_UNDERLINE   0x02
+#define AD_ATTR_REVERSE     0x04
+#define AD_ATTR_BLINK       0x08
+
+typedef struct {
+    uint8_t     fg;
+    uint8_t     bg;
+} ad_Color;
+
+/* A single character cell on the screen. Four bytes without any padding, so that rows of cells
+   can be compared and filled as 32-bit words (see ad_simd.c). */
+typedef struct {
+    uint8_t     ascii;
+    ad_Color    color;
+    uint8_t     attr;
+} ad_Char;
+
+#define ad_cellShownBg(cell) (((cell)->attr & AD_ATTR_REVERSE) ? (cell)->color.fg : (cell)->color.bg)
+#define ad_cellShownFg(cell) (((cell)->attr & AD_ATTR_REVERSE) ? (cell)->color.bg : (cell)->color.fg)
+
+/* Output statistics, used to find out how expensive drawing is */
+typedef struct {
+    uint32_t    frames;             /* Number of flushes that actually sent data */
+    uint32_t    lastFrameBytes;     /* Bytes sent by the most recent flush */
+    uint32_t    lastFrameWrites;    /* Write operations (syscalls) used by the most recent flush */
+    uint32_t    totalBytes;
+    uint32_t    totalWrites;
+} ad_OutputStats;
+
+/*  This is the set of functions that a platform implementation (or any other output sink) needs to implement.
+    Every function gets the HAL it was called on, so implementations can keep their state next to it
+    (see ad_sink.c), e.g. to wrap another HAL. */
+struct ad_Hal {
+    /* Initializes console */
+    void        (*initConsole)          (ad_Hal *hal, ad_ConsoleConfig *cfg);
+    /* Restores AnbUI console to its expected state after console was used externally */
+    void        (*restoreConsole)       (ad_Hal *hal);
+    /* Deinitializes, e.g. sets screen back to original state */
+    void        (*deinitConsole)        (ad_Hal *hal);
+
+    /* Set background and foreground color */
+    void        (*setColor)             (ad_Hal *hal, uint8_t bg, uint8_t fg);
+    /* Set cursor position */
+    void        (*setCursorPosition)    (ad_Hal *hal, uint16_t x, uint16_t y);
+    /* Flush output */
+    void        (*flush)                (ad_Hal *hal);
+    /* Get output statistics. Platforms that don't go through a byte stream report zeroes. */
+    void        (*getOutputStats)       (ad_Hal *hal, ad_OutputStats *stats);
+
+    /* Print string */
+    void        (*putString)            (ad_Hal *hal, const char *str);
+    /* Fill with character*/
+    void        (*putChar)              (ad_Hal *hal, char c, size_t count);
+    /* Print a row segment of cells at the cursor position, each cell with its own color.
+       Afterwards the current color is the one of the last cell. */
+    void        (*putSpan)              (ad_Hal *hal, const ad_Char *cells, size_t count);
+    /* Move the contents of rows top..bottom-1 up by <lines> rows (down if negative). The rows that become
+       free have unknown contents afterwards, as does the cursor position. Returns false if the console can't do this. */
+    bool        (*scrollRows)           (ad_Hal *hal, uint16_t top, uint16_t bottom, int lines);
+    /* Whether scrollRows would work, without doing anything. HALs that send everything to two places ask both before either scrolls. */
+    bool        (*canScrollRows)        (ad_Hal *hal);
 
-/* Initializes console */
-void        hal_initConsole         (ad_ConsoleConfig *cfg);
-/* Restores AnbUI console to its expected state after console was used externally */
-void        hal_restoreConsole      (void);
-/* Deinitializes, e.g. sets screen back to original state */
-void        hal_deinitConsole       (void);
+    /* Get key. Special keys need to return the codes specified in anbui_priv.h */
+    uint32_t    (*getKey)               (ad_Hal *hal);
+    /* Waits up to <milliseconds> for a key without reading it, returns false if none came.
+       HALs that can't wait for a key return true, getKey then simply blocks. */
+    bool        (*waitForKey)           (ad_Hal *hal, uint32_t milliseconds);
+
+    /* Frees the HAL (and whatever it owns). NULL for HALs that aren't allocated, like the platform one. */
+    void        (*destroy)              (ad_Hal *hal);
+};
+
+/* The platform's own console HAL, implemented by the pl_*.c file that gets linked in */
+extern ad_Hal hal_platform;
+
+/* The HAL that is in use is the one of the current context (ad_s_hal, see ad_priv.h), selected by ad_init / ad_initWithHal */
+#define hal_initConsole(cfg)            (ad_s_hal->initConsole(ad_s_hal, (cfg)))
+#define hal_restoreConsole()            (ad_s_hal->restoreConsole(ad_s_hal))
+#define hal_deinitConsole()             (ad_s_hal->deinitConsole(ad_s_hal))
+#define hal_setColor(bg, fg)            (ad_s_hal->setColor(ad_s_hal, (bg), (fg)))
+#define hal_setCursorPosition(x, y)     (ad_s_hal->setCursorPosition(ad_s_hal, (x), (y)))
+#define hal_flush()                     (ad_s_hal->flush(ad_s_hal))
+#define hal_getOutputStats(stats)       (ad_s_hal->getOutputStats(ad_s_hal, (stats)))
+#define hal_putString(str)              (ad_s_hal->putString(ad_s_hal, (str)))
+#define hal_putChar(c, count)           (ad_s_hal->putChar(ad_s_hal, (c), (count)))
+#define hal_putSpan(cells, count)       (ad_s_hal->putSpan(ad_s_hal, (cells), (count)))
+#define hal_getKey()                    (ad_s_hal->getKey(ad_s_hal))
+#define hal_waitForKey(ms)              (ad_s_hal->waitForKey(ad_s_hal, (ms)))
+
+/* Frees a HAL created by one of the functions below. Does nothing for the platform HAL. */
+void        ad_halDestroy               (ad_Hal *hal);
+
+/*  Sink that throws all output away. Reports a console of the given size,
+    getKey always returns AD_KEY_ENTER so that all UI components eventually return. */
+ad_Hal     *ad_halNullCreate            (uint16_t width, uint16_t height);
+
+/* Call counters of a counting HAL wrapper */
+typedef struct {
+    uint32_t    setColor;
+    uint32_t    setCursorPosition;
+    uint32_t    flush;
+    uint32_t    putString;
+    uint32_t    putChar;
+    uint32_t    putSpan;
+    uint32_t    scrollRows;
+    uint32_t    getKey;
+    uint32_t    cells;              /* Characters printed through putString/putChar/putSpan */
+} ad_HalCounters;
+
+/*  Wrapper that counts the calls going to <inner> and the characters printed through it.
+    Byte/write statistics are taken from <inner>. */
+ad_Hal     *ad_halCounterCreate         (ad_Hal *inner);
+void        ad_halCounterGet            (ad_Hal *counter, ad_HalCounters *counters);
+void        ad_halCounterReset          (ad_Hal *counter);
+
+/*  Wrapper that writes a line describing every call going to <inner> into <out> */
+ad_Hal     *ad_halTracerCreate          (ad_Hal *inner, FILE *out);
+
+/*  Wrapper that records every output call going to <inner>, so it can be replayed on another HAL later.
+    <inner> may be NULL, which makes the recorder a sink of the given size. */
+ad_Hal     *ad_halRecorderCreate        (ad_Hal *inner, uint16_t width, uint16_t height);
+/*  Sends all recorded output calls to <target> */
+void        ad_halRecorderReplay        (ad_Hal *recorder, ad_Hal *target);
+
+/*  Wrapper that limits the output of <inner> to the given amount of bytes per second by waiting after flushes.
+    Useful to see how things behave on a slow serial line. Needs an <inner> that reports output statistics. */
+ad_Hal     *ad_halThrottleCreate        (ad_Hal *inner, uint32_t bytesPerSecond);
+
+/*  Wrapper that sends all output going to <inner> to <mirror> as well, e.g. to see what a terminal would get
+    for what is drawn on the in-memory HAL. Console size, keys and output statistics are the ones of <inner>. */
+ad_Hal     *ad_halMirrorCreate          (ad_Hal *inner, ad_Hal *mirror);
+
+#if defined(__unix__) || defined(__APPLE__)
+/*  Terminal on the given file descriptors, e.g. a pty, for driving more than one terminal at once.
+    The platform HAL is the one on stdin / stdout. */
+ad_Hal     *ad_halTerminalCreate        (int inFd, int outFd);
+/*  Size the terminal reports if its output can't be asked for one (a pipe, a file, /dev/null) */
+void        ad_halTerminalSetSize       (ad_Hal *hal, uint16_t width, uint16_t height);
+#endif
 
-/* Set background and foreground color */
-void        hal_setColor            (uint8_t bg, uint8_t fg);
-/* Set cursor position */
-void        hal_setCursorPosition   (uint16_t x, uint16_t y);
-/* Flush output */
-void        hal_flush               (void);
+/*  Headless console that renders into a cell array in memory (see ad_memfb.c).
+    Keys come from a script. Once it runs out, getKey returns AD_KEY_ENTER so that all UI components eventually return.
+    Output statistics count the bytes written into the cell array. */
+ad_Hal     *ad_halMemoryCreate          (uint16_t width, uint16_t height);
+/*  Sets the key script, the keys are copied. */
+bool        ad_halMemorySetKeys         (ad_Hal *mem, const uint32_t *keys, size_t count);
+/*  Loads the key script from a text file. Keys are separated by whitespace and are either
+    a key name (ESC ENTER PGUP PGDN HOME END UP DOWN LEFT RIGHT SPACE BACKSPACE F1..F12), a single character
+    or a hex number (0x..). '#' starts a comment that goes until the end of the line. */
+bool        ad_halMemoryLoadKeyFile     (ad_Hal *mem, const char *fileName);
+/*  Number of script keys that haven't been read yet */
+size_t      ad_halMemoryKeysLeft        (ad_Hal *mem);
+/*  Screen contents, width * height cells, row by row. Cells never written to are 0x00. */
+const ad_Char *ad_halMemoryGetCells     (ad_Hal *mem);
+/*  Copies the characters of a screen row into <dst> as a null-terminated string */
+bool        ad_halMemoryGetRowText      (ad_Hal *mem, uint16_t y, char *dst, size_t dstSize);
 
-/* Print formatted string (printf-style) */
-void        hal_print               (const char *format, ...);
-/* Print string */
-void        hal_putString           (const char *str);
-/* Fill with character*/
-void        hal_putChar             (char c, size_t count);
+/*  Frame presentation (ad_state.c): Sends the cells of <back> that differ from <front> to <hal>
+    and updates <front> accordingly. */
+void        ad_presentBuffer            (ad_Hal *hal, const ad_Char *back, ad_Char *front);
+/*  Callers may change the front buffer, so all rows get compared again on the next ad_present */
+ad_Char    *ad_screenGetFront           (void);
+size_t      ad_screenGetCellCount       (void);
 
-/* Get key. Special keys need to return the codes specified in anbui_priv.h */
-uint32_t    hal_getKey              (void);
+/*  Cell row kernels (ad_simd.c), vectorized where the compiler targets SSE2 or AVX2 */
+/*  Index of the first cell that differs between <a> and <b>, <count> if there is none */
+size_t      ad_cellsFirstDiff           (const ad_Char *a, const ad_Char *b, size_t count);
+/*  Index after the last cell that differs between <a> and <b>, 0 if there is none */
+size_t      ad_cellsLastDiff            (const ad_Char *a, const ad_Char *b, size_t count);
+void        ad_cellsFill                (ad_Char *dst, ad_Char cell, size_t count);
+/*  Hash of a row of cells, for finding rows that moved */
+uint32_t    ad_cellsHash                (const ad_Char *cells, size_t count);
+/*  Name of the kernel set in use ("AVX2", "SSE2" or "scalar") */
+const char *ad_cellsKernelName          (void);
 
+/*  Render thread (ad_async.c). These return false if it isn't running, the caller then does it itself. */
+bool        ad_asyncSubmitFrame         (const ad_Char *cells);
+bool        ad_asyncRestoreConsole      (void);
+/*  Stops the render thread and frees everything it had */
+void        ad_asyncRelease             (void);
 
 #endif
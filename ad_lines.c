@@ -0,0 +1,1334 @@
+/*
+    AnbUI Miniature Text UI Lib for Burger Enjoyers(tm)
+
+    ad_lines: Text file views
+
+    The file is mapped into memory where the platform can do that, so
+    opening it costs next to nothing no matter how big it is, and only
+    the parts that are looked at ever get read. Elsewhere (DOS) it is
+    read into memory as a whole.
+
+    Lines get indexed lazily: the index only ever goes as far as the
+    furthest line anyone asked for.
+
+    Where there are threads, a big file can instead be indexed in the
+    background: it is cut into chunks that worker threads look for line
+    breaks in, each into its own offset array. The owner of the view
+    takes the chunks over in file order as they get done, so the start
+    of the file can be shown while the rest is still being worked on.
+
+    A followed file (tail -f) is watched for data appended to it, through
+    inotify where there is one and by looking at its size otherwise. Only
+    what was appended gets indexed. It is mapped with room to spare after
+    its end, so whatever gets appended shows up in the mapping without
+    anything having to be read or mapped again. On Windows, where a
+    mapping would keep others from cutting the file short, it is read into
+    memory instead, with some room to grow in place.
+
+    Lines the index doesn't reach yet are looked up through checkpoints,
+    the start of every 4096th line. Those are found by counting line
+    breaks, which is a lot quicker than writing down every line, and from
+    the nearest one it's never more than 4095 lines to go. That way any
+    line of a big file can be shown right away, while the index is still
+    being built (or never gets built at all). Going to the end or to some
+    offset in the file doesn't even need that: the line there is found by
+    scanning back to its start (ad_textViewLineStartAt), and its number
+    is only looked up once the index or the checkpoints reach it.
+
+    The index of a big file can be kept in a cache (ad_cache.c), so the
+    next time the file is shown, none of this has to happen at all.
+
+    Tip of the day: Nobody reads the whole menu. Find the burger
+    section and stop there.
+
+    (C) 2026 E. Voirin (oerg866) */
+
+#if defined(__unix__) || defined(__APPLE__)
+# define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "anbui.h"
+#include "ad_priv.h"
+#include "ad_hal.h"
+#include "ad_thrd.h"
+
+#if defined(_WIN32)
+# include <windows.h>
+#elif defined(AD_HAL_HAS_MMAP)
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <fcntl.h>
+# include <unistd.h>
+# if defined(__linux__)
+#  include <sys/inotify.h>
+# endif
+#endif
+
+/* Every this many lines there's a checkpoint */
+#define AD_LINES_CHECKPOINT_INTERVAL 4096
+
+/* Smaller files are indexed quicker than a cache file is looked up */
+#define AD_LINES_CACHE_MIN_SIZE (1024UL * 1024UL)
+
+#if defined(AD_HAL_HAS_THREADS) && defined(AD_HAS_ATOMICS)
+# define AD_LINES_BACKGROUND
+#endif
+
+#if defined(AD_LINES_BACKGROUND)
+
+/* Each worker takes one chunk at a time. Files smaller than two of them aren't worth the threads. */
+#define AD_LINES_CHUNK_SIZE     (1024UL * 1024UL)
+#define AD_LINES_MAX_WORKERS    8
+
+typedef enum {
+    AD_LINES_CHUNK_PENDING = 0,
+    AD_LINES_CHUNK_DONE,
+    AD_LINES_CHUNK_FAILED
+} ad_TextChunkState;
+
+typedef struct {
+    ad_FileOffset  *offsets;            /* Starts of the lines that begin within the chunk */
+    size_t          count;
+    size_t          longestLine;        /* Of the lines that also end within the chunk */
+    ad_AtomicU32    state;              /* ad_TextChunkState, written by the worker last */
+} ad_TextChunk;
+
+typedef struct {
+    ad_Thread           thread;
+    struct ad_TextView *view;
+    uint32_t            index;
+} ad_TextWorker;
+
+/* Worker n does chunks n, n + workerCount, ... so the start of the file gets done first */
+typedef struct {
+    ad_TextChunk   *chunks;
+    uint32_t        chunkCount;
+    uint32_t        chunksMerged;       /* Chunks taken over into the view's index so far */
+    bool            failed;             /* Out of memory, the index ends before the chunk that failed */
+    ad_TextWorker   workers[AD_LINES_MAX_WORKERS];
+    uint32_t        workerCount;
+    uint32_t        threadCount;        /* Workers that were actually started */
+    ad_AtomicU32    stop;
+} ad_TextIndexer;
+
+#endif
+
+struct ad_TextView {
+    const char     *data;               /* The mapping, or the buffer */
+    ad_FileOffset   size;
+    char           *buffer;             /* Whole file, read in (on DOS, and while following on Windows) */
+    size_t          bufferSize;         /* Size of the file plus room to grow when following */
+#if defined(_WIN32)
+    HANDLE          file;
+    HANDLE          mapping;
+#elif defined(AD_HAL_HAS_MMAP)
+    int             fd;
+    int             notifyFd;           /* inotify, -1 if the size has to be polled */
+    size_t          mapSize;            /* Size of the file, plus room to grow when following */
+#endif
+    bool            following;
+    bool            followPending;      /* The file changed, but that couldn't be taken in yet */
+    ad_FileOffset  *lineOffsets;        /* Start of each line found so far */
+    size_t          lineCount;
+    size_t          lineCapacity;
+    ad_FileOffset   scanPos;            /* Where indexing goes on */
+    bool            complete;           /* Whole file is indexed */
+    size_t          longestLine;        /* Of the lines indexed so far */
+    ad_FileOffset  *checkpoints;        /* Start of every AD_LINES_CHECKPOINT_INTERVALth line, for lines past the index */
+    size_t          checkpointCount;
+    size_t          checkpointCapacity;
+    size_t          seekLine;           /* Last line looked up through a checkpoint, it starts at seekOffset */
+    ad_FileOffset   seekOffset;
+    size_t          lastLine;           /* Found while looking past the index, only valid if lastLineKnown */
+    bool            lastLineKnown;
+    ad_FileKey      key;                /* The file as it was opened, for the line index cache */
+    bool            hasKey;
+    bool            cached;             /* The index came from the cache */
+#if defined(AD_LINES_BACKGROUND)
+    ad_TextIndexer *indexer;
+#endif
+};
+
+#if defined(_WIN32) || defined(AD_HAL_HAS_MMAP)
+
+/* Buffer room kept after the end of a followed file, so it can grow that much without the data moving.
+   Half the file size, within these limits. */
+#define AD_LINES_FOLLOW_ROOM        (1024UL * 1024UL)
+#define AD_LINES_FOLLOW_MAX_ROOM    (64UL * 1024UL * 1024UL)
+
+static bool ad_textViewReadIn(ad_TextView *view, ad_FileOffset from, ad_FileOffset size);
+
+#endif
+
+#if defined(_WIN32)
+
+static bool ad_textViewMap(ad_TextView *view, const char *fileName) {
+    BY_HANDLE_FILE_INFORMATION  info;
+    LARGE_INTEGER               size;
+
+    view->file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (view->file == INVALID_HANDLE_VALUE) {
+        view->file = NULL;
+        return false;
+    }
+
+    /* A followed file may still be empty */
+    if (!GetFileSizeEx(view->file, &size) || size.QuadPart < 0 || (size.QuadPart == 0 && !view->following)
+        || (uint64_t) size.QuadPart > (uint64_t) SIZE_MAX) {
+        return false;
+    }
+
+    view->size = (ad_FileOffset) size.QuadPart;
+
+    if (GetFileInformationByHandle(view->file, &info)) {
+        view->key.device    = info.dwVolumeSerialNumber;
+        view->key.inode     = ((ad_FileOffset) info.nFileIndexHigh << 32) | info.nFileIndexLow;
+        view->key.size      = view->size;
+        view->key.mtime     = ((ad_FileOffset) info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime;
+        view->hasKey        = true;
+    }
+
+    if (view->following) {
+        return ad_textViewReadIn(view, 0, view->size);
+    }
+
+    view->mapping = CreateFileMappingA(view->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    AD_RETURN_ON_NULL(view->mapping, false);
+
+    view->data = MapViewOfFile(view->mapping, FILE_MAP_READ, 0, 0, 0);
+    return view->data != NULL;
+}
+
+static void ad_textViewUnmap(ad_TextView *view) {
+    if (view->mapping != NULL)  UnmapViewOfFile(view->data);
+    if (view->mapping != NULL)  CloseHandle(view->mapping);
+    if (view->file != NULL)     CloseHandle(view->file);
+}
+
+static bool ad_textViewGetFileSize(ad_TextView *view, ad_FileOffset *size) {
+    LARGE_INTEGER fileSize;
+
+    if (!GetFileSizeEx(view->file, &fileSize) || fileSize.QuadPart < 0 || (uint64_t) fileSize.QuadPart > (uint64_t) SIZE_MAX) {
+        return false;
+    }
+
+    *size = (ad_FileOffset) fileSize.QuadPart;
+    return true;
+}
+
+/* Windows doesn't let a mapped file get shorter */
+static bool ad_textViewTruncated(ad_TextView *view) {
+    AD_UNUSED_PARAMETER(view);
+    return false;
+}
+
+static bool ad_textViewReadMapped(ad_TextView *view) {
+    AD_UNUSED_PARAMETER(view);
+    return false;
+}
+
+/* Data can grow up to this size without moving */
+static size_t ad_textViewFollowRoom(const ad_TextView *view) {
+    return view->bufferSize;
+}
+
+/* Takes in a followed file that is <size> bytes now, of which those from <from> on are new */
+static bool ad_textViewFollowTo(ad_TextView *view, ad_FileOffset from, ad_FileOffset size) {
+    return ad_textViewReadIn(view, from, size);
+}
+
+/* Nothing to be notified by here, so all there is to do is look at the size */
+static bool ad_textViewNotified(ad_TextView *view) {
+    AD_UNUSED_PARAMETER(view);
+    return true;
+}
+
+/* Reads up to <length> bytes from <offset> on. Returns how many there were. */
+static size_t ad_textViewReadAt(ad_TextView *view, char *dst, ad_FileOffset offset, size_t length) {
+    size_t done = 0;
+
+    while (done < length) {
+        OVERLAPPED  at;
+        DWORD       got     = 0;
+        DWORD       chunk   = (DWORD) AD_MIN(length - done, 0x40000000UL);
+
+        memset(&at, 0, sizeof(at));
+        at.Offset       = (DWORD) (offset + done);
+        at.OffsetHigh   = (DWORD) ((offset + done) >> 32);
+
+        if (!ReadFile(view->file, &dst[done], chunk, &got, &at) || got == 0) {
+            break;
+        }
+
+        done += got;
+    }
+
+    return done;
+}
+
+#elif defined(AD_HAL_HAS_MMAP)
+
+/* Modification time in nanoseconds where stat has them, a file rewritten within the same second would look unchanged otherwise */
+#if defined(__APPLE__)
+# define AD_LINES_STAT_MTIME(st) ((ad_FileOffset) (st).st_mtimespec.tv_sec * 1000000000U + (ad_FileOffset) (st).st_mtimespec.tv_nsec)
+#elif defined(__linux__) && defined(st_mtime)       /* st_mtime is a macro for st_mtim.tv_sec when there is st_mtim */
+# define AD_LINES_STAT_MTIME(st) ((ad_FileOffset) (st).st_mtim.tv_sec * 1000000000U + (ad_FileOffset) (st).st_mtim.tv_nsec)
+#else
+# define AD_LINES_STAT_MTIME(st) ((ad_FileOffset) (st).st_mtime)
+#endif
+
+static bool ad_textViewMapSize(ad_TextView *view, ad_FileOffset size) {
+    void *data = mmap(NULL, (size_t) size, PROT_READ, MAP_PRIVATE, view->fd, 0);
+
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    view->data = data;
+    view->size = size;
+    view->mapSize = (size_t) size;
+    return true;
+}
+
+/*  Address space kept mapped after the end of a followed file. Pages past the end of the file are never touched,
+    they only start to count once data gets appended there. */
+#define AD_LINES_FOLLOW_MAP_ROOM    (sizeof(size_t) > 4 ? 1024UL * 1024UL * 1024UL : 64UL * 1024UL * 1024UL)
+
+/*  Maps a followed file with room to grow. The mapping is shared, so it shows whatever is written to the file
+    afterwards. On failure, the old mapping stays. */
+static bool ad_textViewMapFollowed(ad_TextView *view, ad_FileOffset size) {
+    size_t  mapSize;
+    void   *data;
+
+    if ((uint64_t) size > (uint64_t) (SIZE_MAX - AD_LINES_FOLLOW_MAP_ROOM)) {
+        return false;
+    }
+
+    mapSize = (size_t) size + AD_LINES_FOLLOW_MAP_ROOM;
+    data = mmap(NULL, mapSize, PROT_READ, MAP_SHARED, view->fd, 0);
+
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    if (view->mapSize > 0) {
+        munmap((void *) view->data, view->mapSize);
+    }
+
+    view->data = data;
+    view->size = size;
+    view->mapSize = mapSize;
+    return true;
+}
+
+/* Data can grow up to this size without moving */
+static size_t ad_textViewFollowRoom(const ad_TextView *view) {
+    return view->mapSize;
+}
+
+/* Takes in a followed file that is <size> bytes now. Within the mapping, there's nothing to do but to go by the new size. */
+static bool ad_textViewFollowTo(ad_TextView *view, ad_FileOffset from, ad_FileOffset size) {
+    AD_UNUSED_PARAMETER(from);
+
+    if ((uint64_t) size <= (uint64_t) view->mapSize) {
+        view->size = size;
+        return true;
+    }
+
+    return ad_textViewMapFollowed(view, size);
+}
+
+static bool ad_textViewMap(ad_TextView *view, const char *fileName) {
+    struct stat st;
+    bool        ok;
+
+    view->notifyFd = -1;
+    view->fd = open(fileName, O_RDONLY);
+
+    if (view->fd < 0) {
+        return false;
+    }
+
+    /* A followed file may still be empty */
+    ok = fstat(view->fd, &st) == 0
+        && (st.st_size > 0 || view->following)
+        && (uint64_t) st.st_size <= (uint64_t) SIZE_MAX
+        && (view->following ? ad_textViewMapFollowed(view, (ad_FileOffset) st.st_size) : ad_textViewMapSize(view, (ad_FileOffset) st.st_size));
+
+    if (ok) {
+        view->key.device    = (ad_FileOffset) st.st_dev;
+        view->key.inode     = (ad_FileOffset) st.st_ino;
+        view->key.size      = (ad_FileOffset) st.st_size;
+        view->key.mtime     = AD_LINES_STAT_MTIME(st);
+        view->hasKey        = true;
+    }
+
+#if defined(__linux__)
+    if (ok && view->following) {
+        view->notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+        if (view->notifyFd >= 0 && inotify_add_watch(view->notifyFd, fileName, IN_MODIFY) < 0) {
+            close(view->notifyFd);
+            view->notifyFd = -1;
+        }
+    }
+#endif
+
+    /* Stays open, to see if something cuts the mapped file short (ad_textViewTruncated) */
+    if (!ok) {
+        close(view->fd);
+        view->fd = -1;
+    }
+
+    return ok;
+}
+
+static void ad_textViewUnmap(ad_TextView *view) {
+    if (view->mapSize > 0)      munmap((void *) view->data, view->mapSize);
+    if (view->fd >= 0)          close(view->fd);
+    if (view->notifyFd >= 0)    close(view->notifyFd);
+}
+
+static bool ad_textViewGetFileSize(ad_TextView *view, ad_FileOffset *size) {
+    struct stat st;
+
+    if (fstat(view->fd, &st) != 0 || st.st_size < 0 || (uint64_t) st.st_size > (uint64_t) SIZE_MAX) {
+        return false;
+    }
+
+    *size = (ad_FileOffset) st.st_size;
+    return true;
+}
+
+/* Returns true if the file might have changed since the last call. Without inotify that's always the case. */
+static bool ad_textViewNotified(ad_TextView *view) {
+#if defined(__linux__)
+    char    events[4096];
+    bool    notified = false;
+
+    if (view->notifyFd < 0) {
+        return true;
+    }
+
+    while (read(view->notifyFd, events, sizeof(events)) > 0) {
+        notified = true;
+    }
+
+    return notified;
+#else
+    AD_UNUSED_PARAMETER(view);
+    return true;
+#endif
+}
+
+/* True if the file got shorter than what is shown of its mapping. Touching the mapping past the new end would crash. */
+static bool ad_textViewTruncated(ad_TextView *view) {
+    struct stat st;
+    return view->mapSize > 0 && fstat(view->fd, &st) == 0 && (uint64_t) st.st_size < (uint64_t) view->size;
+}
+
+/* Reads what there is of the file into the buffer and drops the mapping. On failure, the mapping stays. */
+static bool ad_textViewReadMapped(ad_TextView *view) {
+    const char     *mapped = view->data;
+    ad_FileOffset   size;
+
+    if (!ad_textViewGetFileSize(view, &size) || !ad_textViewReadIn(view, 0, size)) {
+        return false;
+    }
+
+    munmap((void *) mapped, view->mapSize);
+    view->mapSize = 0;
+    return true;
+}
+
+/* Reads up to <length> bytes from <offset> on. Returns how many there were. */
+static size_t ad_textViewReadAt(ad_TextView *view, char *dst, ad_FileOffset offset, size_t length) {
+    size_t  done = 0;
+    ssize_t got;
+
+    if (lseek(view->fd, (off_t) offset, SEEK_SET) < 0) {
+        return 0;
+    }
+
+    while (done < length && (got = read(view->fd, &dst[done], length - done)) > 0) {
+        done += (size_t) got;
+    }
+
+    return done;
+}
+
+#else
+
+static bool ad_textViewMap(ad_TextView *view, const char *fileName) {
+    FILE   *inFile      = fopen(fileName, "rb");
+    long    fileSize;
+    size_t  bytesRead   = 0;
+
+    AD_RETURN_ON_NULL(inFile, false);
+
+    fseek(inFile, 0, SEEK_END);
+    fileSize = ftell(inFile);
+    fseek(inFile, 0, SEEK_SET);
+
+    if (ferror(inFile) != 0 || fileSize <= 0 || (unsigned long) fileSize >= (size_t) -1) {
+        fclose(inFile);
+        return false;
+    }
+
+    view->buffer = malloc((size_t) fileSize);
+
+    while (view->buffer != NULL && bytesRead < (size_t) fileSize && !ferror(inFile)) {
+        bytesRead += fread(&view->buffer[bytesRead], 1, (size_t) fileSize - bytesRead, inFile);
+    }
+
+    fclose(inFile);
+
+    /* Nothing else runs on DOS that could write to the file meanwhile */
+    view->following = false;
+    view->data = view->buffer;
+    view->size = (ad_FileOffset) fileSize;
+    return view->buffer != NULL && bytesRead == (size_t) fileSize;
+}
+
+static void ad_textViewUnmap(ad_TextView *view) {
+    AD_UNUSED_PARAMETER(view);
+}
+
+#endif
+
+/* Makes room for <count> lines in the index, the offset array grows by doubling */
+static bool ad_textViewReserveLines(ad_TextView *view, size_t count) {
+    if (count > view->lineCapacity) {
+        size_t          newCapacity = AD_MAX(AD_MAX(view->lineCapacity * 2, 1024), count);
+        ad_FileOffset  *newOffsets  = realloc(view->lineOffsets, newCapacity * sizeof(ad_FileOffset));
+
+        AD_RETURN_ON_NULL(newOffsets, false);
+
+        view->lineOffsets = newOffsets;
+        view->lineCapacity = newCapacity;
+    }
+
+    return true;
+}
+
+/* Adds a line to the index */
+static bool ad_textViewAddLine(ad_TextView *view, ad_FileOffset offset) {
+    if (!ad_textViewReserveLines(view, view->lineCount + 1)) {
+        return false;
+    }
+
+    view->lineOffsets[view->lineCount++] = offset;
+    return true;
+}
+
+/* Adds a checkpoint, the array grows by doubling like the index */
+static bool ad_textViewAddCheckpoint(ad_TextView *view, ad_FileOffset offset) {
+    if (view->checkpointCount == view->checkpointCapacity) {
+        size_t          newCapacity     = AD_MAX(view->checkpointCapacity * 2, 64);
+        ad_FileOffset  *newCheckpoints  = realloc(view->checkpoints, newCapacity * sizeof(ad_FileOffset));
+
+        AD_RETURN_ON_NULL(newCheckpoints, false);
+
+        view->checkpoints = newCheckpoints;
+        view->checkpointCapacity = newCapacity;
+    }
+
+    view->checkpoints[view->checkpointCount++] = offset;
+    return true;
+}
+
+/* Length of the line from <start> up to the line break at <end> */
+static size_t ad_textViewSpanLength(const ad_TextView *view, ad_FileOffset start, ad_FileOffset end) {
+    /* Deal with annoying \r\n stuff */
+    if (end > start && view->data[end - 1] == '\r') end--;
+
+    return (size_t) (end - start);
+}
+
+/* True if line <index> is indexed completely */
+static bool ad_textViewIsIndexed(const ad_TextView *view, size_t index) {
+    return index + 1 < view->lineCount || (view->complete && index < view->lineCount);
+}
+
+/* Length of the line that starts at <start>, for lines that aren't indexed */
+static size_t ad_textViewLengthFrom(const ad_TextView *view, ad_FileOffset start) {
+    const char *lineEnd = memchr(&view->data[start], '\n', (size_t) (view->size - start));
+    return ad_textViewSpanLength(view, start, lineEnd != NULL ? (ad_FileOffset) (lineEnd - view->data) : view->size);
+}
+
+/* Length of line <index> without its line break. The line must be indexed completely. */
+static size_t ad_textViewLineLength(const ad_TextView *view, size_t index) {
+    ad_FileOffset end;
+
+    if (index + 1 < view->lineCount) {
+        end = view->lineOffsets[index + 1] - 1;
+    } else {
+        /* The last line may end with \n or not at all (or be all there is of an empty file) */
+        end = view->size;
+        if (end > view->lineOffsets[index] && view->data[end - 1] == '\n') end--;
+    }
+
+    return ad_textViewSpanLength(view, view->lineOffsets[index], end);
+}
+
+#if defined(AD_LINES_BACKGROUND)
+
+static uint32_t ad_textViewCpuCount(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (uint32_t) info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t) count : 1;
+#else
+    return 1;
+#endif
+}
+
+/* Finds the lines starting in chunk <index>. Line starts are the bytes after line breaks. */
+static bool ad_textChunkScan(const ad_TextView *view, ad_TextChunk *chunk, uint32_t index) {
+    ad_FileOffset   pos         = (ad_FileOffset) index * AD_LINES_CHUNK_SIZE;
+    ad_FileOffset   end         = AD_MIN(pos + AD_LINES_CHUNK_SIZE, view->size);
+    size_t          capacity    = 0;
+    size_t          i;
+
+    while (true) {
+        if (chunk->count == capacity) {
+            size_t          newCapacity = AD_MAX(capacity * 2, 4096);
+            ad_FileOffset  *newOffsets  = realloc(chunk->offsets, newCapacity * sizeof(ad_FileOffset));
+
+            AD_RETURN_ON_NULL(newOffsets, false);
+
+            chunk->offsets = newOffsets;
+            capacity = newCapacity;
+        }
+
+        chunk->count += ad_bytesFindAll(&view->data[pos], (size_t) (end - pos), '\n', pos + 1, &chunk->offsets[chunk->count], capacity - chunk->count);
+
+        if (chunk->count < capacity) {
+            break;
+        }
+
+        /* Array is full, carry on after the last line break found */
+        pos = chunk->offsets[chunk->count - 1];
+    }
+
+    /* A line break at the very end doesn't start another line */
+    if (chunk->count > 0 && chunk->offsets[chunk->count - 1] == view->size) {
+        chunk->count--;
+    }
+
+    for (i = 0; i + 1 < chunk->count; i++) {
+        chunk->longestLine = AD_MAX(chunk->longestLine, ad_textViewSpanLength(view, chunk->offsets[i], chunk->offsets[i + 1] - 1));
+    }
+
+    return true;
+}
+
+AD_THREAD_FUNC(ad_textViewWorker, arg) {
+    ad_TextWorker  *worker  = (ad_TextWorker *) arg;
+    ad_TextView    *view    = worker->view;
+    ad_TextIndexer *ix      = view->indexer;
+    uint32_t        i;
+
+    for (i = worker->index; i < ix->chunkCount && !ad_atomicLoad(&ix->stop); i += ix->workerCount) {
+        ad_TextChunk *chunk = &ix->chunks[i];
+        bool          ok    = ad_textChunkScan(view, chunk, i);
+
+        ad_atomicStoreRelease(&chunk->state, ok ? AD_LINES_CHUNK_DONE : AD_LINES_CHUNK_FAILED);
+    }
+
+    AD_THREAD_RETURN;
+}
+
+/* Appends the lines of a chunk to the index */
+static bool ad_textViewMergeChunk(ad_TextView *view, ad_TextChunk *chunk) {
+    size_t lastLine = view->lineCount - 1;
+    size_t newCount = view->lineCount + chunk->count;
+
+    if (chunk->count == 0) {
+        return true;
+    }
+
+    if (!ad_textViewReserveLines(view, newCount)) {
+        return false;
+    }
+
+    memcpy(&view->lineOffsets[view->lineCount], chunk->offsets, chunk->count * sizeof(ad_FileOffset));
+    view->lineCount = newCount;
+
+    /* The line that was last so far ends in this chunk */
+    view->longestLine = AD_MAX(view->longestLine, ad_textViewLineLength(view, lastLine));
+    view->longestLine = AD_MAX(view->longestLine, chunk->longestLine);
+    return true;
+}
+
+/* Takes over the chunks that are done, in file order. Lines past those are looked up through checkpoints meanwhile. */
+static void ad_textViewMerge(ad_TextView *view) {
+    ad_TextIndexer *ix = view->indexer;
+
+    while (!ix->failed && ix->chunksMerged < ix->chunkCount) {
+        ad_TextChunk   *chunk = &ix->chunks[ix->chunksMerged];
+        uint32_t        state = ad_atomicLoadAcquire(&chunk->state);
+
+        if (state == AD_LINES_CHUNK_PENDING) {
+            return;
+        }
+
+        ix->failed = (state == AD_LINES_CHUNK_FAILED) || !ad_textViewMergeChunk(view, chunk);
+
+        free(chunk->offsets);
+        chunk->offsets = NULL;
+        ix->chunksMerged++;
+    }
+
+    if (!ix->failed && !view->complete) {
+        view->complete = true;
+        view->longestLine = AD_MAX(view->longestLine, ad_textViewLineLength(view, view->lineCount - 1));
+    }
+}
+
+static void ad_textViewStopIndexing(ad_TextView *view) {
+    ad_TextIndexer *ix = view->indexer;
+    uint32_t        i;
+
+    ad_atomicStore(&ix->stop, 1);
+
+    for (i = 0; i < ix->threadCount; i++) {
+        ad_threadJoin(ix->workers[i].thread);
+    }
+
+    for (i = 0; i < ix->chunkCount; i++) {
+        free(ix->chunks[i].offsets);
+    }
+
+    free(ix->chunks);
+    free(ix);
+    view->indexer = NULL;
+}
+
+bool ad_textViewIndexInBackground(ad_TextView *view) {
+    ad_TextIndexer *ix;
+    uint32_t        i;
+    bool            ok = true;
+
+    if (view->indexer != NULL || view->complete || view->size <= 2 * AD_LINES_CHUNK_SIZE) {
+        return false;
+    }
+
+    ix = calloc(1, sizeof(ad_TextIndexer));
+    AD_RETURN_ON_NULL(ix, false);
+
+    ix->chunkCount = (uint32_t) ((view->size + AD_LINES_CHUNK_SIZE - 1) / AD_LINES_CHUNK_SIZE);
+    ix->chunks = calloc(ix->chunkCount, sizeof(ad_TextChunk));
+
+    if (ix->chunks == NULL) {
+        free(ix);
+        return false;
+    }
+
+    /* Whatever was indexed lazily so far gets found again by the workers */
+    view->lineCount = 1;
+    view->scanPos = 0;
+    view->longestLine = 0;
+    view->indexer = ix;
+
+    ix->workerCount = AD_MIN(AD_MIN(ad_textViewCpuCount(), AD_LINES_MAX_WORKERS), ix->chunkCount);
+
+    for (i = 0; ok && i < ix->workerCount; i++) {
+        ix->workers[i].view = view;
+        ix->workers[i].index = i;
+        ok = ad_threadStart(&ix->workers[i].thread, ad_textViewWorker, &ix->workers[i]);
+        ix->threadCount += ok ? 1 : 0;
+    }
+
+    /* Chunks are split up by worker count, so it's all of them or none */
+    if (!ok) {
+        ad_textViewStopIndexing(view);
+        return false;
+    }
+
+    return true;
+}
+
+void ad_textViewUpdate(ad_TextView *view) {
+    if (view->indexer != NULL) {
+        ad_textViewMerge(view);
+    }
+}
+
+bool ad_textViewIsIndexing(const ad_TextView *view) {
+    return view->indexer != NULL && !view->complete && !view->indexer->failed;
+}
+
+uint32_t ad_textViewGetIndexedPercent(const ad_TextView *view) {
+    if (view->complete || view->size == 0) {
+        return 100;
+    }
+
+    if (view->indexer != NULL) {
+        return (uint32_t) (view->indexer->chunksMerged * 100.0 / view->indexer->chunkCount);
+    }
+
+    return (uint32_t) ((double) view->scanPos * 100.0 / (double) view->size);
+}
+
+#else
+
+bool ad_textViewIndexInBackground(ad_TextView *view) {
+    AD_UNUSED_PARAMETER(view);
+    return false;
+}
+
+void ad_textViewUpdate(ad_TextView *view) {
+    AD_UNUSED_PARAMETER(view);
+}
+
+bool ad_textViewIsIndexing(const ad_TextView *view) {
+    AD_UNUSED_PARAMETER(view);
+    return false;
+}
+
+uint32_t ad_textViewGetIndexedPercent(const ad_TextView *view) {
+    return view->complete || view->size == 0 ? 100 : (uint32_t) ((double) view->scanPos * 100.0 / (double) view->size);
+}
+
+#endif
+
+ad_TextView *ad_textViewOpen(const char *fileName, bool follow) {
+    ad_TextView *view;
+
+    AD_RETURN_ON_NULL(fileName, NULL);
+
+    view = calloc(1, sizeof(ad_TextView));
+    AD_RETURN_ON_NULL(view, NULL);
+
+    view->following = follow;
+
+    if (!ad_textViewMap(view, fileName) || !ad_textViewAddLine(view, 0) || !ad_textViewAddCheckpoint(view, 0)) {
+        ad_textViewClose(view);
+        return NULL;
+    }
+
+    return view;
+}
+
+void ad_textViewClose(ad_TextView *view) {
+    if (view) {
+#if defined(AD_LINES_BACKGROUND)
+        if (view->indexer != NULL) {
+            ad_textViewStopIndexing(view);
+        }
+#endif
+        ad_textViewUnmap(view);
+        free(view->buffer);
+        free(view->lineOffsets);
+        free(view->checkpoints);
+        free(view);
+    }
+}
+
+/* Indexes the file lazily up to line <line> */
+static bool ad_textViewIndexLazily(ad_TextView *view, size_t line) {
+    /* Line <line> is complete once the one after it starts */
+    while (!view->complete && view->lineCount <= line + 1) {
+        const char *lineEnd = memchr(&view->data[view->scanPos], '\n', (size_t) (view->size - view->scanPos));
+
+        if (lineEnd == NULL || (ad_FileOffset) (lineEnd - view->data) + 1 >= view->size) {
+            view->complete = true;
+        } else if (!ad_textViewAddLine(view, (ad_FileOffset) (lineEnd - view->data) + 1)) {
+            return false;
+        } else {
+            view->scanPos = view->lineOffsets[view->lineCount - 1];
+        }
+
+        view->longestLine = AD_MAX(view->longestLine, ad_textViewLineLength(view, view->lineCount - (view->complete ? 1 : 2)));
+    }
+
+    return line < view->lineCount;
+}
+
+/* Finds checkpoints until there is one for line <line> or past <offset>, or the file ends */
+static void ad_textViewCheckpointTo(ad_TextView *view, size_t line, ad_FileOffset offset) {
+    size_t index = line / AD_LINES_CHECKPOINT_INTERVAL;
+
+    /* The ones the index already goes past are simply taken from there */
+    while (view->checkpointCount <= index && view->checkpoints[view->checkpointCount - 1] <= offset
+        && view->checkpointCount * AD_LINES_CHECKPOINT_INTERVAL < view->lineCount) {
+        if (!ad_textViewAddCheckpoint(view, view->lineOffsets[view->checkpointCount * AD_LINES_CHECKPOINT_INTERVAL])) {
+            return;
+        }
+    }
+
+    while (!view->lastLineKnown && view->checkpointCount <= index && view->checkpoints[view->checkpointCount - 1] <= offset) {
+        ad_FileOffset   pos     = view->checkpoints[view->checkpointCount - 1];
+        size_t          found;
+        ad_FileOffset   next    = pos + ad_bytesFindNth(&view->data[pos], (size_t) (view->size - pos), '\n', AD_LINES_CHECKPOINT_INTERVAL, &found) + 1;
+
+        /* A line break at the very end doesn't start another line */
+        if (next >= view->size) {
+            view->lastLine = (view->checkpointCount - 1) * AD_LINES_CHECKPOINT_INTERVAL + found - (found > 0 && view->data[view->size - 1] == '\n' ? 1 : 0);
+            view->lastLineKnown = true;
+        } else if (!ad_textViewAddCheckpoint(view, next)) {
+            return;
+        }
+    }
+}
+
+/* Finds the start of line <line> from the nearest checkpoint, or from the last line looked up if that's nearer */
+static bool ad_textViewSeek(ad_TextView *view, size_t line, ad_FileOffset *start) {
+    size_t          from;
+    ad_FileOffset   pos;
+
+    ad_textViewCheckpointTo(view, line, view->size);
+
+    from = AD_MIN(line / AD_LINES_CHECKPOINT_INTERVAL, view->checkpointCount - 1);
+    pos = view->checkpoints[from];
+    from *= AD_LINES_CHECKPOINT_INTERVAL;
+
+    if (view->seekLine >= from && view->seekLine <= line) {
+        from = view->seekLine;
+        pos = view->seekOffset;
+    }
+
+    if (view->lineCount - 1 > from && view->lineCount - 1 <= line) {
+        from = view->lineCount - 1;
+        pos = view->lineOffsets[from];
+    }
+
+    for (; from < line; from++) {
+        const char *lineEnd = memchr(&view->data[pos], '\n', (size_t) (view->size - pos));
+
+        if (lineEnd == NULL || (ad_FileOffset) (lineEnd - view->data) + 1 >= view->size) {
+            view->lastLine = from;
+            view->lastLineKnown = true;
+            return false;
+        }
+
+        pos = (ad_FileOffset) (lineEnd - view->data) + 1;
+    }
+
+    view->seekLine = line;
+    view->seekOffset = pos;
+    *start = pos;
+    return true;
+}
+
+/* Where line <line> starts. Lines the index doesn't reach within a checkpoint interval are looked up through the checkpoints instead. */
+static bool ad_textViewLocate(ad_TextView *view, size_t line, ad_FileOffset *start) {
+    bool indexed = view->complete;
+
+#if defined(AD_LINES_BACKGROUND)
+    /* Background indexing is never waited for */
+    if (view->indexer != NULL) {
+        ad_textViewMerge(view);
+        indexed = true;
+    }
+#endif
+
+    if (ad_textViewIsIndexed(view, line)) {
+        *start = view->lineOffsets[line];
+        return true;
+    }
+
+    if (view->complete || (view->lastLineKnown && line > view->lastLine)) {
+        return false;
+    }
+
+    if (!indexed && line < view->lineCount + AD_LINES_CHECKPOINT_INTERVAL) {
+        if (!ad_textViewIndexLazily(view, line)) {
+            return false;
+        }
+
+        *start = view->lineOffsets[line];
+        return true;
+    }
+
+    return ad_textViewSeek(view, line, start);
+}
+
+bool ad_textViewIndexTo(ad_TextView *view, size_t line) {
+    ad_FileOffset start;
+    return ad_textViewLocate(view, line, &start);
+}
+
+#if defined(_WIN32) || defined(AD_HAL_HAS_MMAP)
+
+/* Makes room in the buffer for <size> bytes. On failure, the old buffer stays. */
+static bool ad_textViewGrow(ad_TextView *view, ad_FileOffset size) {
+    size_t  room;
+    char   *buffer;
+
+    if ((uint64_t) size >= (uint64_t) (SIZE_MAX / 2)) {
+        return false;
+    }
+
+    /* A file that isn't followed doesn't grow, the one byte keeps an empty one from being a zero size allocation */
+    room = view->following ? AD_MIN(AD_MAX((size_t) size / 2, AD_LINES_FOLLOW_ROOM), AD_LINES_FOLLOW_MAX_ROOM) : 1;
+    buffer = realloc(view->buffer, (size_t) size + room);
+    AD_RETURN_ON_NULL(buffer, false);
+
+    view->buffer = buffer;
+    view->bufferSize = (size_t) size + room;
+    return true;
+}
+
+/* Reads the file from <from> up to <size> into the buffer, which grows if it has to.
+   If the file got shorter meanwhile, the size is what could still be read. */
+static bool ad_textViewReadIn(ad_TextView *view, ad_FileOffset from, ad_FileOffset size) {
+    if ((view->buffer == NULL || size > view->bufferSize) && !ad_textViewGrow(view, size)) {
+        return false;
+    }
+
+    view->data = view->buffer;
+    view->size = from + ad_textViewReadAt(view, &view->buffer[from], from, (size_t) (size - from));
+    return true;
+}
+
+/* Indexes the rest of the file from <from> on in one go, with the line break kernel (ad_simd.c).
+   On failure, the index stays as it was. */
+static bool ad_textViewIndexRest(ad_TextView *view, ad_FileOffset from) {
+    size_t first = view->lineCount;
+    size_t found;
+    size_t room;
+    size_t i;
+
+    do {
+        /* Lines found so far are dropped again, lazy indexing finds them from scanPos on */
+        if (!ad_textViewReserveLines(view, view->lineCount + 4096)) {
+            view->lineCount = first;
+            return false;
+        }
+
+        room = view->lineCapacity - view->lineCount;
+        found = ad_bytesFindAll(&view->data[from], (size_t) (view->size - from), '\n', from + 1, &view->lineOffsets[view->lineCount], room);
+        view->lineCount += found;
+
+        if (found > 0) {
+            from = view->lineOffsets[view->lineCount - 1];
+        }
+    } while (found == room);
+
+    /* A line break at the very end doesn't start another line */
+    if (view->lineCount > 1 && view->lineOffsets[view->lineCount - 1] == view->size) {
+        view->lineCount--;
+    }
+
+    /* The line that was last before ends somewhere in here too */
+    for (i = first > 0 ? first - 1 : 0; i + 1 < view->lineCount; i++) {
+        view->longestLine = AD_MAX(view->longestLine, ad_textViewLineLength(view, i));
+    }
+
+    view->complete = true;
+    view->scanPos = view->lineOffsets[view->lineCount - 1];
+    view->longestLine = AD_MAX(view->longestLine, ad_textViewLineLength(view, view->lineCount - 1));
+    return true;
+}
+
+/* Forgets all lines found so far, for a file that is a different one now */
+static void ad_textViewStartOver(ad_TextView *view) {
+    view->checkpointCount = 1;
+    view->seekLine = 0;
+    view->seekOffset = 0;
+    view->lineCount = 1;
+    view->scanPos = 0;
+    view->complete = false;
+    view->longestLine = 0;
+    view->lastLineKnown = false;
+}
+
+/* A file that isn't followed is only looked at to see if something cut it short */
+static ad_TextViewChange ad_textViewCheckMapped(ad_TextView *view, bool mayMove) {
+    if (!ad_textViewTruncated(view)) {
+        return AD_TEXT_VIEW_UNCHANGED;
+    }
+
+    /* Nothing may be read from the mapping anymore, but the others reading it have to be stopped first */
+    if (!mayMove) {
+        return AD_TEXT_VIEW_BLOCKED;
+    }
+
+#if defined(AD_LINES_BACKGROUND)
+    if (view->indexer != NULL) {
+        ad_textViewStopIndexing(view);
+    }
+#endif
+
+    if (!ad_textViewReadMapped(view)) {
+        return AD_TEXT_VIEW_UNCHANGED;
+    }
+
+    ad_textViewStartOver(view);
+    return AD_TEXT_VIEW_RELOADED;
+}
+
+ad_TextViewChange ad_textViewCheckFile(ad_TextView *view, bool mayMove) {
+    ad_FileOffset   oldSize = view->size;
+    ad_FileOffset   size;
+    bool            moves;
+    bool            shrunk;
+
+    if (!view->following) {
+        return ad_textViewCheckMapped(view, mayMove);
+    }
+
+#if defined(AD_LINES_BACKGROUND)
+    if (view->indexer != NULL) {
+        /* The workers read the file as it was, it's only looked at again once they are done. Unless it got shorter,
+           then they are stopped right away, before they get to the pages that are gone. */
+        if (ad_textViewIsIndexing(view) && (!ad_textViewGetFileSize(view, &size) || size >= oldSize)) {
+            return AD_TEXT_VIEW_UNCHANGED;
+        }
+
+        ad_textViewStopIndexing(view);
+        view->scanPos = view->lineOffsets[view->lineCount - 1];
+    }
+#endif
+
+    if (!view->followPending && !ad_textViewNotified(view)) {
+        return AD_TEXT_VIEW_UNCHANGED;
+    }
+
+    view->followPending = true;
+
+    if (!ad_textViewGetFileSize(view, &size) || size == oldSize) {
+        view->followPending = false;
+        return AD_TEXT_VIEW_UNCHANGED;
+    }
+
+    /* Anyone else reading the data (searches) would be left with a stale pointer or lines that are gone.
+       Data that moves can wait, the old data stays there. Data that is gone can't be read by anyone anymore. */
+    moves = (uint64_t) size > (uint64_t) ad_textViewFollowRoom(view);
+    shrunk = size < oldSize;
+
+    if (shrunk && !mayMove) {
+        return AD_TEXT_VIEW_BLOCKED;
+    }
+
+    if (moves && !mayMove) {
+        return AD_TEXT_VIEW_UNCHANGED;
+    }
+
+    /* Got shorter, so it's probably a new file now (truncated log) and it's taken in again from the start */
+    if (!ad_textViewFollowTo(view, shrunk ? 0 : oldSize, size)) {
+        view->following = false;
+        return AD_TEXT_VIEW_UNCHANGED;
+    }
+
+    view->followPending = false;
+
+    /* Appended data is past the last line looked up, the checkpoints stay valid */
+    view->lastLineKnown = false;
+
+    /* The index starts over for a new file */
+    if (shrunk) {
+        ad_textViewStartOver(view);
+        return AD_TEXT_VIEW_RELOADED;
+    }
+
+    /* Only what was appended gets indexed. Lazy indexing gets to it by itself, and takes over if this fails. */
+    if (view->complete) {
+        view->complete = false;
+        (void) ad_textViewIndexRest(view, oldSize > 0 ? oldSize - 1 : 0);
+    }
+
+    return moves ? AD_TEXT_VIEW_REMAPPED : AD_TEXT_VIEW_GREW;
+}
+
+#else
+
+ad_TextViewChange ad_textViewCheckFile(ad_TextView *view, bool mayMove) {
+    AD_UNUSED_PARAMETER(view);
+    AD_UNUSED_PARAMETER(mayMove);
+    return AD_TEXT_VIEW_UNCHANGED;
+}
+
+#endif
+
+bool ad_textViewLoadIndex(ad_TextView *view, const char *directory) {
+    ad_FileOffset  *offsets;
+    size_t          count;
+    size_t          longestLine;
+
+    if (!view->hasKey || view->complete || view->size != view->key.size
+        || !ad_lineCacheLoad(directory, &view->key, &offsets, &count, &longestLine)) {
+        return false;
+    }
+
+    free(view->lineOffsets);
+    view->lineOffsets = offsets;
+    view->lineCount = count;
+    view->lineCapacity = count;
+    view->scanPos = offsets[count - 1];
+    view->longestLine = longestLine;
+    view->complete = true;
+    view->cached = true;
+    return true;
+}
+
+bool ad_textViewStoreIndex(ad_TextView *view, const char *directory) {
+    /* Takes in what background indexing has finished by now */
+    ad_textViewUpdate(view);
+
+    /* A followed file that has grown since is not the file the key stands for anymore */
+    if (!view->hasKey || !view->complete || view->cached || view->size != view->key.size || view->size < AD_LINES_CACHE_MIN_SIZE) {
+        return false;
+    }
+
+    return ad_lineCacheStore(directory, &view->key, view->lineOffsets, view->lineCount, view->longestLine);
+}
+
+size_t ad_textViewGetLineCount(const ad_TextView *view, bool *complete) {
+    /* The last line found so far might not be complete yet */
+    size_t indexed = view->complete ? view->lineCount : view->lineCount - 1;
+
+    if (complete != NULL) {
+        *complete = view->complete || view->lastLineKnown;
+    }
+
+    if (!view->complete && view->lastLineKnown) {
+        return view->lastLine + 1;
+    }
+
+    /* All lines before a checkpoint or the last line looked up are complete too */
+    return AD_MAX(indexed, AD_MAX(view->seekLine, (view->checkpointCount - 1) * AD_LINES_CHECKPOINT_INTERVAL));
+}
+
+size_t ad_textViewGetLongestLine(const ad_TextView *view) {
+    return view->longestLine;
+}
+
+const char *ad_textViewGetLine(ad_TextView *view, size_t line, size_t *length) {
+    ad_FileOffset start;
+
+    if (!ad_textViewLocate(view, line, &start)) {
+        return NULL;
+    }
+
+    *length = ad_textViewIsIndexed(view, line) ? ad_textViewLineLength(view, line) : ad_textViewLengthFrom(view, start);
+    return &view->data[start];
+}
+
+ad_FileOffset ad_textViewGetLineStart(ad_TextView *view, size_t line) {
+    ad_FileOffset start;
+    return ad_textViewLocate(view, line, &start) ? start : view->size;
+}
+
+/* Index of the last of the <count> sorted <offsets> that is at or before <offset> */
+static size_t ad_textViewFindOffset(const ad_FileOffset *offsets, size_t count, ad_FileOffset offset) {
+    size_t low  = 0;
+    size_t high = count;
+
+    while (high - low > 1) {
+        size_t mid = low + (high - low) / 2;
+
+        if (offsets[mid] <= offset) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+bool ad_textViewLookupLine(ad_TextView *view, ad_FileOffset start, size_t *line) {
+    size_t          from;
+    ad_FileOffset   pos;
+    size_t          count;
+
+    ad_textViewUpdate(view);
+
+    if (view->complete || view->lineOffsets[view->lineCount - 1] >= start) {
+        *line = ad_textViewFindOffset(view->lineOffsets, view->lineCount, start);
+        return true;
+    }
+
+    /* Past the index, it's the line breaks between the nearest line known before <start> and <start> that count */
+    from = ad_textViewFindOffset(view->checkpoints, view->checkpointCount, start);
+    pos = view->checkpoints[from];
+    from *= AD_LINES_CHECKPOINT_INTERVAL;
+
+    if (view->lineCount - 1 > from) {
+        from = view->lineCount - 1;
+        pos = view->lineOffsets[from];
+    }
+
+    if (view->seekLine > from && view->seekOffset <= start) {
+        from = view->seekLine;
+        pos = view->seekOffset;
+    }
+
+    /* No further than a checkpoint interval, anything past that is left to the indexing */
+    ad_bytesFindNth(&view->data[pos], (size_t) (start - pos), '\n', AD_LINES_CHECKPOINT_INTERVAL, &count);
+
+    if (count >= AD_LINES_CHECKPOINT_INTERVAL) {
+        return false;
+    }
+
+    *line = from + count;
+    view->seekLine = *line;
+    view->seekOffset = start;
+    return true;
+}
+
+const char *ad_textViewGetLineAt(const ad_TextView *view, ad_FileOffset start, size_t *length) {
+    /* An empty file still has its one empty line */
+    if (start >= view->size && start > 0) {
+        return NULL;
+    }
+
+    *length = (start < view->size) ? ad_textViewLengthFrom(view, start) : 0;
+    return &view->data[start];
+}
+
+bool ad_textViewNextLine(const ad_TextView *view, ad_FileOffset *start) {
+    const char *lineEnd;
+
+    if (*start >= view->size) {
+        return false;
+    }
+
+    lineEnd = memchr(&view->data[*start], '\n', (size_t) (view->size - *start));
+
+    /* A line break at the very end doesn't start another line */
+    if (lineEnd == NULL || (ad_FileOffset) (lineEnd - view->data) + 1 >= view->size) {
+        return false;
+    }
+
+    *start = (ad_FileOffset) (lineEnd - view->data) + 1;
+    return true;
+}
+
+bool ad_textViewPreviousLine(const ad_TextView *view, ad_FileOffset *start) {
+    if (*start == 0) {
+        return false;
+    }
+
+    *start = ad_textViewLineStartAt(view, *start - 1);
+    return true;
+}
+
+ad_FileOffset ad_textViewLineStartAt(const ad_TextView *view, ad_FileOffset offset) {
+    if (offset >= view->size) {
+        offset = view->size > 0 ? view->size - 1 : 0;
+    }
+
+    while (offset > 0 && view->data[offset - 1] != '\n') {
+        offset--;
+    }
+
+    return offset;
+}
+
+const char *ad_textViewGetData(const ad_TextView *view, ad_FileOffset *size) {
+    *size = view->size;
+    return view->data;
+}
@@ -0,0 +1,374 @@
+/*
+    AnbUI Miniature Text UI Lib for Burger Enjoyers(tm)
+
+    ad_memfb: Headless HAL that renders into a plain cell array in memory.
+    Keys come from a script supplied by the caller instead of a keyboard,
+    so everything can be driven without a terminal attached.
+
+    Tip of the day: A burger in memory is worth two in the fridge.
+    Unless the fridge has cheese. Then it's a cheeseburger in memory.
+
+    (C) 2026 E. Voirin (oerg866) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "anbui.h"
+#include "ad_priv.h"
+#include "ad_hal.h"
+
+typedef struct {
+    ad_Hal          hal;
+    uint16_t        width;
+    uint16_t        height;
+    uint16_t        x;
+    uint16_t        y;
+    ad_Color        color;
+    ad_Char        *cells;
+    ad_OutputStats  stats;
+    uint32_t        pendingBytes;       /* Bytes written to the cell array since the last flush */
+    uint32_t        pendingWrites;
+    uint32_t       *keys;
+    size_t          keyCount;
+    size_t          keyIndex;
+} ad_HalMemory;
+
+#define ad_halMemory(hal) ((ad_HalMemory *) (hal))
+
+typedef struct {
+    const char     *name;
+    uint32_t        key;
+} ad_HalMemoryKeyName;
+
+static const ad_HalMemoryKeyName ad_halMemoryKeyNames[] = {
+    { "ESC",    AD_KEY_ESC      },
+    { "ENTER",  AD_KEY_ENTER    },
+    { "PGUP",   AD_KEY_PGUP     },
+    { "PGDN",   AD_KEY_PGDN     },
+    { "HOME",   AD_KEY_HOME     },
+    { "END",    AD_KEY_END      },
+    { "UP",     AD_KEY_UP       },
+    { "DOWN",   AD_KEY_DOWN     },
+    { "LEFT",   AD_KEY_LEFT     },
+    { "RIGHT",  AD_KEY_RIGHT    },
+    { "SPACE",  ' '             },
+    { "BACKSPACE", 0x08         },
+    { "F1",     AD_KEY_F1       },
+    { "F2",     AD_KEY_F2       },
+    { "F3",     AD_KEY_F3       },
+    { "F4",     AD_KEY_F4       },
+    { "F5",     AD_KEY_F5       },
+    { "F6",     AD_KEY_F6       },
+    { "F7",     AD_KEY_F7       },
+    { "F8",     AD_KEY_F8       },
+    { "F9",     AD_KEY_F9       },
+    { "F10",    AD_KEY_F10      },
+    { "F11",    AD_KEY_F11      },
+    { "F12",    AD_KEY_F12      },
+};
+
+static void ad_halMemoryInitConsole(ad_Hal *hal, ad_ConsoleConfig *cfg) {
+    cfg->width = ad_halMemory(hal)->width;
+    cfg->height = ad_halMemory(hal)->height;
+}
+
+static void ad_halMemoryNoArgs(ad_Hal *hal) {
+    AD_UNUSED_PARAMETER(hal);
+}
+
+static void ad_halMemorySetColor(ad_Hal *hal, uint8_t bg, uint8_t fg) {
+    ad_halMemory(hal)->color.bg = bg & 0x0F;
+    ad_halMemory(hal)->color.fg = fg & 0x0F;
+}
+
+static void ad_halMemorySetCursorPosition(ad_Hal *hal, uint16_t x, uint16_t y) {
+    ad_halMemory(hal)->x = x;
+    ad_halMemory(hal)->y = y;
+}
+
+static void ad_halMemoryFlush(ad_Hal *hal) {
+    ad_HalMemory *mem = ad_halMemory(hal);
+
+    if (mem->pendingBytes == 0) {
+        return;
+    }
+
+    mem->stats.frames++;
+    mem->stats.lastFrameBytes = mem->pendingBytes;
+    mem->stats.lastFrameWrites = mem->pendingWrites;
+    mem->stats.totalBytes += mem->pendingBytes;
+    mem->stats.totalWrites += mem->pendingWrites;
+    mem->pendingBytes = 0;
+    mem->pendingWrites = 0;
+}
+
+static void ad_halMemoryGetOutputStats(ad_Hal *hal, ad_OutputStats *stats) {
+    *stats = ad_halMemory(hal)->stats;
+}
+
+/* Returns where the next <*count> cells go and clips <*count> to the end of the screen */
+static ad_Char *ad_halMemoryClaim(ad_HalMemory *mem, size_t *count) {
+    size_t start = (size_t) mem->y * mem->width + mem->x;
+    size_t total = (size_t) mem->width * mem->height;
+    size_t end;
+
+    if (start >= total) {
+        *count = 0;
+        return NULL;
+    }
+
+    *count = AD_MIN(*count, total - start);
+
+    /* Park the cursor on the last cell rather than running off the screen */
+    end = AD_MIN(start + *count, total - 1);
+    mem->x = (uint16_t) (end % mem->width);
+    mem->y = (uint16_t) (end / mem->width);
+
+    mem->pendingBytes += (uint32_t) (*count * sizeof(ad_Char));
+    mem->pendingWrites++;
+
+    return &mem->cells[start];
+}
+
+static void ad_halMemoryPutChar(ad_Hal *hal, char c, size_t count) {
+    ad_HalMemory   *mem     = ad_halMemory(hal);
+    ad_Char        *dst     = ad_halMemoryClaim(mem, &count);
+    size_t          i;
+
+    for (i = 0; i < count; i++) {
+        dst[i].ascii = (uint8_t) c;
+        dst[i].color = mem->color;
+        dst[i].attr = 0;
+    }
+}
+
+static void ad_halMemoryPutString(ad_Hal *hal, const char *str) {
+    ad_HalMemory   *mem     = ad_halMemory(hal);
+    size_t          count   = strlen(str);
+    ad_Char        *dst     = ad_halMemoryClaim(mem, &count);
+    size_t          i;
+
+    for (i = 0; i < count; i++) {
+        dst[i].ascii = (uint8_t) str[i];
+        dst[i].color = mem->color;
+        dst[i].attr = 0;
+    }
+}
+
+static void ad_halMemoryPutSpan(ad_Hal *hal, const ad_Char *cells, size_t count) {
+    ad_HalMemory   *mem     = ad_halMemory(hal);
+    ad_Char        *dst     = ad_halMemoryClaim(mem, &count);
+
+    if (count > 0) {
+        memcpy(dst, cells, count * sizeof(ad_Char));
+        mem->color = cells[count - 1].color;
+    }
+}
+
+static bool ad_halMemoryScrollRows(ad_Hal *hal, uint16_t top, uint16_t bottom, int lines) {
+    ad_HalMemory   *mem     = ad_halMemory(hal);
+    size_t          shift   = (size_t) (lines < 0 ? -lines : lines);
+    size_t          rows;
+
+    bottom = AD_MIN(bottom, mem->height);
+
+    if (top >= bottom || shift == 0) {
+        return true;
+    }
+
+    shift = AD_MIN(shift, (size_t) (bottom - top));
+    rows = bottom - top - shift;
+
+    if (lines > 0) {
+        memmove(&mem->cells[(size_t) top * mem->width], &mem->cells[(top + shift) * mem->width], rows * mem->width * sizeof(ad_Char));
+        memset(&mem->cells[(top + rows) * mem->width], 0, shift * mem->width * sizeof(ad_Char));
+    } else {
+        memmove(&mem->cells[(top + shift) * mem->width], &mem->cells[(size_t) top * mem->width], rows * mem->width * sizeof(ad_Char));
+        memset(&mem->cells[(size_t) top * mem->width], 0, shift * mem->width * sizeof(ad_Char));
+    }
+
+    /* Nothing gets written, but it is a call all the same */
+    mem->pendingWrites++;
+    return true;
+}
+
+static bool ad_halMemoryCanScrollRows(ad_Hal *hal) {
+    AD_UNUSED_PARAMETER(hal);
+    return true;
+}
+
+static uint32_t ad_halMemoryGetKey(ad_Hal *hal) {
+    ad_HalMemory *mem = ad_halMemory(hal);
+
+    /* Once the script is done, ENTER makes every UI component return eventually */
+    if (mem->keyIndex >= mem->keyCount) {
+        return AD_KEY_ENTER;
+    }
+
+    return mem->keys[mem->keyIndex++];
+}
+
+static bool ad_halMemoryWaitForKey(ad_Hal *hal, uint32_t milliseconds) {
+    /* Script keys (and the ENTER after them) are always there right away */
+    AD_UNUSED_PARAMETER(hal);
+    AD_UNUSED_PARAMETER(milliseconds);
+    return true;
+}
+
+static void ad_halMemoryDestroy(ad_Hal *hal) {
+    free(ad_halMemory(hal)->cells);
+    free(ad_halMemory(hal)->keys);
+    free(hal);
+}
+
+ad_Hal *ad_halMemoryCreate(uint16_t width, uint16_t height) {
+    ad_HalMemory *ret = calloc(1, sizeof(ad_HalMemory));
+    AD_RETURN_ON_NULL(ret, NULL);
+
+    ret->cells = calloc((size_t) width * height, sizeof(ad_Char));
+
+    if (ret->cells == NULL || width == 0 || height == 0) {
+        free(ret->cells);
+        free(ret);
+        return NULL;
+    }
+
+    ret->hal.initConsole        = ad_halMemoryInitConsole;
+    ret->hal.restoreConsole     = ad_halMemoryNoArgs;
+    ret->hal.deinitConsole      = ad_halMemoryNoArgs;
+    ret->hal.setColor           = ad_halMemorySetColor;
+    ret->hal.setCursorPosition  = ad_halMemorySetCursorPosition;
+    ret->hal.flush              = ad_halMemoryFlush;
+    ret->hal.getOutputStats     = ad_halMemoryGetOutputStats;
+    ret->hal.putString          = ad_halMemoryPutString;
+    ret->hal.putChar            = ad_halMemoryPutChar;
+    ret->hal.putSpan            = ad_halMemoryPutSpan;
+    ret->hal.scrollRows         = ad_halMemoryScrollRows;
+    ret->hal.canScrollRows      = ad_halMemoryCanScrollRows;
+    ret->hal.getKey             = ad_halMemoryGetKey;
+    ret->hal.waitForKey         = ad_halMemoryWaitForKey;
+    ret->hal.destroy            = ad_halMemoryDestroy;
+    ret->width                  = width;
+    ret->height                 = height;
+
+    return &ret->hal;
+}
+
+bool ad_halMemorySetKeys(ad_Hal *hal, const uint32_t *keys, size_t count) {
+    ad_HalMemory *mem = ad_halMemory(hal);
+    uint32_t     *newKeys = NULL;
+
+    if (count > 0) {
+        newKeys = malloc(count * sizeof(uint32_t));
+        AD_RETURN_ON_NULL(newKeys, false);
+        memcpy(newKeys, keys, count * sizeof(uint32_t));
+    }
+
+    free(mem->keys);
+    mem->keys = newKeys;
+    mem->keyCount = count;
+    mem->keyIndex = 0;
+    return true;
+}
+
+static bool ad_halMemoryParseKey(const char *token, uint32_t *key) {
+    size_t i;
+
+    for (i = 0; i < AD_ARRAY_SIZE(ad_halMemoryKeyNames); i++) {
+        if (strcmp(token, ad_halMemoryKeyNames[i].name) == 0) {
+            *key = ad_halMemoryKeyNames[i].key;
+            return true;
+        }
+    }
+
+    if (token[0] != 0x00 && token[1] == 0x00) {
+        *key = (uint8_t) token[0];
+        return true;
+    }
+
+    if (token[0] == '0' && token[1] == 'x') {
+        *key = (uint32_t) strtoul(token, NULL, 16);
+        return true;
+    }
+
+    return false;
+}
+
+bool ad_halMemoryLoadKeyFile(ad_Hal *hal, const char *fileName) {
+    FILE       *keyFile;
+    char        token[32];
+    uint32_t   *keys        = NULL;
+    size_t      keyCount    = 0;
+    size_t      capacity    = 0;
+    bool        ret;
+
+    AD_RETURN_ON_NULL(fileName, false);
+    keyFile = fopen(fileName, "r");
+    AD_RETURN_ON_NULL(keyFile, false);
+
+    while (fscanf(keyFile, "%31s", token) == 1) {
+        uint32_t key;
+
+        /* Comments go until the end of the line */
+        if (token[0] == '#') {
+            int c;
+            while ((c = fgetc(keyFile)) != EOF && c != '\n');
+            continue;
+        }
+
+        if (!ad_halMemoryParseKey(token, &key)) {
+            continue;
+        }
+
+        if (keyCount == capacity) {
+            uint32_t *newKeys;
+            capacity = capacity ? capacity * 2 : 64;
+            newKeys = realloc(keys, capacity * sizeof(uint32_t));
+            if (newKeys == NULL) {
+                break;
+            }
+            keys = newKeys;
+        }
+
+        keys[keyCount++] = key;
+    }
+
+    fclose(keyFile);
+
+    ret = ad_halMemorySetKeys(hal, keys, keyCount);
+    free(keys);
+    return ret;
+}
+
+size_t ad_halMemoryKeysLeft(ad_Hal *hal) {
+    return ad_halMemory(hal)->keyCount - ad_halMemory(hal)->keyIndex;
+}
+
+const ad_Char *ad_halMemoryGetCells(ad_Hal *hal) {
+    return ad_halMemory(hal)->cells;
+}
+
+bool ad_halMemoryGetRowText(ad_Hal *hal, uint16_t y, char *dst, size_t dstSize) {
+    ad_HalMemory   *mem = ad_halMemory(hal);
+    const ad_Char  *row;
+    size_t          i;
+    size_t          length;
+
+    AD_RETURN_ON_NULL(dst, false);
+
+    if (y >= mem->height || dstSize == 0) {
+        return false;
+    }
+
+    row = &mem->cells[(size_t) y * mem->width];
+    length = AD_MIN((size_t) mem->width, dstSize - 1);
+
+    for (i = 0; i < length; i++) {
+        dst[i] = row[i].ascii ? (char) row[i].ascii : ' ';
+    }
+
+    dst[length] = 0x00;
+    return true;
+}
@@ -40,6 +40,18 @@ void ad_objectPaint(ad_Object *obj) {
 
     assert(obj);
 
+    /* Remember what we are about to cover so unpainting can put it back.
+       If we are already painted (repaint), the old area might differ, so give it back first. */
+    if (obj->underlying != NULL) {
+        ad_screenSnapshotRestore(obj->underlying);
+        ad_screenSnapshotRestore(obj->underlyingFooter);
+        ad_screenSnapshotDestroy(obj->underlying);
+        ad_screenSnapshotDestroy(obj->underlyingFooter);
+    }
+
+    obj->underlying = ad_screenSnapshotCreate(obj->x, obj->y, obj->width, obj->height + 1); /* +1 because of the title bar */
+    obj->underlyingFooter = ad_screenSnapshotCreate(0, ad_s_con.height - 1, ad_s_con.width, 1);
+
     /* Print title */
     ad_printCenteredText(obj->title.text, obj->x, obj->y, obj->width, ad_s_con.titleBg, ad_s_con.titleFg);
 
@@ -57,15 +69,26 @@ void ad_objectUnpaint(ad_Object *obj) {
 
     assert(obj);
 
-    /* Clear window title + body */
-    for (y = 0; y < obj->height + 1; y++) { /* +1 because of the title bar */
-        ad_fill(obj->width, ' ', obj->x, obj->y + y, ad_s_con.backgroundFill, 0);
+    if (obj->underlying != NULL && obj->underlyingFooter != NULL) {
+        /* Put back whatever was there before, no need for anyone to repaint it */
+        ad_screenSnapshotRestore(obj->underlying);
+        ad_screenSnapshotRestore(obj->underlyingFooter);
+    } else {
+        /* Clear window title + body */
+        for (y = 0; y < obj->height + 1; y++) { /* +1 because of the title bar */
+            ad_fill(obj->width, ' ', obj->x, obj->y + y, ad_s_con.backgroundFill, 0);
+        }
+
+        /* Clear footer */
+        ad_clearFooter();
     }
 
-    /* Clear footer */
-    ad_clearFooter();
+    ad_screenSnapshotDestroy(obj->underlying);
+    ad_screenSnapshotDestroy(obj->underlyingFooter);
+    obj->underlying = NULL;
+    obj->underlyingFooter = NULL;
 
-    hal_flush();
+    ad_present();
 }
 
 uint16_t ad_objectGetContentX(ad_Object *obj) {
@@ -26,6 +26,8 @@
 
 #define AD_KEY_PGUP     0xFFFFFF49
 #define AD_KEY_PGDN     0xFFFFFF51
+#define AD_KEY_HOME     0xFFFFFF47
+#define AD_KEY_END      0xFFFFFF4F
 
 #define AD_KEY_UP       0xFFFFFF48
 #define AD_KEY_DOWN     0xFFFFFF50
@@ -47,6 +49,9 @@
 
 #define AD_IS_F_KEY(ch) ((ch >= AD_KEY_F1) && (ch <= AD_KEY_F12))
 
+/* Backspace comes as BS or DEL, depending on the console */
+#define AD_IS_BACKSPACE(ch) ((ch == 0x08) || (ch == 0x7F))
+
 #define AD_TEXT_ELEMENT_SIZE 256
 
 #define AD_CONTENT_MARGIN_H 2
@@ -60,7 +65,21 @@
 #define AD_FOOTER_MULTISELECTOR             "LEFT/RIGHT = Change Option, ENTER = Confirm"
 #define AD_FOOTER_MULTISELECTOR_CANCELABLE  "LEFT/RIGHT = Change Option, ENTER = Confirm, ESC = Cancel"
 
-#define AD_FOOTER_TEXTFILEBOX       "Use Cursor UP / DOWN or Page UP / DOWN to navigate the text."
+#define AD_FOOTER_TEXTFILEBOX           "HOME/END, : = Go to, / ? = Search, %s"
+#define AD_FOOTER_TEXTFILEBOX_GOTO      ":%s_ (Line or percent%%, ENTER = Go, ESC = Cancel)"
+#define AD_FOOTER_TEXTFILEBOX_SEARCH    "%c%s_ (%s%sENTER = Done, ESC = Cancel)"
+#define AD_FOOTER_TEXTFILEBOX_FOUND     "n/N = Next/Previous %c%s (%s), %s"
+#define AD_FOOTER_TEXTFILEBOX_LINE      "Line %lu of %lu"
+#define AD_FOOTER_TEXTFILEBOX_INDEXING  "Line %lu of %lu+ (%lu%% indexed)"
+#define AD_FOOTER_TEXTFILEBOX_OFFSET    "%lu%% into the file (%lu%% indexed)"
+#define AD_FOOTER_TEXTFILEBOX_HITS      "%lu found"
+#define AD_FOOTER_TEXTFILEBOX_COUNTING  "%lu+ found"
+#define AD_FOOTER_TEXTFILEBOX_NO_HITS   "not found"
+
+/* How often the text file box footer catches up with background indexing */
+#define AD_TEXTFILEBOX_REFRESH_MS   100
+/* Offset past any file, for "down to the end of the file" */
+#define AD_TEXTFILEBOX_END          (~(ad_FileOffset) 0)
 
 /* Macros */
 
@@ -77,17 +96,108 @@
 
 #define AD_BUF_SIZE 512
 
+/*  Atomics for values shared between threads. Relaxed ordering, except for the exchange and the
+    Acquire/Release variants.
+    Single-threaded targets (DOS) get plain variables. */
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_ATOMICS__)
+# include <stdatomic.h>
+# define AD_HAS_ATOMICS
+typedef atomic_uint_least32_t ad_AtomicU32;
+# define ad_atomicLoad(ptr)             atomic_load_explicit((ptr), memory_order_relaxed)
+# define ad_atomicStore(ptr, val)       atomic_store_explicit((ptr), (val), memory_order_relaxed)
+# define ad_atomicAdd(ptr, val)         ((void) atomic_fetch_add_explicit((ptr), (val), memory_order_relaxed))
+# define ad_atomicExchange(ptr, val)    atomic_exchange_explicit((ptr), (val), memory_order_acq_rel)
+# define ad_atomicLoadAcquire(ptr)      atomic_load_explicit((ptr), memory_order_acquire)
+# define ad_atomicStoreRelease(ptr, val) atomic_store_explicit((ptr), (val), memory_order_release)
+#elif defined(_MSC_VER) && defined(_WIN32)
+# include <intrin.h>
+# define AD_HAS_ATOMICS
+typedef volatile long ad_AtomicU32;
+# define ad_atomicLoad(ptr)             ((uint32_t) *(ptr))
+# define ad_atomicStore(ptr, val)       ((void) _InterlockedExchange((ptr), (long) (val)))
+# define ad_atomicAdd(ptr, val)         ((void) _InterlockedExchangeAdd((ptr), (long) (val)))
+# define ad_atomicExchange(ptr, val)    ((uint32_t) _InterlockedExchange((ptr), (long) (val)))
+# define ad_atomicLoadAcquire(ptr)      ((uint32_t) *(ptr))        /* volatile has acquire/release semantics in MSVC */
+# define ad_atomicStoreRelease(ptr, val) ((void) (*(ptr) = (long) (val)))
+#elif defined(__GNUC__) && (defined(__unix__) || defined(__APPLE__) || defined(_WIN32))
+/* C99 builds with GCC or clang: the __atomic builtins do the same as stdatomic.h */
+# define AD_HAS_ATOMICS
+typedef uint32_t ad_AtomicU32;
+# define ad_atomicLoad(ptr)             __atomic_load_n((ptr), __ATOMIC_RELAXED)
+# define ad_atomicStore(ptr, val)       __atomic_store_n((ptr), (val), __ATOMIC_RELAXED)
+# define ad_atomicAdd(ptr, val)         ((void) __atomic_fetch_add((ptr), (val), __ATOMIC_RELAXED))
+# define ad_atomicExchange(ptr, val)    __atomic_exchange_n((ptr), (val), __ATOMIC_ACQ_REL)
+# define ad_atomicLoadAcquire(ptr)      __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+# define ad_atomicStoreRelease(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#else
+/* Only for targets without threads, nothing here is safe to share between threads */
+typedef volatile uint32_t ad_AtomicU32;
+# define ad_atomicLoad(ptr)             (*(ptr))
+# define ad_atomicStore(ptr, val)       (*(ptr) = (val))
+# define ad_atomicAdd(ptr, val)         ((void) (*(ptr) += (val)))
+# define ad_atomicExchange(ptr, val)    ad_atomicExchangeU32((ptr), (val))
+# define ad_atomicLoadAcquire(ptr)      (*(ptr))
+# define ad_atomicStoreRelease(ptr, val) (*(ptr) = (val))
+uint32_t ad_atomicExchangeU32(ad_AtomicU32 *ptr, uint32_t val);
+#endif
+
+/* Thread-local storage. Targets without threads don't need it. */
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+# define AD_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__) && (defined(__unix__) || defined(__APPLE__) || defined(_WIN32))
+# define AD_THREAD_LOCAL __thread
+#elif defined(_MSC_VER) && defined(_WIN32)
+# define AD_THREAD_LOCAL __declspec(thread)
+#else
+# define AD_THREAD_LOCAL
+#endif
+
 /* Structures */
 
+typedef struct ad_ScreenSnapshot ad_ScreenSnapshot;
+typedef struct ad_TextView ad_TextView;
+typedef struct ad_TextSearch ad_TextSearch;
+
+/* Position in a file. DOS can't have files anywhere near 4 GB anyway. */
+#if defined(__unix__) || defined(__APPLE__) || defined(_WIN32)
+typedef uint64_t ad_FileOffset;
+#else
+typedef uint32_t ad_FileOffset;
+#endif
+
+/* One version of a file. If any of this changes, so did the file. */
+typedef struct {
+    ad_FileOffset   device;
+    ad_FileOffset   inode;              /* File index on Windows */
+    ad_FileOffset   size;
+    ad_FileOffset   mtime;              /* As fine grained as the platform has it */
+} ad_FileKey;
+
+/* What ad_textViewCheckFile found */
+typedef enum {
+    AD_TEXT_VIEW_UNCHANGED = 0,
+    AD_TEXT_VIEW_GREW,                      /* Data was appended */
+    AD_TEXT_VIEW_REMAPPED,                  /* Data was appended and the file data is somewhere else now */
+    AD_TEXT_VIEW_RELOADED,                  /* The file got shorter, all lines are indexed anew */
+    AD_TEXT_VIEW_BLOCKED                    /* The file got shorter, but the data can't move. Nothing may read it before
+                                               the others reading it are stopped and the file is checked again with <mayMove>. */
+} ad_TextViewChange;
+
 typedef struct {
     char                text[AD_TEXT_ELEMENT_SIZE];
 } ad_TextElement;
 
+/* Lines of a text, all in one buffer. Line breaks are replaced by 0x00, so each line is a C string. */
 typedef struct {
+    char               *text;
     size_t              lineCount;
-    ad_TextElement     *lines;
+    size_t              lineCapacity;
+    size_t             *lineOffsets;        /* Start of each line in text */
+    size_t              longestLine;
 } ad_MultiLineText;
 
+#define ad_multiLineTextGetLine(mlt, index) (&(mlt)->text[(mlt)->lineOffsets[(index)]])
+
 typedef struct {
     uint16_t            x;
     uint16_t            y;
@@ -95,6 +205,8 @@ typedef struct {
     uint16_t            height;
     ad_TextElement      title;
     ad_TextElement      footer;
+    ad_ScreenSnapshot  *underlying;         /* Screen contents covered by the object while it is painted */
+    ad_ScreenSnapshot  *underlyingFooter;
 } ad_Object;
 
 struct ad_TextFileBox {
@@ -103,15 +215,35 @@ struct ad_TextFileBox {
     uint16_t            textY;
     uint16_t            lineWidth;
     int32_t             linesOnScreen;
-    int32_t             currentIndex;
-    int32_t             highestIndex;
-    ad_MultiLineText   *lines;
+    ad_FileOffset       top;                /* Start of the line shown first */
+    size_t              currentIndex;       /* Its number, only valid if indexKnown */
+    bool                indexKnown;         /* Not after jumping past where the index and checkpoints reach */
+    ad_TextView        *view;
+    ad_TextElement      searchText;         /* Nothing is searched for while searchLength is 0 */
+    size_t              searchLength;
+    bool                searchBackward;     /* Started with ? instead of / */
+    bool                searchEditing;      /* Search text is being typed */
+    ad_FileOffset       searchOrigin;       /* Top of the box when typing started, ESC goes back there */
+    ad_TextSearch      *find;               /* Looks for the hit to go to, NULL once that was taken care of */
+    ad_TextSearch      *count;
+    bool                hasHit;
+    ad_FileOffset       hit;
+    bool                following;          /* Shows what gets appended to the file, like tail -f */
+    ad_TextElement      gotoText;           /* Line number or percentage typed after : */
+    size_t              gotoLength;
+    bool                gotoEditing;
+    size_t              column;             /* First column shown, for lines wider than the box */
+    bool                wrap;               /* Long lines go on in the rows below instead */
+    size_t              currentRow;         /* Row of the top line that is shown first when wrapping */
 };
 
 typedef struct {
     ad_TextElement      label;
     uint32_t            outOf;
+    uint32_t            progress;           /* Latest progress value, may not be on screen yet */
     uint16_t            currentX;
+    ad_AtomicU32        publishedProgress;  /* Written by any thread, picked up by ad_progressBoxSample */
+    ad_AtomicU32        publishedOutOf;
 } ad_Progress;
 
 struct ad_ProgressBox {
@@ -123,6 +255,10 @@ struct ad_ProgressBox {
     uint16_t            labelX;
     uint16_t            boxWidth;
     ad_MultiLineText   *prompt;
+    uint32_t            refreshInterval;    /* Minimum milliseconds between redraws, 0 = redraw on every update */
+    uint32_t            lastRefresh;
+    bool                dirty;              /* Progress values changed since the last redraw */
+    ad_AtomicU32        published;          /* Set when any published value changed since the last sample */
 };
 
 struct ad_Menu {
@@ -186,7 +322,23 @@ struct ad_ConsoleConfig {
     uint8_t             backgroundFill;
 };
 
-extern struct ad_ConsoleConfig ad_s_con;
+/*  Everything that belongs to one UI. The screen state and the render thread are owned by
+    ad_state.c and ad_async.c and get allocated when needed. */
+struct ad_Context {
+    struct ad_Hal          *hal;
+    struct ad_ConsoleConfig con;
+    ad_TextElement          title;
+    struct ad_ScreenState  *screen;
+    struct ad_AsyncState   *async;
+    ad_TextElement          indexCache;     /* Directory for line index cache files, empty if off */
+};
+
+/* The calling thread's current context */
+extern AD_THREAD_LOCAL struct ad_Context *ad_s_ctx;
+
+#define ad_s_con    (ad_s_ctx->con)
+#define ad_s_title  (ad_s_ctx->title)
+#define ad_s_hal    (ad_s_ctx->hal)
 
 void                ad_objectInitialize                 (ad_Object *obj, size_t contentWidth, size_t contentHeight);
 void                ad_objectPaint                      (ad_Object *obj);
@@ -207,22 +359,112 @@ ad_TextElement*     ad_textElementArrayResize           (ad_TextElement *ptr, si
 size_t              ad_textElementArrayGetLongestLength (size_t items, ad_TextElement *elements);
 
 ad_MultiLineText   *ad_multiLineTextCreate              (const char *str);
+/* Takes over <buffer> (<size> bytes, 0x00 terminated, allocated with malloc), it is freed on failure too */
+ad_MultiLineText   *ad_multiLineTextCreateFromBuffer    (char *buffer, size_t size);
 void                ad_multiLineTextDestroy             (ad_MultiLineText *obj);
 
+/* With <follow>, the view keeps watching the file for data appended to it (ad_textViewCheckFile). Not possible on DOS. */
+ad_TextView        *ad_textViewOpen                     (const char *fileName, bool follow);
+void                ad_textViewClose                    (ad_TextView *view);
+/* Finds line <line>, through the index or the nearest checkpoint past it. Returns false if the file has fewer lines. */
+bool                ad_textViewIndexTo                  (ad_TextView *view, size_t line);
+/* Lines known so far, <complete> (can be NULL) tells if that's all of them */
+size_t              ad_textViewGetLineCount             (const ad_TextView *view, bool *complete);
+size_t              ad_textViewGetLongestLine           (const ad_TextView *view);
+/* Returns line <line> (not 0x00 terminated) and its length without the line break, NULL if there is no such line */
+const char         *ad_textViewGetLine                  (ad_TextView *view, size_t line, size_t *length);
+/* Indexes the rest of the file on worker threads. Returns false if that isn't possible or worth it, indexing then stays lazy. */
+bool                ad_textViewIndexInBackground        (ad_TextView *view);
+/* Takes over the lines the background indexing has found by now */
+void                ad_textViewUpdate                   (ad_TextView *view);
+bool                ad_textViewIsIndexing               (const ad_TextView *view);
+/* How much of the file is indexed, 0 - 100 */
+uint32_t            ad_textViewGetIndexedPercent        (const ad_TextView *view);
+/* Where line <line> starts in the file, the file size if there is no such line */
+ad_FileOffset       ad_textViewGetLineStart             (ad_TextView *view, size_t line);
+/* Number of the line that starts at <start>, if the index, a checkpoint or the last line looked up is at most a checkpoint
+   interval before it. Returns false otherwise, nothing further is counted: the number is known once the indexing gets there. */
+bool                ad_textViewLookupLine               (ad_TextView *view, ad_FileOffset start, size_t *line);
+/* Like ad_textViewGetLine, for the line that starts at <start>. Needs no index, for lines whose number isn't known. */
+const char         *ad_textViewGetLineAt                (const ad_TextView *view, ad_FileOffset start, size_t *length);
+/* Moves <start> to the start of the next / previous line. Return false if there is none. */
+bool                ad_textViewNextLine                 (const ad_TextView *view, ad_FileOffset *start);
+bool                ad_textViewPreviousLine             (const ad_TextView *view, ad_FileOffset *start);
+/* Start of the line that <offset> is in (the last line if that is past the end), scanning back to it like less does */
+ad_FileOffset       ad_textViewLineStartAt              (const ad_TextView *view, ad_FileOffset offset);
+/* The whole file. Stays valid and unchanged until the view is closed or ad_textViewCheckFile moves it, so other threads can read it. */
+const char         *ad_textViewGetData                  (const ad_TextView *view, ad_FileOffset *size);
+/* Takes in what was appended to a followed file since the last call and indexes it if the index was complete.
+   Any file that was cut short is read in again (mapped) or from the start (followed).
+   Unless <mayMove>, nothing is done that would pull the data away from under other threads reading it. */
+ad_TextViewChange   ad_textViewCheckFile                (ad_TextView *view, bool mayMove);
+/* Takes the line index from the cache in <directory> if there is one for this very version of the file.
+   Must be called before any indexing. Returns true if the view is completely indexed now. */
+bool                ad_textViewLoadIndex                (ad_TextView *view, const char *directory);
+/* Puts the line index into the cache in <directory>, if it is complete, didn't come from there and the file is big enough to bother */
+bool                ad_textViewStoreIndex               (ad_TextView *view, const char *directory);
+
+/* Line index cache files (ad_cache.c). <offsets> are the starts of all <count> lines of the file <key> belongs to. Not available on DOS. */
+/* On success, <offsets> is allocated with malloc */
+bool                ad_lineCacheLoad                    (const char *directory, const ad_FileKey *key, ad_FileOffset **offsets, size_t *count, size_t *longestLine);
+bool                ad_lineCacheStore                   (const char *directory, const ad_FileKey *key, const ad_FileOffset *offsets, size_t count, size_t longestLine);
+
+/* Searching a text view (ad_find.c). Where there are threads, searches run on one, otherwise they are done right away. */
+/* Looks for <pattern> from <origin> on towards the end of the file, or towards the start if <backward> (hits that start before <origin>).
+   Wraps around if there is no hit that way. Backwards, only hits that don't overlap the ones before them in the line are found,
+   just like they are counted. <origin> has to be the start of a line or right after such a hit for that to hold going forward. */
+ad_TextSearch      *ad_textSearchFind                   (ad_TextView *view, const char *pattern, size_t length, ad_FileOffset origin, bool backward);
+/* Counts the hits of <pattern> in the whole file */
+ad_TextSearch      *ad_textSearchCount                  (ad_TextView *view, const char *pattern, size_t length);
+bool                ad_textSearchIsDone                 (ad_TextSearch *search);
+/* The hit a find has found. Returns false if there is none or the search isn't done yet. */
+bool                ad_textSearchGetHit                 (ad_TextSearch *search, ad_FileOffset *hit);
+/* Hits counted so far */
+uint32_t            ad_textSearchGetCount               (ad_TextSearch *search);
+/* Waits until the search is done */
+void                ad_textSearchWait                   (ad_TextSearch *search);
+/* Stops the search if it is still going and frees it. NULL is fine. */
+void                ad_textSearchDestroy                (ad_TextSearch *search);
+
+/* Writes base + the position of each <byte> in <data> to <positions>, up to <maxCount>. Returns how many were found,
+   if that is <maxCount> there may be more after the last one. Vectorized like the cell kernels (ad_simd.c). */
+size_t              ad_bytesFindAll                     (const char *data, size_t size, char byte, ad_FileOffset base, ad_FileOffset *positions, size_t maxCount);
+/* Position of the <n>th (from 1) <byte> in <data>, <size> if there are fewer. <count> gets how many were found on the way. */
+size_t              ad_bytesFindNth                     (const char *data, size_t size, char byte, size_t n, size_t *count);
+/* Position of the first occurrence of <pattern> in <data>, <size> if there is none */
+size_t              ad_bytesFind                        (const char *data, size_t size, const char *pattern, size_t patternLength);
+
 void                ad_displayStringCropped             (const char *str, uint16_t x, uint16_t y, size_t maxLen, uint8_t bg, uint8_t fg);
+/* Same for text that isn't 0x00 terminated and may have control characters in it (e.g. from a file) */
+void                ad_displayTextCropped               (const char *str, size_t length, uint16_t x, uint16_t y, size_t maxLen, uint8_t bg, uint8_t fg);
 void                ad_displayTextElementArray          (uint16_t x, uint16_t y, size_t maximumWidth, size_t count, ad_TextElement *elements);
+void                ad_displayMultiLineText             (uint16_t x, uint16_t y, size_t maximumWidth, const ad_MultiLineText *text, size_t first, size_t count);
 void                ad_printCenteredText                (const char *str, uint16_t x, uint16_t y, uint16_t w, uint8_t colBg, uint8_t colFg);
 
 void                ad_drawBackground                   (const char *title);
 void                ad_fill                             (size_t length, char fill, uint16_t x, uint16_t y, uint8_t colBg, uint8_t colFg);
 size_t              ad_getPadding                       (size_t totalLength, size_t lengthToPad);
+/* Monotonic wall clock in milliseconds, wraps around */
+uint32_t            ad_getMilliseconds                  (void);
 
 /* Screen state helpers */
 bool                ad_initConsole                      (struct ad_ConsoleConfig *cfg);
 void                ad_deinitConsole                    (void);
 void                ad_setColor                         (uint8_t bg, uint8_t fg);
+/* AD_ATTR_* flags (ad_hal.h) for everything drawn from now on */
+void                ad_setAttributes                    (uint8_t attr);
 void                ad_setCursorPosition                (uint16_t x, uint16_t y);
 void                ad_putString                        (const char *str);
+void                ad_putStringWithLength              (const char *str, size_t length);
+/* Control characters would mess up the console, so this one shows them as spaces */
+void                ad_putTextWithLength                (const char *str, size_t length);
 void                ad_putChar                          (char c, size_t count);
+/* Marks the screen contents as unknown, the next ad_present will repaint everything */
+void                ad_screenInvalidate                 (void);
+/* Copies a rectangle of the screen (clipped to the screen), including cursor and color */
+ad_ScreenSnapshot  *ad_screenSnapshotCreate             (uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+/* Puts the snapshot contents back. Needs an ad_present to become visible. */
+void                ad_screenSnapshotRestore            (const ad_ScreenSnapshot *snap);
+void                ad_screenSnapshotDestroy            (ad_ScreenSnapshot *snap);
 
 #endif
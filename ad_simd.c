@@ -0,0 +1,332 @@
+/*
+    AnbUI Miniature Text UI Lib for Burger Enjoyers(tm)
+
+    ad_simd: Cell row kernels
+
+    Cells are four bytes without padding, so comparing or filling rows
+    of them boils down to 32-bit words. Where the compiler targets SSE2
+    or AVX2 (e.g. x86-64, or -mavx2 / -march=native), whole vectors of
+    cells are handled at once. Everything else gets the scalar version.
+
+    The same vectors also look for bytes in text, e.g. line breaks, and
+    for search patterns.
+
+    Tip of the day: Eight patties on the grill at once cook just as
+    fast as one. The trick is a big enough grill.
+
+    (C) 2026 E. Voirin (oerg866) */
+
+#include <string.h>
+
+#include "anbui.h"
+#include "ad_priv.h"
+#include "ad_hal.h"
+
+/* Fails to compile if ad_Char ever gets padded */
+typedef char ad_CellSizeCheck[(sizeof(ad_Char) == sizeof(uint32_t)) ? 1 : -1];
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+typedef __m256i ad_Vec;
+# define AD_SIMD_NAME               "AVX2"
+# define AD_VEC_CELLS               8
+# define AD_VEC_MASK                0xFFFFFFFFUL
+# define ad_vecLoad(ptr)            _mm256_loadu_si256((const __m256i *) (ptr))
+# define ad_vecStore(ptr, v)        _mm256_storeu_si256((__m256i *) (ptr), (v))
+# define ad_vecSplat(val)           _mm256_set1_epi32((int) (val))
+# define ad_vecEqual(a, b)          _mm256_cmpeq_epi32(ad_vecLoad(a), ad_vecLoad(b))
+# define ad_vecAnd(a, b)            _mm256_and_si256((a), (b))
+# define ad_vecMix(h, v)            _mm256_xor_si256(_mm256_add_epi32(_mm256_slli_epi32((h), 5), (h)), (v))
+# define ad_vecMask(v)              ((uint32_t) _mm256_movemask_epi8(v))
+# define ad_vecSplatByte(val)       _mm256_set1_epi8((char) (val))
+# define ad_vecEqualBytes(a, b)     _mm256_cmpeq_epi8((a), (b))
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+typedef __m128i ad_Vec;
+# define AD_SIMD_NAME               "SSE2"
+# define AD_VEC_CELLS               4
+# define AD_VEC_MASK                0x0000FFFFUL
+# define ad_vecLoad(ptr)            _mm_loadu_si128((const __m128i *) (ptr))
+# define ad_vecStore(ptr, v)        _mm_storeu_si128((__m128i *) (ptr), (v))
+# define ad_vecSplat(val)           _mm_set1_epi32((int) (val))
+# define ad_vecEqual(a, b)          _mm_cmpeq_epi32(ad_vecLoad(a), ad_vecLoad(b))
+# define ad_vecAnd(a, b)            _mm_and_si128((a), (b))
+# define ad_vecMix(h, v)            _mm_xor_si128(_mm_add_epi32(_mm_slli_epi32((h), 5), (h)), (v))
+# define ad_vecMask(v)              ((uint32_t) _mm_movemask_epi8(v))
+# define ad_vecSplatByte(val)       _mm_set1_epi8((char) (val))
+# define ad_vecEqualBytes(a, b)     _mm_cmpeq_epi8((a), (b))
+#else
+# define AD_SIMD_NAME               "scalar"
+#endif
+
+#if defined(AD_VEC_CELLS)
+/* Mostly rows are equal, so four vectors at a time are checked for that first */
+# define AD_VEC_BLOCK_CELLS         (4 * AD_VEC_CELLS)
+# define ad_vecBlockEqual(a, b)     (ad_vecMask(ad_vecAnd( \
+    ad_vecAnd(ad_vecEqual((a), (b)), ad_vecEqual((a) + AD_VEC_CELLS, (b) + AD_VEC_CELLS)), \
+    ad_vecAnd(ad_vecEqual((a) + 2 * AD_VEC_CELLS, (b) + 2 * AD_VEC_CELLS), ad_vecEqual((a) + 3 * AD_VEC_CELLS, (b) + 3 * AD_VEC_CELLS)))) == AD_VEC_MASK)
+
+/* Bit scans on the byte masks above, one bit per byte -> sizeof(ad_Char) bits per cell */
+# if defined(_MSC_VER)
+#  include <intrin.h>
+static inline unsigned ad_simdLowestBit(uint32_t mask) {
+    unsigned long i;
+    _BitScanForward(&i, mask);
+    return (unsigned) i;
+}
+static inline unsigned ad_simdHighestBit(uint32_t mask) {
+    unsigned long i;
+    _BitScanReverse(&i, mask);
+    return (unsigned) i;
+}
+/* __popcnt needs a CPU with POPCNT, SSE2 alone doesn't guarantee that */
+static inline unsigned ad_simdBitCount(uint32_t mask) {
+    mask = mask - ((mask >> 1) & 0x55555555UL);
+    mask = (mask & 0x33333333UL) + ((mask >> 2) & 0x33333333UL);
+    return (unsigned) ((((mask + (mask >> 4)) & 0x0F0F0F0FUL) * 0x01010101UL) >> 24);
+}
+# else
+#  define ad_simdLowestBit(mask)    ((unsigned) __builtin_ctz(mask))
+#  define ad_simdHighestBit(mask)   (31u - (unsigned) __builtin_clz(mask))
+#  define ad_simdBitCount(mask)     ((unsigned) __builtin_popcount(mask))
+# endif
+#endif
+
+static inline uint32_t ad_cellPack(const ad_Char *cell) {
+    uint32_t ret;
+    memcpy(&ret, cell, sizeof(ret));
+    return ret;
+}
+
+size_t ad_cellsFirstDiff(const ad_Char *a, const ad_Char *b, size_t count) {
+    size_t i = 0;
+
+#if defined(AD_VEC_CELLS)
+    for (; i + AD_VEC_BLOCK_CELLS <= count && ad_vecBlockEqual(&a[i], &b[i]); i += AD_VEC_BLOCK_CELLS);
+
+    for (; i + AD_VEC_CELLS <= count; i += AD_VEC_CELLS) {
+        uint32_t diff = ~ad_vecMask(ad_vecEqual(&a[i], &b[i])) & AD_VEC_MASK;
+
+        if (diff != 0) {
+            return i + ad_simdLowestBit(diff) / sizeof(ad_Char);
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        if (ad_cellPack(&a[i]) != ad_cellPack(&b[i])) {
+            return i;
+        }
+    }
+
+    return count;
+}
+
+size_t ad_cellsLastDiff(const ad_Char *a, const ad_Char *b, size_t count) {
+    size_t i = count;
+
+#if defined(AD_VEC_CELLS)
+    /* The cells at the end that don't fill a whole vector go first, then it's whole vectors down to 0 */
+    for (; i % AD_VEC_CELLS != 0; i--) {
+        if (ad_cellPack(&a[i - 1]) != ad_cellPack(&b[i - 1])) {
+            return i;
+        }
+    }
+
+    for (; i >= AD_VEC_BLOCK_CELLS && ad_vecBlockEqual(&a[i - AD_VEC_BLOCK_CELLS], &b[i - AD_VEC_BLOCK_CELLS]); i -= AD_VEC_BLOCK_CELLS);
+
+    for (; i >= AD_VEC_CELLS; i -= AD_VEC_CELLS) {
+        size_t   start = i - AD_VEC_CELLS;
+        uint32_t diff  = ~ad_vecMask(ad_vecEqual(&a[start], &b[start])) & AD_VEC_MASK;
+
+        if (diff != 0) {
+            return start + ad_simdHighestBit(diff) / sizeof(ad_Char) + 1;
+        }
+    }
+#endif
+
+    for (; i > 0; i--) {
+        if (ad_cellPack(&a[i - 1]) != ad_cellPack(&b[i - 1])) {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+void ad_cellsFill(ad_Char *dst, ad_Char cell, size_t count) {
+    size_t i = 0;
+#if defined(AD_VEC_CELLS)
+    ad_Vec v = ad_vecSplat(ad_cellPack(&cell));
+
+    for (; i + AD_VEC_CELLS <= count; i += AD_VEC_CELLS) {
+        ad_vecStore(&dst[i], v);
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = cell;
+    }
+}
+
+/* FNV-1a on whole cells instead of bytes */
+static uint32_t ad_cellsFnv(uint32_t hash, const ad_Char *cells, size_t count) {
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        hash = (hash ^ ad_cellPack(&cells[i])) * 16777619UL;
+    }
+
+    return hash;
+}
+
+/*  With vectors, each lane first does h * 33 ^ cell on its own share of the cells, then the lanes go into FNV-1a.
+    There are four vectors of lanes so they don't have to wait on each other. */
+uint32_t ad_cellsHash(const ad_Char *cells, size_t count) {
+    uint32_t hash = 2166136261UL;
+    size_t   i    = 0;
+
+#if defined(AD_VEC_CELLS)
+    if (count >= AD_VEC_BLOCK_CELLS) {
+        ad_Vec  lanes0 = ad_vecSplat(5381);
+        ad_Vec  lanes1 = lanes0;
+        ad_Vec  lanes2 = lanes0;
+        ad_Vec  lanes3 = lanes0;
+        ad_Char folded[AD_VEC_BLOCK_CELLS];
+
+        for (; i + AD_VEC_BLOCK_CELLS <= count; i += AD_VEC_BLOCK_CELLS) {
+            lanes0 = ad_vecMix(lanes0, ad_vecLoad(&cells[i]));
+            lanes1 = ad_vecMix(lanes1, ad_vecLoad(&cells[i + AD_VEC_CELLS]));
+            lanes2 = ad_vecMix(lanes2, ad_vecLoad(&cells[i + 2 * AD_VEC_CELLS]));
+            lanes3 = ad_vecMix(lanes3, ad_vecLoad(&cells[i + 3 * AD_VEC_CELLS]));
+        }
+
+        ad_vecStore(&folded[0], lanes0);
+        ad_vecStore(&folded[AD_VEC_CELLS], lanes1);
+        ad_vecStore(&folded[2 * AD_VEC_CELLS], lanes2);
+        ad_vecStore(&folded[3 * AD_VEC_CELLS], lanes3);
+        hash = ad_cellsFnv(hash, folded, AD_VEC_BLOCK_CELLS);
+    }
+#endif
+
+    return ad_cellsFnv(hash, &cells[i], count - i);
+}
+
+size_t ad_bytesFindAll(const char *data, size_t size, char byte, ad_FileOffset base, ad_FileOffset *positions, size_t maxCount) {
+    size_t found = 0;
+    size_t i     = 0;
+
+#if defined(AD_VEC_CELLS)
+    ad_Vec needle = ad_vecSplatByte(byte);
+
+    /* One bit per byte that matches, taken out lowest first */
+    for (; i + sizeof(ad_Vec) <= size; i += sizeof(ad_Vec)) {
+        uint32_t mask = ad_vecMask(ad_vecEqualBytes(ad_vecLoad(&data[i]), needle));
+
+        for (; mask != 0; mask &= mask - 1) {
+            if (found == maxCount) {
+                return found;
+            }
+            positions[found++] = base + (ad_FileOffset) (i + ad_simdLowestBit(mask));
+        }
+    }
+#endif
+
+    for (; i < size && found < maxCount; i++) {
+        if (data[i] == byte) {
+            positions[found++] = base + (ad_FileOffset) i;
+        }
+    }
+
+    return found;
+}
+
+size_t ad_bytesFindNth(const char *data, size_t size, char byte, size_t n, size_t *count) {
+    size_t found = 0;
+    size_t i     = 0;
+
+#if defined(AD_VEC_CELLS)
+    ad_Vec needle = ad_vecSplatByte(byte);
+
+    /* Vectors are only counted, the one the nth byte is in gets taken apart */
+    for (; i + sizeof(ad_Vec) <= size; i += sizeof(ad_Vec)) {
+        uint32_t mask = ad_vecMask(ad_vecEqualBytes(ad_vecLoad(&data[i]), needle));
+        size_t   bits = ad_simdBitCount(mask);
+
+        if (n - found <= bits) {
+            for (; found + 1 < n; found++) {
+                mask &= mask - 1;
+            }
+
+            *count = n;
+            return i + ad_simdLowestBit(mask);
+        }
+
+        found += bits;
+    }
+#endif
+
+    for (; i < size; i++) {
+        if (data[i] == byte && ++found == n) {
+            *count = found;
+            return i;
+        }
+    }
+
+    *count = found;
+    return size;
+}
+
+size_t ad_bytesFind(const char *data, size_t size, const char *pattern, size_t patternLength) {
+    size_t i = 0;
+    size_t last;
+
+    if (patternLength == 0 || patternLength > size) {
+        return patternLength == 0 ? 0 : size;
+    }
+
+    last = patternLength - 1;
+
+#if defined(AD_VEC_CELLS)
+    {
+        ad_Vec first    = ad_vecSplatByte(pattern[0]);
+        ad_Vec final    = ad_vecSplatByte(pattern[last]);
+
+        /* Only where the first and the last byte of the pattern both match is the rest worth a look */
+        for (; i + last + sizeof(ad_Vec) <= size; i += sizeof(ad_Vec)) {
+            uint32_t mask = ad_vecMask(ad_vecAnd(ad_vecEqualBytes(ad_vecLoad(&data[i]), first),
+                                                 ad_vecEqualBytes(ad_vecLoad(&data[i + last]), final)));
+
+            for (; mask != 0; mask &= mask - 1) {
+                size_t pos = i + ad_simdLowestBit(mask);
+
+                if (memcmp(&data[pos], pattern, patternLength) == 0) {
+                    return pos;
+                }
+            }
+        }
+    }
+#endif
+
+    while (i + last < size) {
+        const char *found = memchr(&data[i], pattern[0], size - last - i);
+
+        if (found == NULL) {
+            break;
+        }
+
+        i = (size_t) (found - data);
+
+        if (memcmp(found, pattern, patternLength) == 0) {
+            return i;
+        }
+
+        i++;
+    }
+
+    return size;
+}
+
+const char *ad_cellsKernelName(void) {
+    return AD_SIMD_NAME;
+}
@@ -0,0 +1,678 @@
+/*
+    AnbUI Miniature Text UI Lib for Burger Enjoyers(tm)
+
+    ad_sink: HAL sinks and wrappers (null output, counting, tracing, recording, throttling, mirroring)
+
+    Wrappers forward everything to an inner HAL and do their thing on the side,
+    so they can be stacked on top of each other and on top of any other HAL.
+
+    Tip of the day: A burger wrapped in a burger wrapper is still a burger.
+    A burger wrapper wrapped in a burger, however, is a wrapper burger.
+
+    (C) 2026 E. Voirin (oerg866) */
+
+#if defined(__unix__) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L     /* nanosleep */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include "anbui.h"
+#include "ad_priv.h"
+#include "ad_hal.h"
+
+void ad_halDestroy(ad_Hal *hal) {
+    if (hal != NULL && hal->destroy != NULL) {
+        hal->destroy(hal);
+    }
+}
+
+static void ad_halFree(ad_Hal *hal) {
+    free(hal);
+}
+
+/* Wrappers: the wrapping HAL always comes first, so it can be cast back from the ad_Hal pointer */
+
+typedef struct {
+    ad_Hal      hal;
+    ad_Hal     *inner;
+} ad_HalWrapper;
+
+#define ad_halInner(hal) (((ad_HalWrapper *) (hal))->inner)
+
+static void ad_halForwardInitConsole(ad_Hal *hal, ad_ConsoleConfig *cfg)                { ad_Hal *in = ad_halInner(hal); in->initConsole(in, cfg); }
+static void ad_halForwardRestoreConsole(ad_Hal *hal)                                    { ad_Hal *in = ad_halInner(hal); in->restoreConsole(in); }
+static void ad_halForwardDeinitConsole(ad_Hal *hal)                                     { ad_Hal *in = ad_halInner(hal); in->deinitConsole(in); }
+static void ad_halForwardSetColor(ad_Hal *hal, uint8_t bg, uint8_t fg)                  { ad_Hal *in = ad_halInner(hal); in->setColor(in, bg, fg); }
+static void ad_halForwardSetCursorPosition(ad_Hal *hal, uint16_t x, uint16_t y)         { ad_Hal *in = ad_halInner(hal); in->setCursorPosition(in, x, y); }
+static void ad_halForwardFlush(ad_Hal *hal)                                             { ad_Hal *in = ad_halInner(hal); in->flush(in); }
+static void ad_halForwardGetOutputStats(ad_Hal *hal, ad_OutputStats *stats)             { ad_Hal *in = ad_halInner(hal); in->getOutputStats(in, stats); }
+static void ad_halForwardPutString(ad_Hal *hal, const char *str)                        { ad_Hal *in = ad_halInner(hal); in->putString(in, str); }
+static void ad_halForwardPutChar(ad_Hal *hal, char c, size_t count)                     { ad_Hal *in = ad_halInner(hal); in->putChar(in, c, count); }
+static void ad_halForwardPutSpan(ad_Hal *hal, const ad_Char *cells, size_t count)       { ad_Hal *in = ad_halInner(hal); in->putSpan(in, cells, count); }
+static bool ad_halForwardScrollRows(ad_Hal *hal, uint16_t top, uint16_t bottom, int lines)   { ad_Hal *in = ad_halInner(hal); return in->scrollRows(in, top, bottom, lines); }
+static bool ad_halForwardCanScrollRows(ad_Hal *hal)                                     { ad_Hal *in = ad_halInner(hal); return in->canScrollRows(in); }
+static uint32_t ad_halForwardGetKey(ad_Hal *hal)                                        { ad_Hal *in = ad_halInner(hal); return in->getKey(in); }
+static bool ad_halForwardWaitForKey(ad_Hal *hal, uint32_t milliseconds)                 { ad_Hal *in = ad_halInner(hal); return in->waitForKey(in, milliseconds); }
+
+static const ad_Hal ad_halForwardAll = {
+    ad_halForwardInitConsole,
+    ad_halForwardRestoreConsole,
+    ad_halForwardDeinitConsole,
+    ad_halForwardSetColor,
+    ad_halForwardSetCursorPosition,
+    ad_halForwardFlush,
+    ad_halForwardGetOutputStats,
+    ad_halForwardPutString,
+    ad_halForwardPutChar,
+    ad_halForwardPutSpan,
+    ad_halForwardScrollRows,
+    ad_halForwardCanScrollRows,
+    ad_halForwardGetKey,
+    ad_halForwardWaitForKey,
+    ad_halFree
+};
+
+/* Null sink */
+
+typedef struct {
+    ad_Hal      hal;
+    uint16_t    width;
+    uint16_t    height;
+} ad_HalNull;
+
+static void ad_halNullInitConsole(ad_Hal *hal, ad_ConsoleConfig *cfg) {
+    cfg->width = ((ad_HalNull *) hal)->width;
+    cfg->height = ((ad_HalNull *) hal)->height;
+}
+
+static void ad_halNullNoArgs(ad_Hal *hal)                                               { AD_UNUSED_PARAMETER(hal); }
+static void ad_halNullSetColor(ad_Hal *hal, uint8_t bg, uint8_t fg)                     { AD_UNUSED_PARAMETER(hal); AD_UNUSED_PARAMETER(bg); AD_UNUSED_PARAMETER(fg); }
+static void ad_halNullSetCursorPosition(ad_Hal *hal, uint16_t x, uint16_t y)            { AD_UNUSED_PARAMETER(hal); AD_UNUSED_PARAMETER(x); AD_UNUSED_PARAMETER(y); }
+static void ad_halNullGetOutputStats(ad_Hal *hal, ad_OutputStats *stats)                { AD_UNUSED_PARAMETER(hal); memset(stats, 0, sizeof(ad_OutputStats)); }
+static void ad_halNullPutString(ad_Hal *hal, const char *str)                           { AD_UNUSED_PARAMETER(hal); AD_UNUSED_PARAMETER(str); }
+static void ad_halNullPutChar(ad_Hal *hal, char c, size_t count)                        { AD_UNUSED_PARAMETER(hal); AD_UNUSED_PARAMETER(c); AD_UNUSED_PARAMETER(count); }
+static void ad_halNullPutSpan(ad_Hal *hal, const ad_Char *cells, size_t count)          { AD_UNUSED_PARAMETER(hal); AD_UNUSED_PARAMETER(cells); AD_UNUSED_PARAMETER(count); }
+static bool ad_halNullScrollRows(ad_Hal *hal, uint16_t top, uint16_t bottom, int lines)  { AD_UNUSED_PARAMETER(hal); AD_UNUSED_PARAMETER(top); AD_UNUSED_PARAMETER(bottom); AD_UNUSED_PARAMETER(lines); return true; }
+static bool ad_halNullCanScrollRows(ad_Hal *hal)                                        { AD_UNUSED_PARAMETER(hal); return true; }
+static uint32_t ad_halNullGetKey(ad_Hal *hal)                                           { AD_UNUSED_PARAMETER(hal); return AD_KEY_ENTER; }
+static bool ad_halNullWaitForKey(ad_Hal *hal, uint32_t milliseconds)                    { AD_UNUSED_PARAMETER(hal); AD_UNUSED_PARAMETER(milliseconds); return true; }
+
+ad_Hal *ad_halNullCreate(uint16_t width, uint16_t height) {
+    ad_HalNull *ret = calloc(1, sizeof(ad_HalNull));
+    AD_RETURN_ON_NULL(ret, NULL);
+
+    ret->hal.initConsole        = ad_halNullInitConsole;
+    ret->hal.restoreConsole     = ad_halNullNoArgs;
+    ret->hal.deinitConsole      = ad_halNullNoArgs;
+    ret->hal.setColor           = ad_halNullSetColor;
+    ret->hal.setCursorPosition  = ad_halNullSetCursorPosition;
+    ret->hal.flush              = ad_halNullNoArgs;
+    ret->hal.getOutputStats     = ad_halNullGetOutputStats;
+    ret->hal.putString          = ad_halNullPutString;
+    ret->hal.putChar            = ad_halNullPutChar;
+    ret->hal.putSpan            = ad_halNullPutSpan;
+    ret->hal.scrollRows         = ad_halNullScrollRows;
+    ret->hal.canScrollRows      = ad_halNullCanScrollRows;
+    ret->hal.getKey             = ad_halNullGetKey;
+    ret->hal.waitForKey         = ad_halNullWaitForKey;
+    ret->hal.destroy            = ad_halFree;
+    ret->width                  = width;
+    ret->height                 = height;
+
+    return &ret->hal;
+}
+
+/* Counter */
+
+typedef struct {
+    ad_Hal          hal;
+    ad_Hal         *inner;
+    ad_HalCounters  counters;
+} ad_HalCounter;
+
+#define ad_halCounters(hal) (&((ad_HalCounter *) (hal))->counters)
+
+static void ad_halCounterSetColor(ad_Hal *hal, uint8_t bg, uint8_t fg) {
+    ad_halCounters(hal)->setColor++;
+    ad_halForwardSetColor(hal, bg, fg);
+}
+
+static void ad_halCounterSetCursorPosition(ad_Hal *hal, uint16_t x, uint16_t y) {
+    ad_halCounters(hal)->setCursorPosition++;
+    ad_halForwardSetCursorPosition(hal, x, y);
+}
+
+static void ad_halCounterFlush(ad_Hal *hal) {
+    ad_halCounters(hal)->flush++;
+    ad_halForwardFlush(hal);
+}
+
+static void ad_halCounterPutString(ad_Hal *hal, const char *str) {
+    ad_halCounters(hal)->putString++;
+    ad_halCounters(hal)->cells += (uint32_t) strlen(str);
+    ad_halForwardPutString(hal, str);
+}
+
+static void ad_halCounterPutChar(ad_Hal *hal, char c, size_t count) {
+    ad_halCounters(hal)->putChar++;
+    ad_halCounters(hal)->cells += (uint32_t) count;
+    ad_halForwardPutChar(hal, c, count);
+}
+
+static void ad_halCounterPutSpan(ad_Hal *hal, const ad_Char *cells, size_t count) {
+    ad_halCounters(hal)->putSpan++;
+    ad_halCounters(hal)->cells += (uint32_t) count;
+    ad_halForwardPutSpan(hal, cells, count);
+}
+
+static bool ad_halCounterScrollRows(ad_Hal *hal, uint16_t top, uint16_t bottom, int lines) {
+    ad_halCounters(hal)->scrollRows++;
+    return ad_halForwardScrollRows(hal, top, bottom, lines);
+}
+
+static uint32_t ad_halCounterGetKey(ad_Hal *hal) {
+    ad_halCounters(hal)->getKey++;
+    return ad_halForwardGetKey(hal);
+}
+
+ad_Hal *ad_halCounterCreate(ad_Hal *inner) {
+    ad_HalCounter *ret;
+
+    AD_RETURN_ON_NULL(inner, NULL);
+    ret = calloc(1, sizeof(ad_HalCounter));
+    AD_RETURN_ON_NULL(ret, NULL);
+
+    ret->hal                    = ad_halForwardAll;
+    ret->hal.setColor           = ad_halCounterSetColor;
+    ret->hal.setCursorPosition  = ad_halCounterSetCursorPosition;
+    ret->hal.flush              = ad_halCounterFlush;
+    ret->hal.putString          = ad_halCounterPutString;
+    ret->hal.putChar            = ad_halCounterPutChar;
+    ret->hal.putSpan            = ad_halCounterPutSpan;
+    ret->hal.scrollRows         = ad_halCounterScrollRows;
+    ret->hal.getKey             = ad_halCounterGetKey;
+    ret->inner                  = inner;
+
+    return &ret->hal;
+}
+
+void ad_halCounterGet(ad_Hal *counter, ad_HalCounters *counters) {
+    *counters = *ad_halCounters(counter);
+}
+
+void ad_halCounterReset(ad_Hal *counter) {
+    memset(ad_halCounters(counter), 0, sizeof(ad_HalCounters));
+}
+
+/* Tracer */
+
+typedef struct {
+    ad_Hal      hal;
+    ad_Hal     *inner;
+    FILE       *out;
+} ad_HalTracer;
+
+#define ad_halTraceOut(hal) (((ad_HalTracer *) (hal))->out)
+
+static void ad_halTracerRestoreConsole(ad_Hal *hal) {
+    fprintf(ad_halTraceOut(hal), "restoreConsole\n");
+    ad_halForwardRestoreConsole(hal);
+}
+
+static void ad_halTracerSetColor(ad_Hal *hal, uint8_t bg, uint8_t fg) {
+    fprintf(ad_halTraceOut(hal), "setColor %u %u\n", bg, fg);
+    ad_halForwardSetColor(hal, bg, fg);
+}
+
+static void ad_halTracerSetCursorPosition(ad_Hal *hal, uint16_t x, uint16_t y) {
+    fprintf(ad_halTraceOut(hal), "setCursorPosition %u %u\n", x, y);
+    ad_halForwardSetCursorPosition(hal, x, y);
+}
+
+static void ad_halTracerFlush(ad_Hal *hal) {
+    fprintf(ad_halTraceOut(hal), "flush\n");
+    ad_halForwardFlush(hal);
+}
+
+static void ad_halTracerPutString(ad_Hal *hal, const char *str) {
+    fprintf(ad_halTraceOut(hal), "putString '%s'\n", str);
+    ad_halForwardPutString(hal, str);
+}
+
+static void ad_halTracerPutChar(ad_Hal *hal, char c, size_t count) {
+    fprintf(ad_halTraceOut(hal), "putChar '%c' %lu\n", c, (unsigned long) count);
+    ad_halForwardPutChar(hal, c, count);
+}
+
+static void ad_halTracerPutSpan(ad_Hal *hal, const ad_Char *cells, size_t count) {
+    size_t i;
+    fprintf(ad_halTraceOut(hal), "putSpan %lu '", (unsigned long) count);
+    for (i = 0; i < count; i++) {
+        fputc(cells[i].ascii, ad_halTraceOut(hal));
+    }
+    fprintf(ad_halTraceOut(hal), "'\n");
+    ad_halForwardPutSpan(hal, cells, count);
+}
+
+static bool ad_halTracerScrollRows(ad_Hal *hal, uint16_t top, uint16_t bottom, int lines) {
+    bool ret = ad_halForwardScrollRows(hal, top, bottom, lines);
+    fprintf(ad_halTraceOut(hal), "scrollRows %u %u %d -> %s\n", top, bottom, lines, ret ? "ok" : "unsupported");
+    return ret;
+}
+
+static uint32_t ad_halTracerGetKey(ad_Hal *hal) {
+    uint32_t key = ad_halForwardGetKey(hal);
+    fprintf(ad_halTraceOut(hal), "getKey %08lx\n", (unsigned long) key);
+    return key;
+}
+
+static bool ad_halTracerWaitForKey(ad_Hal *hal, uint32_t milliseconds) {
+    bool ret = ad_halForwardWaitForKey(hal, milliseconds);
+    fprintf(ad_halTraceOut(hal), "waitForKey %lu -> %s\n", (unsigned long) milliseconds, ret ? "key" : "timeout");
+    return ret;
+}
+
+ad_Hal *ad_halTracerCreate(ad_Hal *inner, FILE *out) {
+    ad_HalTracer *ret;
+
+    AD_RETURN_ON_NULL(inner, NULL);
+    AD_RETURN_ON_NULL(out, NULL);
+    ret = calloc(1, sizeof(ad_HalTracer));
+    AD_RETURN_ON_NULL(ret, NULL);
+
+    ret->hal                    = ad_halForwardAll;
+    ret->hal.restoreConsole     = ad_halTracerRestoreConsole;
+    ret->hal.setColor           = ad_halTracerSetColor;
+    ret->hal.setCursorPosition  = ad_halTracerSetCursorPosition;
+    ret->hal.flush              = ad_halTracerFlush;
+    ret->hal.putString          = ad_halTracerPutString;
+    ret->hal.putChar            = ad_halTracerPutChar;
+    ret->hal.putSpan            = ad_halTracerPutSpan;
+    ret->hal.scrollRows         = ad_halTracerScrollRows;
+    ret->hal.getKey             = ad_halTracerGetKey;
+    ret->hal.waitForKey         = ad_halTracerWaitForKey;
+    ret->inner                  = inner;
+    ret->out                    = out;
+
+    return &ret->hal;
+}
+
+/* Recorder */
+
+typedef enum {
+    AD_REC_RESTORE_CONSOLE,
+    AD_REC_SET_COLOR,
+    AD_REC_SET_CURSOR_POSITION,
+    AD_REC_FLUSH,
+    AD_REC_PUT_STRING,
+    AD_REC_PUT_CHAR,
+    AD_REC_PUT_SPAN,
+    AD_REC_SCROLL_UP,
+    AD_REC_SCROLL_DOWN
+} ad_HalRecordType;
+
+typedef struct {
+    uint8_t     type;
+    uint16_t    a;
+    uint16_t    b;
+    size_t      count;
+    size_t      dataOffset;     /* Offset in the recorder's data pool (strings and cells) */
+} ad_HalRecord;
+
+typedef struct {
+    ad_Hal          hal;
+    ad_Hal         *inner;      /* May be NULL */
+    uint16_t        width;
+    uint16_t        height;
+    ad_HalRecord   *records;
+    size_t          recordCount;
+    size_t          recordCapacity;
+    uint8_t        *data;
+    size_t          dataLength;
+    size_t          dataCapacity;
+} ad_HalRecorder;
+
+/* Grows <*ptr> geometrically so it can hold <needed> elements of <elementSize> */
+static bool ad_halRecorderGrow(void **ptr, size_t *capacity, size_t needed, size_t elementSize) {
+    size_t  newCapacity = *capacity ? *capacity : 64;
+    void   *newPtr;
+
+    if (needed <= *capacity) {
+        return true;
+    }
+
+    while (newCapacity < needed) {
+        newCapacity *= 2;
+    }
+
+    newPtr = realloc(*ptr, newCapacity * elementSize);
+
+    if (newPtr == NULL) {
+        return false;
+    }
+
+    *ptr = newPtr;
+    *capacity = newCapacity;
+    return true;
+}
+
+static void ad_halRecorderAdd(ad_Hal *hal, uint8_t type, uint16_t a, uint16_t b, size_t count, const void *data, size_t dataLength) {
+    ad_HalRecorder *rec = (ad_HalRecorder *) hal;
+    ad_HalRecord   *record;
+
+    if (!ad_halRecorderGrow((void **) &rec->records, &rec->recordCapacity, rec->recordCount + 1, sizeof(ad_HalRecord))
+     || !ad_halRecorderGrow((void **) &rec->data, &rec->dataCapacity, rec->dataLength + dataLength, 1)) {
+        return;
+    }
+
+    record = &rec->records[rec->recordCount++];
+    record->type = type;
+    record->a = a;
+    record->b = b;
+    record->count = count;
+    record->dataOffset = rec->dataLength;
+
+    if (dataLength > 0) {
+        memcpy(&rec->data[rec->dataLength], data, dataLength);
+        rec->dataLength += dataLength;
+    }
+}
+
+static void ad_halRecorderInitConsole(ad_Hal *hal, ad_ConsoleConfig *cfg) {
+    ad_HalRecorder *rec = (ad_HalRecorder *) hal;
+    if (rec->inner) {
+        ad_halForwardInitConsole(hal, cfg);
+    } else {
+        cfg->width = rec->width;
+        cfg->height = rec->height;
+    }
+}
+
+static void ad_halRecorderRestoreConsole(ad_Hal *hal) {
+    ad_halRecorderAdd(hal, AD_REC_RESTORE_CONSOLE, 0, 0, 0, NULL, 0);
+    if (ad_halInner(hal)) ad_halForwardRestoreConsole(hal);
+}
+
+static void ad_halRecorderDeinitConsole(ad_Hal *hal) {
+    if (ad_halInner(hal)) ad_halForwardDeinitConsole(hal);
+}
+
+static void ad_halRecorderSetColor(ad_Hal *hal, uint8_t bg, uint8_t fg) {
+    ad_halRecorderAdd(hal, AD_REC_SET_COLOR, bg, fg, 0, NULL, 0);
+    if (ad_halInner(hal)) ad_halForwardSetColor(hal, bg, fg);
+}
+
+static void ad_halRecorderSetCursorPosition(ad_Hal *hal, uint16_t x, uint16_t y) {
+    ad_halRecorderAdd(hal, AD_REC_SET_CURSOR_POSITION, x, y, 0, NULL, 0);
+    if (ad_halInner(hal)) ad_halForwardSetCursorPosition(hal, x, y);
+}
+
+static void ad_halRecorderFlush(ad_Hal *hal) {
+    ad_halRecorderAdd(hal, AD_REC_FLUSH, 0, 0, 0, NULL, 0);
+    if (ad_halInner(hal)) ad_halForwardFlush(hal);
+}
+
+static void ad_halRecorderGetOutputStats(ad_Hal *hal, ad_OutputStats *stats) {
+    if (ad_halInner(hal)) {
+        ad_halForwardGetOutputStats(hal, stats);
+    } else {
+        memset(stats, 0, sizeof(ad_OutputStats));
+    }
+}
+
+static void ad_halRecorderPutString(ad_Hal *hal, const char *str) {
+    size_t length = strlen(str) + 1;
+    ad_halRecorderAdd(hal, AD_REC_PUT_STRING, 0, 0, length, str, length);
+    if (ad_halInner(hal)) ad_halForwardPutString(hal, str);
+}
+
+static void ad_halRecorderPutChar(ad_Hal *hal, char c, size_t count) {
+    ad_halRecorderAdd(hal, AD_REC_PUT_CHAR, (uint8_t) c, 0, count, NULL, 0);
+    if (ad_halInner(hal)) ad_halForwardPutChar(hal, c, count);
+}
+
+static void ad_halRecorderPutSpan(ad_Hal *hal, const ad_Char *cells, size_t count) {
+    ad_halRecorderAdd(hal, AD_REC_PUT_SPAN, 0, 0, count, cells, count * sizeof(ad_Char));
+    if (ad_halInner(hal)) ad_halForwardPutSpan(hal, cells, count);
+}
+
+/* Without an inner HAL there is no telling whether the replay target can scroll, so the caller has to repaint */
+static bool ad_halRecorderCanScrollRows(ad_Hal *hal) {
+    return ad_halInner(hal) != NULL && ad_halForwardCanScrollRows(hal);
+}
+
+static bool ad_halRecorderScrollRows(ad_Hal *hal, uint16_t top, uint16_t bottom, int lines) {
+    if (ad_halInner(hal) == NULL || !ad_halForwardScrollRows(hal, top, bottom, lines)) {
+        return false;
+    }
+
+    if (lines > 0) {
+        ad_halRecorderAdd(hal, AD_REC_SCROLL_UP, top, bottom, (size_t) lines, NULL, 0);
+    } else {
+        ad_halRecorderAdd(hal, AD_REC_SCROLL_DOWN, top, bottom, (size_t) -lines, NULL, 0);
+    }
+
+    return true;
+}
+
+static uint32_t ad_halRecorderGetKey(ad_Hal *hal) {
+    return ad_halInner(hal) ? ad_halForwardGetKey(hal) : AD_KEY_ENTER;
+}
+
+static bool ad_halRecorderWaitForKey(ad_Hal *hal, uint32_t milliseconds) {
+    return ad_halInner(hal) ? ad_halForwardWaitForKey(hal, milliseconds) : true;
+}
+
+static void ad_halRecorderDestroy(ad_Hal *hal) {
+    ad_HalRecorder *rec = (ad_HalRecorder *) hal;
+    free(rec->records);
+    free(rec->data);
+    free(rec);
+}
+
+ad_Hal *ad_halRecorderCreate(ad_Hal *inner, uint16_t width, uint16_t height) {
+    ad_HalRecorder *ret = calloc(1, sizeof(ad_HalRecorder));
+    AD_RETURN_ON_NULL(ret, NULL);
+
+    ret->hal.initConsole        = ad_halRecorderInitConsole;
+    ret->hal.restoreConsole     = ad_halRecorderRestoreConsole;
+    ret->hal.deinitConsole      = ad_halRecorderDeinitConsole;
+    ret->hal.setColor           = ad_halRecorderSetColor;
+    ret->hal.setCursorPosition  = ad_halRecorderSetCursorPosition;
+    ret->hal.flush              = ad_halRecorderFlush;
+    ret->hal.getOutputStats     = ad_halRecorderGetOutputStats;
+    ret->hal.putString          = ad_halRecorderPutString;
+    ret->hal.putChar            = ad_halRecorderPutChar;
+    ret->hal.putSpan            = ad_halRecorderPutSpan;
+    ret->hal.scrollRows         = ad_halRecorderScrollRows;
+    ret->hal.canScrollRows      = ad_halRecorderCanScrollRows;
+    ret->hal.getKey             = ad_halRecorderGetKey;
+    ret->hal.waitForKey         = ad_halRecorderWaitForKey;
+    ret->hal.destroy            = ad_halRecorderDestroy;
+    ret->inner                  = inner;
+    ret->width                  = width;
+    ret->height                 = height;
+
+    return &ret->hal;
+}
+
+void ad_halRecorderReplay(ad_Hal *recorder, ad_Hal *target) {
+    ad_HalRecorder *rec = (ad_HalRecorder *) recorder;
+    size_t          i;
+
+    assert(recorder);
+    assert(target);
+
+    for (i = 0; i < rec->recordCount; i++) {
+        const ad_HalRecord *r    = &rec->records[i];
+        const void         *data = &rec->data[r->dataOffset];
+
+        switch (r->type) {
+            case AD_REC_RESTORE_CONSOLE:        target->restoreConsole(target);                                     break;
+            case AD_REC_SET_COLOR:              target->setColor(target, (uint8_t) r->a, (uint8_t) r->b);           break;
+            case AD_REC_SET_CURSOR_POSITION:    target->setCursorPosition(target, r->a, r->b);                      break;
+            case AD_REC_FLUSH:                  target->flush(target);                                              break;
+            case AD_REC_PUT_STRING:             target->putString(target, (const char *) data);                     break;
+            case AD_REC_PUT_CHAR:               target->putChar(target, (char) r->a, r->count);                     break;
+            case AD_REC_PUT_SPAN:               target->putSpan(target, (const ad_Char *) data, r->count);          break;
+            case AD_REC_SCROLL_UP:              target->scrollRows(target, r->a, r->b, (int) r->count);             break;
+            case AD_REC_SCROLL_DOWN:            target->scrollRows(target, r->a, r->b, -(int) r->count);            break;
+            default:                            break;
+        }
+    }
+}
+
+/* Throttle */
+
+typedef struct {
+    ad_Hal      hal;
+    ad_Hal     *inner;
+    uint32_t    bytesPerSecond;
+} ad_HalThrottle;
+
+static void ad_halThrottleWait(double seconds) {
+#if defined(__unix__) || defined(__APPLE__)
+    struct timespec ts;
+
+    ts.tv_sec = (time_t) seconds;
+    ts.tv_nsec = (long) ((seconds - (double) ts.tv_sec) * 1000000000.0);
+    nanosleep(&ts, NULL);
+#else
+    clock_t start = clock();
+    while (clock() < start + (clock_t) (seconds * CLOCKS_PER_SEC));
+#endif
+}
+
+static void ad_halThrottleFlush(ad_Hal *hal) {
+    ad_HalThrottle *throttle = (ad_HalThrottle *) hal;
+    ad_OutputStats  stats;
+    uint32_t        framesBefore;
+
+    ad_halForwardGetOutputStats(hal, &stats);
+    framesBefore = stats.frames;
+
+    ad_halForwardFlush(hal);
+    ad_halForwardGetOutputStats(hal, &stats);
+
+    /* Only wait if this flush actually sent something */
+    if (throttle->bytesPerSecond > 0 && stats.frames != framesBefore) {
+        ad_halThrottleWait((double) stats.lastFrameBytes / (double) throttle->bytesPerSecond);
+    }
+}
+
+ad_Hal *ad_halThrottleCreate(ad_Hal *inner, uint32_t bytesPerSecond) {
+    ad_HalThrottle *ret;
+
+    AD_RETURN_ON_NULL(inner, NULL);
+    ret = calloc(1, sizeof(ad_HalThrottle));
+    AD_RETURN_ON_NULL(ret, NULL);
+
+    ret->hal                    = ad_halForwardAll;
+    ret->hal.flush              = ad_halThrottleFlush;
+    ret->inner                  = inner;
+    ret->bytesPerSecond         = bytesPerSecond;
+
+    return &ret->hal;
+}
+
+/* Mirror */
+
+typedef struct {
+    ad_Hal      hal;
+    ad_Hal     *inner;
+    ad_Hal     *mirror;
+} ad_HalMirror;
+
+#define ad_halMirror(hal) (((ad_HalMirror *) (hal))->mirror)
+
+static void ad_halMirrorInitConsole(ad_Hal *hal, ad_ConsoleConfig *cfg) {
+    ad_ConsoleConfig mirrorCfg;
+
+    ad_halForwardInitConsole(hal, cfg);
+    /* The mirror gets its own copy, the size that counts is the one of the inner HAL */
+    mirrorCfg = *cfg;
+    ad_halMirror(hal)->initConsole(ad_halMirror(hal), &mirrorCfg);
+}
+
+static void ad_halMirrorRestoreConsole(ad_Hal *hal) {
+    ad_halForwardRestoreConsole(hal);
+    ad_halMirror(hal)->restoreConsole(ad_halMirror(hal));
+}
+
+static void ad_halMirrorDeinitConsole(ad_Hal *hal) {
+    ad_halForwardDeinitConsole(hal);
+    ad_halMirror(hal)->deinitConsole(ad_halMirror(hal));
+}
+
+static void ad_halMirrorSetColor(ad_Hal *hal, uint8_t bg, uint8_t fg) {
+    ad_halForwardSetColor(hal, bg, fg);
+    ad_halMirror(hal)->setColor(ad_halMirror(hal), bg, fg);
+}
+
+static void ad_halMirrorSetCursorPosition(ad_Hal *hal, uint16_t x, uint16_t y) {
+    ad_halForwardSetCursorPosition(hal, x, y);
+    ad_halMirror(hal)->setCursorPosition(ad_halMirror(hal), x, y);
+}
+
+static void ad_halMirrorFlush(ad_Hal *hal) {
+    ad_halForwardFlush(hal);
+    ad_halMirror(hal)->flush(ad_halMirror(hal));
+}
+
+static void ad_halMirrorPutString(ad_Hal *hal, const char *str) {
+    ad_halForwardPutString(hal, str);
+    ad_halMirror(hal)->putString(ad_halMirror(hal), str);
+}
+
+static void ad_halMirrorPutChar(ad_Hal *hal, char c, size_t count) {
+    ad_halForwardPutChar(hal, c, count);
+    ad_halMirror(hal)->putChar(ad_halMirror(hal), c, count);
+}
+
+static void ad_halMirrorPutSpan(ad_Hal *hal, const ad_Char *cells, size_t count) {
+    ad_halForwardPutSpan(hal, cells, count);
+    ad_halMirror(hal)->putSpan(ad_halMirror(hal), cells, count);
+}
+
+static bool ad_halMirrorCanScrollRows(ad_Hal *hal) {
+    return ad_halForwardCanScrollRows(hal) && ad_halMirror(hal)->canScrollRows(ad_halMirror(hal));
+}
+
+/* Only scrolls if both can, which is asked first: one of them scrolled and the other not can't be fixed by redrawing the rows,
+   as only the rows the caller thinks have changed get redrawn. The mirror is left alone if the inner HAL refuses after all. */
+static bool ad_halMirrorScrollRows(ad_Hal *hal, uint16_t top, uint16_t bottom, int lines) {
+    return ad_halMirrorCanScrollRows(hal)
+        && ad_halForwardScrollRows(hal, top, bottom, lines)
+        && ad_halMirror(hal)->scrollRows(ad_halMirror(hal), top, bottom, lines);
+}
+
+ad_Hal *ad_halMirrorCreate(ad_Hal *inner, ad_Hal *mirror) {
+    ad_HalMirror *ret;
+
+    AD_RETURN_ON_NULL(inner, NULL);
+    AD_RETURN_ON_NULL(mirror, NULL);
+    ret = calloc(1, sizeof(ad_HalMirror));
+    AD_RETURN_ON_NULL(ret, NULL);
+
+    ret->hal                    = ad_halForwardAll;
+    ret->hal.initConsole        = ad_halMirrorInitConsole;
+    ret->hal.restoreConsole     = ad_halMirrorRestoreConsole;
+    ret->hal.deinitConsole      = ad_halMirrorDeinitConsole;
+    ret->hal.setColor           = ad_halMirrorSetColor;
+    ret->hal.setCursorPosition  = ad_halMirrorSetCursorPosition;
+    ret->hal.flush              = ad_halMirrorFlush;
+    ret->hal.putString          = ad_halMirrorPutString;
+    ret->hal.putChar            = ad_halMirrorPutChar;
+    ret->hal.putSpan            = ad_halMirrorPutSpan;
+    ret->hal.scrollRows         = ad_halMirrorScrollRows;
+    ret->hal.canScrollRows      = ad_halMirrorCanScrollRows;
+    ret->inner                  = inner;
+    ret->mirror                 = mirror;
+
+    return &ret->hal;
+}
@@ -9,7 +9,16 @@
 
     E.g. for important error popups, etc.
 
-    These functions then get forwarded to the 
+    Drawing only ever touches the back buffer. ad_present
+    then compares it against the front buffer (= what is
+    actually on the screen) and forwards only the cells that
+    changed to the HAL.
+
+    Drawing also marks the columns it touched in each row as dirty,
+    so ad_present only has to look at those. Every front buffer row
+    has a hash, which lets ad_present find rows that are on screen
+    already, just a few rows further up or down (e.g. a scrolling
+    text box). Those get moved by the HAL instead of redrawn.
 
     (C) 2026 E. Voirin (oerg866) */
 
@@ -22,111 +31,656 @@
 #include <assert.h>
 #include <stdio.h>
 
-typedef struct {
-    uint8_t fg : 4; 
-    uint8_t bg : 4;
-} ad_Color;
-
-typedef struct {
-    ad_Color color;
-    uint8_t ascii;
-} ad_Char;
-
-typedef struct {
+typedef struct ad_ScreenState {
     ad_Color color;
+    uint8_t attr;           /* AD_ATTR_* flags for everything that gets drawn */
     uint16_t width;
     uint16_t height;
     uint16_t x;
     uint16_t y;
     size_t totalChars;
     size_t bufSize;
-    ad_Char *data;
+    ad_Char *data;          /* Back buffer, this is what gets drawn to */
     ad_Char *dataLimit;
-    ad_Char *data_backup;
-    uint16_t x_backup;
-    uint16_t y_backup;
-    ad_Color color_backup;
+    ad_Char *front;         /* Front buffer, this is what is currently on the screen. 0x00 = unknown */
+    ad_ScreenSnapshot *savedStates; /* Stack of ad_screenSaveState(Region) snapshots, newest first */
+    uint16_t *dirtyFrom;    /* Per row: Only columns dirtyFrom..dirtyTo-1 of the back buffer can differ from the front buffer */
+    uint16_t *dirtyTo;
+    uint32_t *frontHashes;  /* Per row: ad_cellsHash of the front buffer row, if frontHashValid says so */
+    bool *frontHashValid;
+    uint32_t *backHashes;   /* Per row, only used while presenting */
 } ad_ScreenState;
 
-static ad_ScreenState state;
+struct ad_ScreenSnapshot {
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+    uint16_t cursorX;
+    uint16_t cursorY;
+    ad_Color color;
+    uint8_t attr;
+    ad_ScreenSnapshot *next;
+    ad_Char *cells;         /* width * height cells, allocated together with the snapshot */
+};
+
+/* The screen state of the current context */
+#define state (*ad_s_ctx->screen)
+
+/* Gaps of unchanged cells up to this size are simply re-sent instead of moving the cursor past them */
+#define AD_PRESENT_MAX_GAP 4
+
+/* Moving rows only pays off if it saves redrawing at least this many rows worth of cells */
+#define AD_PRESENT_MIN_MOVED_ROWS 3
+
+static void ad_screenMarkRowsDirty(uint16_t from, uint16_t to) {
+    for (; from < to; from++) {
+        state.dirtyFrom[from] = 0;
+        state.dirtyTo[from] = state.width;
+    }
+}
+
+static void ad_screenMarkRowsClean(void) {
+    uint16_t y;
+
+    for (y = 0; y < state.height; y++) {
+        state.dirtyFrom[y] = state.width;
+        state.dirtyTo[y] = 0;
+    }
+}
+
+/* Marks <count> cells of the back buffer starting at <offset> as dirty, may go over several rows */
+static void ad_screenMarkDirty(size_t offset, size_t count) {
+    while (count > 0) {
+        uint16_t y = (uint16_t) (offset / state.width);
+        uint16_t x = (uint16_t) (offset % state.width);
+        uint16_t n = (uint16_t) AD_MIN(count, (size_t) (state.width - x));
+
+        state.dirtyFrom[y] = AD_MIN(state.dirtyFrom[y], x);
+        state.dirtyTo[y] = AD_MAX(state.dirtyTo[y], x + n);
+        offset += n;
+        count -= n;
+    }
+}
 
 bool ad_initConsole(ad_ConsoleConfig *cfg) {
+    if (ad_s_ctx->screen == NULL) {
+        ad_s_ctx->screen = malloc(sizeof(ad_ScreenState));
+        AD_RETURN_ON_NULL(ad_s_ctx->screen, false);
+    }
+
     hal_initConsole(cfg);
 
     memset(&state, 0, sizeof(ad_ScreenState));
 
     state.width = cfg->width;
     state.height = cfg->height;
-    state.bufSize = state.width * state.height * sizeof(ad_Char);
+    state.totalChars = (size_t) state.width * state.height;
+    state.bufSize = state.totalChars * sizeof(ad_Char);
 
     state.data = calloc(1, state.bufSize);
-    state.data_backup = calloc(1, state.bufSize);
-    state.dataLimit = &state.data[state.width * state.height];
+    state.front = calloc(1, state.bufSize);
+    state.dataLimit = &state.data[state.totalChars];
+    state.dirtyFrom = malloc(state.height * sizeof(uint16_t));
+    state.dirtyTo = malloc(state.height * sizeof(uint16_t));
+    state.frontHashes = malloc(state.height * sizeof(uint32_t));
+    state.frontHashValid = calloc(state.height, sizeof(bool));
+    state.backHashes = malloc(state.height * sizeof(uint32_t));
+
+    if (state.bufSize == 0 || state.data == NULL || state.front == NULL || state.dirtyFrom == NULL
+     || state.dirtyTo == NULL || state.frontHashes == NULL || state.frontHashValid == NULL
+     || state.backHashes == NULL) {
+        return false;
+    }
 
-    return (state.bufSize != 0 && state.data != NULL && state.data_backup == NULL);
+    /* Both buffers are empty */
+    ad_screenMarkRowsClean();
+    return true;
 }
 
 void ad_deinitConsole(void) {
+    ad_asyncRelease();
     hal_deinitConsole();
+
+    if (ad_s_ctx->screen == NULL) {
+        return;
+    }
+
+    while (state.savedStates != NULL) {
+        ad_ScreenSnapshot *next = state.savedStates->next;
+        ad_screenSnapshotDestroy(state.savedStates);
+        state.savedStates = next;
+    }
+
     free(state.data);
-    free(state.data_backup);
+    free(state.front);
+    free(state.dirtyFrom);
+    free(state.dirtyTo);
+    free(state.frontHashes);
+    free(state.frontHashValid);
+    free(state.backHashes);
+    free(ad_s_ctx->screen);
+    ad_s_ctx->screen = NULL;
+}
+
+void ad_screenInvalidate(void) {
+    memset(state.front, 0, state.bufSize);
+    ad_screenMarkRowsDirty(0, state.height);
+    memset(state.frontHashValid, 0, state.height * sizeof(bool));
+}
+
+static inline bool ad_charEquals(const ad_Char *a, const ad_Char *b) {
+    return memcmp(a, b, sizeof(ad_Char)) == 0;
+}
+
+/* State of a frame commit in progress */
+typedef struct {
+    ad_Hal     *hal;
+    const ad_Char *back;            /* Frame to be shown */
+    ad_Char    *front;              /* What is on the screen, gets updated along the way */
+    bool        cursorValid;        /* Is the HAL cursor position known? */
+    uint16_t    cursorX;
+    uint16_t    cursorY;
+    bool        colorValid;         /* Is the HAL color known? */
+    ad_Color    color;              /* Color the HAL is at after the pending span */
+    uint8_t     attr;
+    size_t      spanLength;         /* Pending cells to be sent in one go */
+    ad_Char     span[AD_BUF_SIZE];
+} ad_Presenter;
+
+/* Sends the pending span of cells to the HAL in one go */
+static void ad_presenterFlushSpan(ad_Presenter *p) {
+    if (p->spanLength > 0) {
+        p->hal->putSpan(p->hal, p->span, p->spanLength);
+        p->spanLength = 0;
+    }
+}
+
+static void ad_presenterPut(ad_Presenter *p, const ad_Char *cell) {
+    p->span[p->spanLength++] = *cell;
+    p->color = cell->color;
+    p->attr = cell->attr;
+    p->colorValid = true;
+
+    if (p->spanLength == AD_ARRAY_SIZE(p->span)) {
+        ad_presenterFlushSpan(p);
+    }
+
+    /* Don't rely on the HAL wrapping at the end of a row */
+    p->cursorX++;
+    p->cursorValid = p->cursorX < state.width;
+}
+
+/* Checks if the unchanged cells between the cursor and x can be re-sent without a color change */
+static bool ad_presenterCanBridge(ad_Presenter *p, uint16_t x, uint16_t y) {
+    const ad_Char *cell = &p->front[(size_t) y * state.width + p->cursorX];
+    uint16_t       i;
+
+    if (!p->cursorValid || !p->colorValid || y != p->cursorY || x < p->cursorX || x - p->cursorX > AD_PRESENT_MAX_GAP) {
+        return false;
+    }
+
+    for (i = p->cursorX; i < x; i++, cell++) {
+        if (cell->ascii == 0x00 || cell->color.bg != p->color.bg || cell->color.fg != p->color.fg || cell->attr != p->attr) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void ad_presenterMoveTo(ad_Presenter *p, uint16_t x, uint16_t y) {
+    if (p->cursorValid && x == p->cursorX && y == p->cursorY) {
+        return;
+    }
+
+    /* Small gap with the current color: rewriting it is cheaper than a cursor move */
+    if (ad_presenterCanBridge(p, x, y)) {
+        const ad_Char *cell = &p->front[(size_t) y * state.width + p->cursorX];
+        while (p->cursorX < x) {
+            ad_presenterPut(p, cell++);
+        }
+        return;
+    }
+
+    ad_presenterFlushSpan(p);
+    p->hal->setCursorPosition(p->hal, x, y);
+    p->cursorX = x;
+    p->cursorY = y;
+    p->cursorValid = true;
+}
+
+/* Sends the changed cells in columns from..to-1 of a row as spans */
+static void ad_presentRowSpan(ad_Presenter *p, uint16_t y, uint16_t from, uint16_t to) {
+    size_t          offset  = (size_t) y * state.width + from;
+    const ad_Char  *back    = &p->back[offset];
+    ad_Char        *front   = &p->front[offset];
+    uint16_t        x;
+
+    for (x = from; x < to; x++, back++, front++) {
+        /* Skip cells that are already on screen or were never drawn to */
+        if (back->ascii == 0x00 || ad_charEquals(back, front)) {
+            continue;
+        }
+
+        ad_presenterMoveTo(p, x, y);
+        ad_presenterPut(p, back);
+        *front = *back;
+    }
+}
+
+/* Narrows columns from..to-1 of a row down to the part where back and front differ. Returns false if they don't. */
+static bool ad_presentNarrowRow(const ad_Char *back, const ad_Char *front, uint16_t *from, uint16_t *to) {
+    uint16_t first = (uint16_t) (*from + ad_cellsFirstDiff(&back[*from], &front[*from], *to - *from));
+
+    if (first >= *to) {
+        return false;
+    }
+
+    *to = (uint16_t) (first + ad_cellsLastDiff(&back[first], &front[first], *to - first));
+    *from = first;
+    return true;
+}
+
+static void ad_presenterInit(ad_Presenter *p, ad_Hal *hal, const ad_Char *backBuffer, ad_Char *frontBuffer) {
+    p->hal = hal;
+    p->back = backBuffer;
+    p->front = frontBuffer;
+    p->cursorValid = false;
+    p->colorValid = false;
+    p->spanLength = 0;
+}
+
+void ad_presentBuffer(ad_Hal *hal, const ad_Char *backBuffer, ad_Char *frontBuffer) {
+    ad_Presenter    p;
+    uint16_t        y;
+
+    ad_presenterInit(&p, hal, backBuffer, frontBuffer);
+
+    for (y = 0; y < state.height; y++) {
+        size_t      offset  = (size_t) y * state.width;
+        uint16_t    from    = 0;
+        uint16_t    to      = state.width;
+
+        if (ad_presentNarrowRow(&backBuffer[offset], &frontBuffer[offset], &from, &to)) {
+            ad_presentRowSpan(&p, y, from, to);
+        }
+    }
+
+    ad_presenterFlushSpan(&p);
+
+    hal->flush(hal);
+}
+
+#define ad_rowChanged(y)    (state.dirtyFrom[(y)] < state.dirtyTo[(y)])
+#define ad_rowChangedCells(y) (ad_rowChanged(y) ? state.dirtyTo[(y)] - state.dirtyFrom[(y)] : 0)
+#define ad_rowHash(buf, y)  ad_cellsHash(&(buf)[(size_t) (y) * state.width], state.width)
+
+static bool ad_rowsEqual(const ad_Char *back, uint16_t backRow, const ad_Char *front, uint16_t frontRow, uint16_t count) {
+    return memcmp(&back[(size_t) backRow * state.width], &front[(size_t) frontRow * state.width], (size_t) count * state.width * sizeof(ad_Char)) == 0;
+}
+
+/*  Looks for the run of rows in the back buffer that saves the most redrawing by moving it from where
+    it is in the front buffer. Returns how many cells it saves, the run is back rows <*row>..<*row>+<*length>-1
+    which are front rows <*row>+<*shift>.. <changedCells> is the total of all rows. */
+static long ad_presentFindMove(size_t changedCells, uint16_t *row, uint16_t *length, int *shift) {
+    long        bestGain = 0;
+    long        maxDistance;
+    uint16_t    end      = state.height;
+    uint16_t    y;
+    uint16_t    source;
+
+    /* Unchanged rows don't gain anything by moving, so runs start at changed rows and don't go past the last one */
+    while (end > 0 && !ad_rowChanged(end - 1)) {
+        end--;
+    }
+
+    /* Moving further than this costs more vacated rows than there are changed cells to save */
+    maxDistance = (long) (2 * changedCells / state.width);
+
+    for (y = 0; y < end; y++) {
+        uint32_t hash = state.backHashes[y];
+        uint16_t last;
+
+        if (!ad_rowChanged(y)) {
+            continue;
+        }
+
+        source = (uint16_t) AD_MAX(0, (long) y - maxDistance);
+        last = (uint16_t) AD_MIN((long) state.height - 1, (long) y + maxDistance);
+
+        for (; source <= last; source++) {
+            uint16_t    runLength;
+            uint16_t    i;
+            long        gain = 0;
+            long        distance;
+
+            /* Skip runs that were already looked at from an earlier row */
+            if (state.frontHashes[source] != hash || source == y
+             || (y > 0 && source > 0 && ad_rowChanged(y - 1) && state.backHashes[y - 1] == state.frontHashes[source - 1])) {
+                continue;
+            }
+
+            for (runLength = 0; y + runLength < end && source + runLength < state.height
+                 && state.backHashes[y + runLength] == state.frontHashes[source + runLength]; runLength++) {
+                gain += ad_rowChangedCells(y + runLength);
+            }
+
+            /* Not even if all cells of the vacated rows had changed anyway */
+            distance = (source > y) ? source - y : y - source;
+
+            if (gain + (long) changedCells - distance * state.width <= bestGain) {
+                continue;
+            }
+
+            /* The rows that the content moves away from have to be redrawn completely */
+            for (i = AD_MIN(y, source); i < AD_MAX(y, source) + runLength; i++) {
+                if (i < y || i >= y + runLength) {
+                    gain -= state.width - ad_rowChangedCells(i);
+                }
+            }
+
+            if (gain > bestGain) {
+                bestGain = gain;
+                maxDistance = (long) (2 * changedCells - bestGain) / state.width;
+                *row = y;
+                *length = runLength;
+                *shift = (int) source - (int) y;
+            }
+        }
+    }
+
+    return bestGain;
+}
+
+/*  Moves rows that are on screen already to where the back buffer has them, using the HAL.
+    Returns true if the back buffer hashes are up to date afterwards. */
+static bool ad_presentMoveRows(ad_Presenter *p, size_t changedCells) {
+    uint16_t    y;
+    uint16_t    row     = 0;
+    uint16_t    length  = 0;
+    int         shift   = 0;
+    uint16_t    top;
+    uint16_t    bottom;
+    uint16_t    vacated;
+
+    for (y = 0; y < state.height; y++) {
+        if (!state.frontHashValid[y]) {
+            state.frontHashes[y] = ad_rowHash(state.front, y);
+            state.frontHashValid[y] = true;
+        }
+
+        state.backHashes[y] = ad_rowChanged(y) ? ad_rowHash(state.data, y) : state.frontHashes[y];
+    }
+
+    /* Hashes can collide, so make sure */
+    if (ad_presentFindMove(changedCells, &row, &length, &shift) < (long) AD_PRESENT_MIN_MOVED_ROWS * state.width
+     || !ad_rowsEqual(state.data, row, state.front, (uint16_t) (row + shift), length)) {
+        return true;
+    }
+
+    top     = (uint16_t) AD_MIN(row, row + shift);
+    bottom  = (uint16_t) (AD_MAX(row, row + shift) + length);
+    vacated = (uint16_t) (bottom - top - length);
+
+    ad_presenterFlushSpan(p);
+
+    if (!p->hal->scrollRows(p->hal, top, bottom, shift)) {
+        return true;
+    }
+
+    p->cursorValid = false;
+
+    /* Same thing for the front buffer, the vacated rows are unknown now */
+    if (shift > 0) {
+        memmove(&state.front[(size_t) top * state.width], &state.front[(size_t) (top + vacated) * state.width], (size_t) length * state.width * sizeof(ad_Char));
+        memmove(&state.frontHashes[top], &state.frontHashes[top + vacated], length * sizeof(uint32_t));
+        memset(&state.front[(size_t) (top + length) * state.width], 0, (size_t) vacated * state.width * sizeof(ad_Char));
+    } else {
+        memmove(&state.front[(size_t) (top + vacated) * state.width], &state.front[(size_t) top * state.width], (size_t) length * state.width * sizeof(ad_Char));
+        memmove(&state.frontHashes[top + vacated], &state.frontHashes[top], length * sizeof(uint32_t));
+        memset(&state.front[(size_t) top * state.width], 0, (size_t) vacated * state.width * sizeof(ad_Char));
+    }
+
+    /* Everything in the region needs to be compared again */
+    for (y = top; y < bottom; y++) {
+        size_t offset = (size_t) y * state.width;
+
+        state.dirtyFrom[y] = 0;
+        state.dirtyTo[y] = state.width;
+        state.frontHashValid[y] = (y >= row && y < row + length);
+
+        if (!ad_presentNarrowRow(&state.data[offset], &state.front[offset], &state.dirtyFrom[y], &state.dirtyTo[y])) {
+            state.dirtyFrom[y] = state.width;
+            state.dirtyTo[y] = 0;
+        }
+    }
+
+    /* Moved rows have their front hashes, the rest must be hashed again later */
+    return false;
+}
+
+/* Presents the back buffer of the current context, only looking at dirty rows */
+static void ad_presentDirty(ad_Hal *hal) {
+    ad_Presenter    p;
+    uint16_t        y;
+    size_t          changedCells = 0;
+    bool            backHashed   = false;
+
+    ad_presenterInit(&p, hal, state.data, state.front);
+
+    for (y = 0; y < state.height; y++) {
+        size_t offset = (size_t) y * state.width;
+
+        if (ad_rowChanged(y) && ad_presentNarrowRow(&state.data[offset], &state.front[offset], &state.dirtyFrom[y], &state.dirtyTo[y])) {
+            changedCells += ad_rowChangedCells(y);
+        } else {
+            state.dirtyFrom[y] = state.width;
+            state.dirtyTo[y] = 0;
+        }
+    }
+
+    /* Not worth looking for moved rows if a move can't save enough anyway */
+    if (changedCells >= (size_t) AD_PRESENT_MIN_MOVED_ROWS * state.width) {
+        backHashed = ad_presentMoveRows(&p, changedCells);
+    }
+
+    for (y = 0; y < state.height; y++) {
+        if (ad_rowChanged(y)) {
+            ad_presentRowSpan(&p, y, state.dirtyFrom[y], state.dirtyTo[y]);
+
+            /* The row is the same as in the back buffer now, unless it has cells that were never drawn */
+            state.frontHashes[y] = state.backHashes[y];
+            state.frontHashValid[y] = backHashed;
+        }
+    }
+
+    ad_screenMarkRowsClean();
+    ad_presenterFlushSpan(&p);
+
+    hal->flush(hal);
+}
+
+void ad_present(void) {
+    /* The render thread takes care of it if there is one */
+    if (ad_asyncSubmitFrame(state.data)) {
+        ad_screenMarkRowsClean();
+        return;
+    }
+
+    ad_presentDirty(ad_s_hal);
+}
+
+ad_Char *ad_screenGetFront(void) {
+    ad_screenMarkRowsDirty(0, state.height);
+    memset(state.frontHashValid, 0, state.height * sizeof(bool));
+    return state.front;
+}
+
+size_t ad_screenGetCellCount(void) {
+    return (ad_s_ctx->screen != NULL) ? state.totalChars : 0;
+}
+
+ad_ScreenSnapshot *ad_screenSnapshotCreate(uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    ad_ScreenSnapshot  *snap;
+    uint16_t            row;
+
+    /* Clip to the screen */
+    x       = AD_MIN(x, state.width);
+    y       = AD_MIN(y, state.height);
+    width   = AD_MIN(width, state.width - x);
+    height  = AD_MIN(height, state.height - y);
+
+    snap = malloc(sizeof(ad_ScreenSnapshot) + (size_t) width * height * sizeof(ad_Char));
+    AD_RETURN_ON_NULL(snap, NULL);
+
+    snap->x         = x;
+    snap->y         = y;
+    snap->width     = width;
+    snap->height    = height;
+    snap->cursorX   = state.x;
+    snap->cursorY   = state.y;
+    snap->color     = state.color;
+    snap->attr      = state.attr;
+    snap->next      = NULL;
+    snap->cells     = (ad_Char *) (snap + 1);
+
+    for (row = 0; row < height; row++) {
+        memcpy(&snap->cells[(size_t) row * width], &state.data[(size_t) (y + row) * state.width + x], width * sizeof(ad_Char));
+    }
+
+    return snap;
+}
+
+void ad_screenSnapshotRestore(const ad_ScreenSnapshot *snap) {
+    uint16_t row;
+
+    if (snap == NULL) {
+        return;
+    }
+
+    for (row = 0; row < snap->height; row++) {
+        size_t offset = (size_t) (snap->y + row) * state.width + snap->x;
+        memcpy(&state.data[offset], &snap->cells[(size_t) row * snap->width], snap->width * sizeof(ad_Char));
+        ad_screenMarkDirty(offset, snap->width);
+    }
+
+    state.x = snap->cursorX;
+    state.y = snap->cursorY;
+    state.color = snap->color;
+    state.attr = snap->attr;
+}
+
+void ad_screenSnapshotDestroy(ad_ScreenSnapshot *snap) {
+    free(snap);
+}
+
+void ad_screenSaveRegion(uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    ad_ScreenSnapshot *snap = ad_screenSnapshotCreate(x, y, width, height);
+
+    if (snap != NULL) {
+        snap->next = state.savedStates;
+        state.savedStates = snap;
+    }
 }
 
 void ad_screenSaveState(void) {
-    memcpy(state.data_backup, state.data, state.bufSize);
-    state.x_backup = state.x;
-    state.y_backup = state.y;
-    state.color_backup = state.color;
+    ad_screenSaveRegion(0, 0, state.width, state.height);
 }
 
 void ad_screenLoadState(void) {
-    size_t totalChars = state.width * state.height;
-    size_t i;
+    ad_ScreenSnapshot *snap = state.savedStates;
 
-    memcpy(state.data, state.data_backup, state.bufSize);
-    hal_setCursorPosition(0, 0);
-
-    for (i = 0; i < totalChars; i++) {
-        hal_setColor(state.data[i].color.bg, state.data[i].color.fg);
-        hal_putChar(state.data[i].ascii, 1);
+    if (snap == NULL) {
+        return;
     }
 
-    ad_setColor(state.color_backup.bg, state.color_backup.fg);
-    ad_setCursorPosition(state.x_backup, state.y_backup);
+    state.savedStates = snap->next;
+
+    /* Only the cells that differ from what is on screen now get sent */
+    ad_screenSnapshotRestore(snap);
+    ad_screenSnapshotDestroy(snap);
+    ad_present();
 }
 
 #define ad_drawPtr() (&state.data[state.y * state.width + state.x])
-#define ad_cr()             do { state.x = 0; }                                         while (0)
-#define ad_lf()             do { ad_cr(); state.y++; }                                  while (0)
-#define ad_advanceCursor()  do { state.x++; if (state.x > state.width) { ad_lf(); }; }   while (0)
+
+/* Moves the draw position forward by count cells, wrapping to the next row(s) */
+static inline void ad_advanceCursor(size_t count) {
+    count += state.x;
+    state.y = (uint16_t) (state.y + count / state.width);
+    state.x = (uint16_t) (count % state.width);
+}
+
+/* Number of cells that can be drawn from the draw position before running off the screen */
+static inline size_t ad_cellsLeft(void) {
+    ad_Char *drawPtr = ad_drawPtr();
+    return (drawPtr < state.dataLimit) ? (size_t) (state.dataLimit - drawPtr) : 0;
+}
 
 void ad_setColor(uint8_t bg, uint8_t fg) {
-    hal_setColor(bg, fg);
-    state.color.bg = bg;
-    state.color.fg = fg;
+    state.color.bg = bg & 0x0F;
+    state.color.fg = fg & 0x0F;
+}
+
+void ad_setAttributes(uint8_t attr) {
+    state.attr = attr;
 }
 
 void ad_setCursorPosition(uint16_t x, uint16_t y) {
-    hal_setCursorPosition(x, y);
     state.x = x;
     state.y = y;
 }
 
 void ad_putChar(char c, size_t count) {
+    ad_Char  cell;
+
+    assert((uint8_t) c >= (uint8_t) ' ');
+
+    count = AD_MIN(count, ad_cellsLeft());
+    cell.ascii = (uint8_t) c;
+    cell.color = state.color;
+    cell.attr = state.attr;
+
+    ad_cellsFill(ad_drawPtr(), cell, count);
+    ad_screenMarkDirty((size_t) (ad_drawPtr() - state.data), count);
+
+    ad_advanceCursor(count);
+}
+
+void ad_putStringWithLength(const char *str, size_t length) {
     ad_Char *drawPtr = ad_drawPtr();
-    hal_putChar(c, count);
-    while (count-- && drawPtr < state.dataLimit) {
-        assert((uint8_t) c >= (uint8_t) ' ');
-        drawPtr->color = state.color;
-        drawPtr->ascii = c;
-        drawPtr++;
-        ad_advanceCursor();
+    size_t   i;
+
+    length = AD_MIN(length, ad_cellsLeft());
+
+    for (i = 0; i < length; i++) {
+        drawPtr[i].ascii = (uint8_t) str[i];
+        drawPtr[i].color = state.color;
+        drawPtr[i].attr = state.attr;
     }
+
+    ad_screenMarkDirty((size_t) (drawPtr - state.data), length);
+    ad_advanceCursor(length);
 }
 
-void ad_putString(const char *str) {
-    while(*str) {
-        ad_putChar(*str, 1);
-        str++;
+void ad_putTextWithLength(const char *str, size_t length) {
+    ad_Char *drawPtr = ad_drawPtr();
+    size_t   i;
+
+    length = AD_MIN(length, ad_cellsLeft());
+
+    for (i = 0; i < length; i++) {
+        uint8_t ascii = (uint8_t) str[i];
+        drawPtr[i].ascii = (ascii < 0x20 || ascii == 0x7F) ? ' ' : ascii;
+        drawPtr[i].color = state.color;
+        drawPtr[i].attr = state.attr;
     }
+
+    ad_screenMarkDirty((size_t) (drawPtr - state.data), length);
+    ad_advanceCursor(length);
+}
+
+void ad_putString(const char *str) {
+    ad_putStringWithLength(str, strlen(str));
 }
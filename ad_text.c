@@ -19,12 +19,6 @@
 #include "ad_priv.h"
 #include "ad_hal.h"
 
-static inline void ad_textElementAssignWithLength(ad_TextElement *el, const char *text, size_t length) {
-    length = AD_MIN(AD_TEXT_ELEMENT_SIZE-1, length);
-    memcpy(el->text, text, length);
-    el->text[length] = 0x00;
-}
-
 void ad_textElementAssign(ad_TextElement *el, const char *text) {
     size_t length = AD_MIN(AD_TEXT_ELEMENT_SIZE-1, strlen(text));
     memcpy(el->text, text, length);
@@ -59,63 +53,80 @@ size_t ad_textElementArrayGetLongestLength(size_t items, ad_TextElement *element
     return max;
 }
 
-ad_TextElement* ad_textElementArrayFromString(const char *str, size_t *lineCountOut) {
-    const char *upperBound;
-    ad_TextElement *ret = NULL;
-    const char *curPos = str;
+/* Adds a line to the index, the offset array grows by doubling */
+static bool ad_multiLineTextAddLine(ad_MultiLineText *obj, size_t offset) {
+    if (obj->lineCount == obj->lineCapacity) {
+        size_t  newCapacity = AD_MAX(obj->lineCapacity * 2, 16);
+        size_t *newOffsets  = realloc(obj->lineOffsets, newCapacity * sizeof(size_t));
 
-    AD_RETURN_ON_NULL(str, NULL);
-    ret = calloc(1, sizeof(ad_TextElement));
-    AD_RETURN_ON_NULL(ret, NULL);
+        AD_RETURN_ON_NULL(newOffsets, false);
+
+        obj->lineOffsets = newOffsets;
+        obj->lineCapacity = newCapacity;
+    }
+
+    obj->lineOffsets[obj->lineCount++] = offset;
+    return true;
+}
+
+ad_MultiLineText *ad_multiLineTextCreateFromBuffer(char *buffer, size_t size) {
+    ad_MultiLineText *ret = NULL;
+    size_t pos = 0;
+
+    if (buffer == NULL || (ret = calloc(1, sizeof(ad_MultiLineText))) == NULL) {
+        free(buffer);
+        return NULL;
+    }
+
+    ret->text = buffer;
 
-    upperBound = str + strlen(str);
-    *lineCountOut = 0;
+    while (pos < size) {
+        /* Line is from current position until newline */
+        char   *lineEnd = memchr(&buffer[pos], '\n', size - pos);
+        size_t  length  = (lineEnd != NULL) ? (size_t) (lineEnd - &buffer[pos]) : size - pos;
 
-    while (curPos < upperBound) {
-        /* String is from current position until newline */
-        const char *curEnd = strchr(curPos, '\n');
-        const size_t curLen = (curEnd != NULL) ? (size_t) (curEnd - curPos) : strlen(curPos);
-        
-        *lineCountOut += 1;
-        
-        ret = ad_textElementArrayResize(ret, *lineCountOut);
+        if (!ad_multiLineTextAddLine(ret, pos)) {
+            ad_multiLineTextDestroy(ret);
+            return NULL;
+        }
 
-        AD_RETURN_ON_NULL(ret, NULL);
+        /* Next line starts after \n */
+        pos += length + 1;
 
-        ad_textElementAssignWithLength(&ret[(*lineCountOut)-1], curPos, curLen);
+        if (lineEnd != NULL) {
+            *lineEnd = 0x00;
+        }
 
         /* Deal with annoying \r\n stuff */
-        if (curLen > 0 && curPos[curLen-1] == '\r') {
-            ret[(*lineCountOut)-1].text[curLen-1] = 0x00;
+        if (length > 0 && buffer[pos - 2] == '\r') {
+            buffer[pos - 2] = 0x00;
+            length--;
         }
 
-        /* Next string starts after \n */
-        curPos += curLen + 1;
-        
+        ret->longestLine = AD_MAX(ret->longestLine, length);
     }
 
     return ret;
 }
 
 ad_MultiLineText *ad_multiLineTextCreate(const char *str) {
-    ad_MultiLineText *ret = NULL;
-    AD_RETURN_ON_NULL(str, NULL);
-    ret = calloc(1,sizeof(ad_MultiLineText));
-    AD_RETURN_ON_NULL(ret, NULL);
+    size_t  size;
+    char   *buffer;
 
-    ret->lines = ad_textElementArrayFromString(str, &ret->lineCount);
+    AD_RETURN_ON_NULL(str, NULL);
 
-    if (ret->lines == NULL) {
-        ad_multiLineTextDestroy(ret);
-        return NULL;
-    }
+    size = strlen(str);
+    buffer = malloc(size + 1);
+    AD_RETURN_ON_NULL(buffer, NULL);
+    memcpy(buffer, str, size + 1);
 
-    return ret;
+    return ad_multiLineTextCreateFromBuffer(buffer, size);
 }
 
 void ad_multiLineTextDestroy(ad_MultiLineText *obj) {
     if (obj) {
-        free(obj->lines);
+        free(obj->lineOffsets);
+        free(obj->text);
         free(obj);
     }
 }
@@ -128,10 +139,7 @@ void ad_displayStringCropped(const char *str, uint16_t x, uint16_t y, size_t max
     ad_setCursorPosition(x, y);
 
     if (strLen > maxLen) {
-        maxLen -= 3;
-        while (maxLen--) {
-            ad_putChar(*str++, 1);
-        }
+        ad_putStringWithLength(str, maxLen - 3);
         ad_putString("...");
     } else {
         ad_putString(str);
@@ -139,13 +147,35 @@ void ad_displayStringCropped(const char *str, uint16_t x, uint16_t y, size_t max
     }
 }
 
+void ad_displayTextCropped(const char *str, size_t length, uint16_t x, uint16_t y, size_t maxLen, uint8_t bg, uint8_t fg) {
+    ad_setColor(bg, fg);
+    ad_setCursorPosition(x, y);
+
+    if (length > maxLen) {
+        ad_putTextWithLength(str, maxLen - 3);
+        ad_putString("...");
+    } else {
+        ad_putTextWithLength(str, length);
+        ad_putChar(' ', maxLen - length);
+    }
+}
+
 void ad_displayTextElementArray(uint16_t x, uint16_t y, size_t maximumWidth, size_t count, ad_TextElement *elements) {
     size_t i;
     for (i = 0; i < count; i++) {
         ad_displayStringCropped(elements[i].text, x, y, maximumWidth, ad_s_con.objectBg, ad_s_con.objectFg);
         y++;
     }
-    hal_flush();
+    ad_present();
+}
+
+void ad_displayMultiLineText(uint16_t x, uint16_t y, size_t maximumWidth, const ad_MultiLineText *text, size_t first, size_t count) {
+    size_t i;
+    for (i = first; i < first + count && i < text->lineCount; i++) {
+        ad_displayStringCropped(ad_multiLineTextGetLine(text, i), x, y, maximumWidth, ad_s_con.objectBg, ad_s_con.objectFg);
+        y++;
+    }
+    ad_present();
 }
 
 void ad_printCenteredText(const char* str, uint16_t x, uint16_t y, uint16_t w, uint8_t colBg, uint8_t colFg) {
@@ -167,20 +197,19 @@ void ad_printCenteredText(const char* str, uint16_t x, uint16_t y, uint16_t w, u
         ad_displayStringCropped(str, x, y, w, colBg, colFg);
     }
 
-    hal_flush();
+    ad_present();
 }
 
 
 void ad_drawBackground(const char *title) {
     size_t y;
 
-    ad_printCenteredText(title, 0, 0, ad_s_con.width, ad_s_con.headerBg, ad_s_con.headerFg);
-
     for (y = 1; y < ad_s_con.height; y++) {
         ad_fill(ad_s_con.width, ' ', 0, y, ad_s_con.backgroundFill, 0);
     }
 
-    hal_flush();
+    /* Title last, this presents the whole background in one go */
+    ad_printCenteredText(title, 0, 0, ad_s_con.width, ad_s_con.headerBg, ad_s_con.headerFg);
 }
 
 void ad_fill(size_t length, char fill, uint16_t x, uint16_t y, uint8_t colBg, uint8_t colFg) {
@@ -0,0 +1,55 @@
+/*
+    AnbUI Miniature Text UI Lib for Burger Enjoyers(tm)
+
+    ad_thrd: Threads, mutexes and condition variables for the platforms
+    that have them (AD_HAL_HAS_THREADS), on top of Win32 or pthreads.
+
+    Tip of the day: More cooks only help if each has their own grill.
+
+    (C) 2026 E. Voirin (oerg866) */
+
+#ifndef _AD_THRD_H_
+#define _AD_THRD_H_
+
+#if defined(AD_HAL_HAS_THREADS)
+
+#if defined(_WIN32)
+#include <windows.h>
+typedef HANDLE              ad_Thread;
+typedef CRITICAL_SECTION    ad_Mutex;
+typedef CONDITION_VARIABLE  ad_Cond;
+/* Thread functions are declared with AD_THREAD_FUNC and end with AD_THREAD_RETURN */
+#define AD_THREAD_FUNC(name, arg)   static DWORD WINAPI name(LPVOID arg)
+#define AD_THREAD_RETURN            return 0
+#define ad_threadStart(t, fn, arg)  ((*(t) = CreateThread(NULL, 0, (fn), (arg), 0, NULL)) != NULL)
+#define ad_threadJoin(t)            ((void) WaitForSingleObject((t), INFINITE), (void) CloseHandle(t))
+#define ad_mutexInit(m)     InitializeCriticalSection(m)
+#define ad_mutexDestroy(m)  DeleteCriticalSection(m)
+#define ad_mutexLock(m)     EnterCriticalSection(m)
+#define ad_mutexUnlock(m)   LeaveCriticalSection(m)
+#define ad_condInit(c)      InitializeConditionVariable(c)
+#define ad_condDestroy(c)   ((void) (c))
+#define ad_condWait(c, m)   SleepConditionVariableCS((c), (m), INFINITE)
+#define ad_condSignal(c)    WakeConditionVariable(c)
+#else
+#include <pthread.h>
+typedef pthread_t           ad_Thread;
+typedef pthread_mutex_t     ad_Mutex;
+typedef pthread_cond_t      ad_Cond;
+#define AD_THREAD_FUNC(name, arg)   static void *name(void *arg)
+#define AD_THREAD_RETURN            return NULL
+#define ad_threadStart(t, fn, arg)  (pthread_create((t), NULL, (fn), (arg)) == 0)
+#define ad_threadJoin(t)            ((void) pthread_join((t), NULL))
+#define ad_mutexInit(m)     pthread_mutex_init((m), NULL)
+#define ad_mutexDestroy(m)  pthread_mutex_destroy(m)
+#define ad_mutexLock(m)     pthread_mutex_lock(m)
+#define ad_mutexUnlock(m)   pthread_mutex_unlock(m)
+#define ad_condInit(c)      pthread_cond_init((c), NULL)
+#define ad_condDestroy(c)   pthread_cond_destroy(c)
+#define ad_condWait(c, m)   pthread_cond_wait((c), (m))
+#define ad_condSignal(c)    pthread_cond_signal(c)
+#endif
+
+#endif
+
+#endif
@@ -23,13 +23,22 @@
 #include "ad_hal.h"
 
 static void ad_textFileBoxDestroy(ad_TextFileBox *tfb);
+static void ad_progressBoxTakePublished(ad_ProgressBox *pb);
+
+#if !defined(AD_HAS_ATOMICS)
+uint32_t ad_atomicExchangeU32(ad_AtomicU32 *ptr, uint32_t val) {
+    uint32_t ret = *ptr;
+    *ptr = val;
+    return ret;
+}
+#endif
 
 static void ad_menuSelectItemAndDraw(ad_Menu *menu, size_t newSelection) {
     assert(menu);
     ad_displayStringCropped(menu->items[menu->currentSelection].text,   menu->itemX, menu->itemY + menu->currentSelection, menu->itemWidth, ad_s_con.objectBg, ad_s_con.objectFg);
     ad_displayStringCropped(menu->items[newSelection].text,             menu->itemX, menu->itemY + newSelection,           menu->itemWidth, ad_s_con.objectFg, ad_s_con.objectBg);
     menu->currentSelection = newSelection;
-    hal_flush();
+    ad_present();
 }
 
 static bool ad_menuPaint(ad_Menu *menu) {
@@ -47,7 +56,7 @@ static bool ad_menuPaint(ad_Menu *menu) {
     
     /* Factor in the prompt length into window width calculation */
     if (menu->prompt) {
-        maximumPromptWidth = ad_textElementArrayGetLongestLength(menu->prompt->lineCount, menu->prompt->lines);
+        maximumPromptWidth = menu->prompt->longestLine;
         windowContentWidth = AD_MAX(windowContentWidth, maximumPromptWidth);
     }
 
@@ -63,7 +72,7 @@ static bool ad_menuPaint(ad_Menu *menu) {
 
     /* Print prompt if it exists */
     if (menu->prompt) {   
-        ad_displayTextElementArray(menu->itemX, menu->itemY, ad_objectGetContentWidth(&menu->object), menu->prompt->lineCount, menu->prompt->lines);
+        ad_displayMultiLineText(menu->itemX, menu->itemY, ad_objectGetContentWidth(&menu->object), menu->prompt, 0, menu->prompt->lineCount);
         menu->itemY += 1 + menu->prompt->lineCount;
     }
 
@@ -234,7 +243,7 @@ bool ad_progressBoxPaint (ad_ProgressBox *pb) {
 
     /* Get the length of the longest Prompt line */
     promptHeight = (pb->prompt != NULL) ? pb->prompt->lineCount : 0;
-    promptWidth = (pb->prompt != NULL) ? ad_textElementArrayGetLongestLength(pb->prompt->lineCount, pb->prompt->lines) : 0;
+    promptWidth = (pb->prompt != NULL) ? pb->prompt->longestLine : 0;
 
     labelWidth = ad_progressBoxGetLongestLabelLength(pb);
 
@@ -258,7 +267,7 @@ bool ad_progressBoxPaint (ad_ProgressBox *pb) {
     }
 
     if (pb->prompt) {   
-        ad_displayTextElementArray(pb->labelX, pb->boxY, ad_objectGetContentWidth(&pb->object), pb->prompt->lineCount, pb->prompt->lines);
+        ad_displayMultiLineText(pb->labelX, pb->boxY, ad_objectGetContentWidth(&pb->object), pb->prompt, 0, pb->prompt->lineCount);
         pb->boxY += 1 + pb->prompt->lineCount;
     }
 
@@ -274,7 +283,7 @@ bool ad_progressBoxPaint (ad_ProgressBox *pb) {
         }
     }
 
-    hal_flush();
+    ad_present();
 
     return true;
 }
@@ -318,6 +327,13 @@ ad_ProgressBox *ad_progressBoxMultiCreate(const char *title, const char *promptF
 
 void ad_progressBoxDestroy(ad_ProgressBox *pb) {
     if (pb) {
+        /* Whatever got held back by the refresh rate or is still unsampled gets shown */
+        if (ad_atomicExchange(&pb->published, 0) != 0) {
+            ad_progressBoxTakePublished(pb);
+        }
+        if (pb->dirty) {
+            ad_progressBoxRefresh(pb);
+        }
         ad_objectUnpaint(&pb->object);
         ad_multiLineTextDestroy(pb->prompt);
         free(pb->items);
@@ -325,35 +341,142 @@ void ad_progressBoxDestroy(ad_ProgressBox *pb) {
     }
 }
 
-void ad_progressBoxMultiUpdate(ad_ProgressBox *pb, size_t index, uint32_t progress) {
-    uint16_t newX;
-    uint16_t newPaintLength;
-    ad_Progress *prog;
+/*  Brings the bar at <index> in line with its latest progress value. Needs an ad_present.
+    Returns false if the bar didn't change. */
+static bool ad_progressBoxDrawItem(ad_ProgressBox *pb, size_t index) {
+    ad_Progress *prog = &pb->items[index];
+    uint16_t     newX;
+
+    if (prog->outOf == 0) {
+        return false;
+    }
+
+    /*  round / lround for values > 1 in MUSL gets clipped to 1.0 ?????? am I stupid?
+        Anyway this hack is here until I get some sleep.. */
+    newX = AD_ROUND_HACK_WTF(uint16_t, ((double) pb->boxWidth * (double) AD_MIN(prog->progress, prog->outOf)) / ((double) prog->outOf));
+
+    if (newX > prog->currentX) {
+        ad_fill(newX - prog->currentX, ad_s_con.progressChar, pb->boxX + prog->currentX, pb->boxY + index, ad_s_con.progressFillBg, ad_s_con.progressFillFg);
+    } else if (newX < prog->currentX) {
+        ad_fill(prog->currentX - newX, ad_s_con.progressChar, pb->boxX + newX, pb->boxY + index, ad_s_con.progressBlankBg, ad_s_con.progressBlankFg);
+    } else {
+        return false;
+    }
+
+    prog->currentX = newX;
+    return true;
+}
+
+void ad_progressBoxRefresh(ad_ProgressBox *pb) {
+    size_t index;
 
     if (pb == NULL) {
         return;
     }
 
-    prog = &pb->items[index];
+    for (index = 0; index < pb->itemCount; index++) {
+        ad_progressBoxDrawItem(pb, index);
+    }
 
-    /*  round / lround for values > 1 in MUSL gets clipped to 1.0 ?????? am I stupid?
-        Anyway this hack is here until I get some sleep.. */
-    newX = AD_ROUND_HACK_WTF(uint16_t, ((double) pb->boxWidth * (double) progress) / ((double) prog->outOf));
+    ad_present();
 
-    if (newX == prog->currentX) {
+    pb->dirty = false;
+    pb->lastRefresh = ad_getMilliseconds();
+}
+
+void ad_progressBoxSetRefreshRate(ad_ProgressBox *pb, uint32_t refreshesPerSecond) {
+    if (pb == NULL) {
         return;
     }
 
-    newPaintLength = newX - prog->currentX;
+    pb->refreshInterval = (refreshesPerSecond > 0) ? AD_MAX(1000 / refreshesPerSecond, 1) : 0;
+}
 
-    ad_setCursorPosition(pb->boxX + prog->currentX, pb->boxY + index);
-    ad_setColor(ad_s_con.progressFillBg, ad_s_con.progressFillFg);
+static void ad_progressBoxRefreshIfDue(ad_ProgressBox *pb) {
+    if (pb->dirty && (uint32_t) (ad_getMilliseconds() - pb->lastRefresh) >= pb->refreshInterval) {
+        ad_progressBoxRefresh(pb);
+    }
+}
+
+void ad_progressBoxMultiUpdate(ad_ProgressBox *pb, size_t index, uint32_t progress) {
+    if (pb == NULL || index >= pb->itemCount) {
+        return;
+    }
 
-    ad_putChar(ad_s_con.progressChar, newPaintLength);
+    pb->items[index].progress = progress;
+    /* Keep the published value in line so that a later sample doesn't go back.
+       Deltas published to this bar in the meantime are lost, the two must not be mixed. */
+    ad_atomicStore(&pb->items[index].publishedProgress, progress);
 
-    hal_flush();
-    
-    prog->currentX = newX;
+    if (pb->refreshInterval == 0) {
+        if (ad_progressBoxDrawItem(pb, index)) {
+            ad_present();
+        }
+        return;
+    }
+
+    /* Rate limited: just remember the value, the screen catches up once the interval has passed */
+    pb->dirty = true;
+    ad_progressBoxRefreshIfDue(pb);
+}
+
+/* Any thread: mark that there is something new to pick up. Releases the values stored before. */
+static inline void ad_progressBoxMarkPublished(ad_ProgressBox *pb) {
+    ad_atomicExchange(&pb->published, 1);
+}
+
+void ad_progressBoxPublish(ad_ProgressBox *pb, size_t index, uint32_t progress) {
+    if (pb == NULL || index >= pb->itemCount) {
+        return;
+    }
+
+    ad_atomicStore(&pb->items[index].publishedProgress, progress);
+    ad_progressBoxMarkPublished(pb);
+}
+
+void ad_progressBoxPublishAdd(ad_ProgressBox *pb, size_t index, uint32_t delta) {
+    if (pb == NULL || index >= pb->itemCount) {
+        return;
+    }
+
+    ad_atomicAdd(&pb->items[index].publishedProgress, delta);
+    ad_progressBoxMarkPublished(pb);
+}
+
+void ad_progressBoxPublishMaxProgress(ad_ProgressBox *pb, size_t index, uint32_t maxProgress) {
+    if (pb == NULL || index >= pb->itemCount) {
+        return;
+    }
+
+    ad_atomicStore(&pb->items[index].publishedOutOf, maxProgress);
+    ad_progressBoxMarkPublished(pb);
+}
+
+/* Copies the published values of all bars into the progress box */
+static void ad_progressBoxTakePublished(ad_ProgressBox *pb) {
+    size_t index;
+
+    for (index = 0; index < pb->itemCount; index++) {
+        pb->items[index].progress = ad_atomicLoad(&pb->items[index].publishedProgress);
+        pb->items[index].outOf    = ad_atomicLoad(&pb->items[index].publishedOutOf);
+    }
+
+    pb->dirty = true;
+}
+
+bool ad_progressBoxSample(ad_ProgressBox *pb) {
+    bool published;
+
+    AD_RETURN_ON_NULL(pb, false);
+
+    published = ad_atomicExchange(&pb->published, 0) != 0;
+
+    if (published) {
+        ad_progressBoxTakePublished(pb);
+    }
+
+    ad_progressBoxRefreshIfDue(pb);
+    return published;
 }
 
 void ad_progressBoxUpdate(ad_ProgressBox *pb, uint32_t progress) {
@@ -383,33 +506,213 @@ void ad_progressBoxAddItem(ad_ProgressBox *obj, const char *label, uint32_t maxP
     assert(obj->items);
 
     obj->items[obj->itemCount-1].outOf = maxProgress;
+    ad_atomicStore(&obj->items[obj->itemCount-1].publishedOutOf, maxProgress);
     ad_textElementAssign(&obj->items[obj->itemCount-1].label, label);
 }
 
 void ad_progressBoxSetMaxProgress(ad_ProgressBox *obj, size_t index, uint32_t maxProgress) {
     if (obj == NULL || index >= obj->itemCount) return;
     obj->items[index].outOf = maxProgress;
+    ad_atomicStore(&obj->items[index].publishedOutOf, maxProgress);
+    obj->dirty = true;
 }
 
-static inline void ad_textFileBoxRedrawLines(ad_TextFileBox *tfb) {
-    ad_displayTextElementArray(tfb->textX, tfb->textY, (size_t) tfb->lineWidth, (size_t) tfb->linesOnScreen, &tfb->lines->lines[tfb->currentIndex]);
+static void ad_textFileBoxUpdateFooter(ad_TextFileBox *tfb) {
+    bool            complete;
+    size_t          lineCount;
+    ad_TextElement  position;
+    ad_TextElement  hits;
+    char            prompt = tfb->searchBackward ? '?' : '/';
+
+    ad_textViewUpdate(tfb->view);
+    lineCount = ad_textViewGetLineCount(tfb->view, &complete);
+
+    /* After a jump, the number of the top line is there as soon as the indexing has come that far */
+    if (!tfb->indexKnown) {
+        tfb->indexKnown = ad_textViewLookupLine(tfb->view, tfb->top, &tfb->currentIndex);
+    }
+
+    if (!tfb->indexKnown) {
+        ad_FileOffset size;
+
+        ad_textViewGetData(tfb->view, &size);
+        ad_textElementAssignFormatted(&position, AD_FOOTER_TEXTFILEBOX_OFFSET,
+            (unsigned long) ((double) tfb->top * 100.0 / (double) size), (unsigned long) ad_textViewGetIndexedPercent(tfb->view));
+    } else if (complete) {
+        ad_textElementAssignFormatted(&position, AD_FOOTER_TEXTFILEBOX_LINE,
+            (unsigned long) tfb->currentIndex + 1, (unsigned long) lineCount);
+    } else {
+        ad_textElementAssignFormatted(&position, AD_FOOTER_TEXTFILEBOX_INDEXING,
+            (unsigned long) tfb->currentIndex + 1, (unsigned long) lineCount, (unsigned long) ad_textViewGetIndexedPercent(tfb->view));
+    }
+
+    /* The first hit is usually there long before all of them are counted */
+    if (tfb->searchLength > 0 && tfb->find == NULL && !tfb->hasHit) {
+        ad_textElementAssign(&hits, AD_FOOTER_TEXTFILEBOX_NO_HITS);
+    } else {
+        ad_textElementAssignFormatted(&hits, ad_textSearchIsDone(tfb->count) ? AD_FOOTER_TEXTFILEBOX_HITS : AD_FOOTER_TEXTFILEBOX_COUNTING,
+            (unsigned long) ad_textSearchGetCount(tfb->count));
+    }
+
+    if (tfb->gotoEditing) {
+        ad_textElementAssignFormatted(&tfb->object.footer, AD_FOOTER_TEXTFILEBOX_GOTO, tfb->gotoText.text);
+    } else if (tfb->searchEditing) {
+        ad_textElementAssignFormatted(&tfb->object.footer, AD_FOOTER_TEXTFILEBOX_SEARCH, prompt, tfb->searchText.text, tfb->searchLength > 0 ? hits.text : "", tfb->searchLength > 0 ? ", " : "");
+    } else if (tfb->searchLength > 0) {
+        ad_textElementAssignFormatted(&tfb->object.footer, AD_FOOTER_TEXTFILEBOX_FOUND, prompt, tfb->searchText.text, hits.text, position.text);
+    } else {
+        ad_textElementAssignFormatted(&tfb->object.footer, AD_FOOTER_TEXTFILEBOX, position.text);
+    }
+
+    ad_setFooterText(tfb->object.footer.text);
+}
+
+/* Shows the hits of the search text in the <shown> characters of a line from <first> on that were just drawn,
+   with the colors swapped like a menu selection. Hits cut off by the edges of the box are highlighted as far as they are shown.
+   Hits don't overlap, so they are looked for from the start of the line, the same ones get highlighted as are counted and gone to.
+   <scan> is where to look from, 0 for the first row of a line. Afterwards it is where the next row of a wrapped line goes on. */
+static void ad_textFileBoxHighlightHits(ad_TextFileBox *tfb, const char *line, size_t length, size_t first, size_t shown, uint16_t y, size_t *scan) {
+    /* No need to look any further than what is shown, lines can be very long */
+    size_t  pos     = *scan;
+    size_t  limit   = AD_MIN(length, first + shown + tfb->searchLength - 1);
+    size_t  found;
+
+    while (pos < first + shown && (found = ad_bytesFind(&line[pos], limit - pos, tfb->searchText.text, tfb->searchLength)) < limit - pos) {
+        size_t start;
+
+        pos += found;
+        start = AD_MAX(pos, first);
+
+        /* Hits that end before the shown part, on an earlier row of a wrapped line or scrolled off to the left, are skipped */
+        if (start < first + shown && pos + tfb->searchLength > first) {
+            ad_setColor(ad_s_con.objectFg, ad_s_con.objectBg);
+            ad_setCursorPosition(tfb->textX + (uint16_t) (start - first), y);
+            ad_putTextWithLength(&line[start], AD_MIN(pos + tfb->searchLength, first + shown) - start);
+        }
+
+        /* The rest of a hit that goes on in the next row gets highlighted there */
+        if (pos + tfb->searchLength > first + shown) {
+            *scan = pos;
+            return;
+        }
+
+        pos += tfb->searchLength;
+    }
+
+    /* No other hit starts before the end of what is shown */
+    *scan = AD_MAX(pos, first + shown);
+}
+
+/* Rows the line at <start> takes up, 0 if there is no such line. Without wrapping, that's one for every line. */
+static size_t ad_textFileBoxRowsOf(ad_TextFileBox *tfb, ad_FileOffset start) {
+    size_t length;
+
+    if (ad_textViewGetLineAt(tfb->view, start, &length) == NULL) {
+        return 0;
+    }
+
+    return (tfb->wrap && length > 0) ? (length + tfb->lineWidth - 1) / tfb->lineWidth : 1;
+}
+
+/* Rows from the top of the box down to the start of the line at <end> (or the end of the file), counting stops at <limit>.
+   Only the lines passed on the way are looked at, so with wrapping, nothing is ever worked out for the whole file. */
+static size_t ad_textFileBoxRowsTo(ad_TextFileBox *tfb, ad_FileOffset end, size_t limit) {
+    ad_FileOffset   pos     = tfb->top;
+    bool            more    = true;
+    size_t          rows    = 0;
+    size_t          lineRows;
+
+    while (more && pos < end && rows < limit && (lineRows = ad_textFileBoxRowsOf(tfb, pos)) > 0) {
+        rows += lineRows - (pos == tfb->top ? tfb->currentRow : 0);
+        more = ad_textViewNextLine(tfb->view, &pos);
+    }
+
+    return rows;
+}
+
+static void ad_textFileBoxRedrawLines(ad_TextFileBox *tfb) {
+    size_t          i;
+    ad_FileOffset   pos     = tfb->top;
+    bool            more    = true;
+    size_t          row     = tfb->currentRow;
+    size_t          scan    = 0;
+    size_t          length;
+    size_t          first;
+    size_t          shown;
+    const char     *line;
+    uint16_t        y;
+
+    /* Lines get indexed as far as they are shown, so the line count keeps up with scrolling where nothing indexes in the background */
+    if (tfb->indexKnown) {
+        ad_textViewIndexTo(tfb->view, tfb->currentIndex + (size_t) tfb->linesOnScreen);
+    }
+
+    ad_textFileBoxUpdateFooter(tfb);
+
+    for (i = 0; i < (size_t) tfb->linesOnScreen; i++) {
+        line = more ? ad_textViewGetLineAt(tfb->view, pos, &length) : NULL;
+        y = tfb->textY + (uint16_t) i;
+
+        /* Past the end of the file there's nothing but empty lines */
+        if (line == NULL) {
+            length = 0;
+        }
+
+        /* Drawn straight from the file, just from further in for a scrolled or wrapped line */
+        if (tfb->wrap) {
+            first = AD_MIN(row * tfb->lineWidth, length);
+            shown = AD_MIN(length - first, (size_t) tfb->lineWidth);
+            ad_displayTextCropped(line != NULL ? &line[first] : NULL, shown, tfb->textX, y, (size_t) tfb->lineWidth, ad_s_con.objectBg, ad_s_con.objectFg);
+
+            if (first + shown < length) {
+                row++;
+            } else {
+                more = ad_textViewNextLine(tfb->view, &pos);
+                row = 0;
+            }
+        } else {
+            /* Cropped lines end with "..." */
+            first = AD_MIN(tfb->column, length);
+            shown = length - first > tfb->lineWidth ? (size_t) tfb->lineWidth - 3 : length - first;
+            ad_displayTextCropped(line != NULL ? &line[first] : NULL, length - first, tfb->textX, y, (size_t) tfb->lineWidth, ad_s_con.objectBg, ad_s_con.objectFg);
+            more = ad_textViewNextLine(tfb->view, &pos);
+        }
+
+        /* The hits of a wrapped line are looked for once, not again from its start for every row */
+        if (line != NULL && tfb->searchLength > 0) {
+            ad_textFileBoxHighlightHits(tfb, line, length, first, shown, y, &scan);
+        }
+
+        if (!tfb->wrap || row == 0) {
+            scan = 0;
+        }
+    }
+
+    ad_present();
 }
 
 static bool ad_textFileBoxPaint(ad_TextFileBox *tfb) {
-    size_t lineWidth = 0;
+    size_t  lineWidth   = ad_objectGetMaximumContentWidth();
+    size_t  lineCount   = ad_objectGetMaximumContentHeight();
+    bool    complete;
 
     AD_RETURN_ON_NULL(tfb, false);
 
-    /* Get the length of the longest Text line */
-    lineWidth = ad_textElementArrayGetLongestLength(tfb->lines->lineCount, tfb->lines->lines);
+    /* Only a file that fits on the screen is indexed completely at this point, the box can fit that one snugly.
+       A followed file will grow, so that one gets all the room there is. */
+    ad_textViewIndexTo(tfb->view, lineCount);
+
+    if (ad_textViewGetLineCount(tfb->view, &complete) <= lineCount && complete && !tfb->following) {
+        lineWidth = ad_textViewGetLongestLine(tfb->view);
+        lineCount = ad_textViewGetLineCount(tfb->view, NULL);
+    }
 
-    ad_objectInitialize(&tfb->object, lineWidth, tfb->lines->lineCount);
+    ad_objectInitialize(&tfb->object, lineWidth, lineCount);
 
     tfb->textX = ad_objectGetContentX(&tfb->object);
     tfb->textY = ad_objectGetContentY(&tfb->object);
     tfb->lineWidth = ad_objectGetContentWidth(&tfb->object);
     tfb->linesOnScreen = ad_objectGetContentHeight(&tfb->object);
-    tfb->highestIndex = tfb->lines->lineCount - tfb->linesOnScreen;
 
     ad_objectPaint(&tfb->object);
 
@@ -418,97 +721,431 @@ static bool ad_textFileBoxPaint(ad_TextFileBox *tfb) {
     return true;    
 }
 
-static ad_TextFileBox *ad_textFileBoxCreate(const char *title, const char *fileName) {
+static ad_TextFileBox *ad_textFileBoxCreate(const char *title, const char *fileName, bool follow) {
     ad_TextFileBox *tfb         = NULL;
-    FILE           *inFile      = NULL;
-    long            fileSize    = 0;
-    char           *fileBuffer  = NULL;
-    size_t          bytesRead   = 0;
-    
+
     AD_RETURN_ON_NULL(title, NULL);
     AD_RETURN_ON_NULL(fileName, NULL);
 
-    inFile = fopen(fileName, "rb");
+    tfb = calloc(1, sizeof(ad_TextFileBox));
+    AD_RETURN_ON_NULL(tfb, NULL);
 
-    AD_RETURN_ON_NULL(inFile, NULL);
+    ad_textElementAssign(&tfb->object.title, title);
 
-    /* Get File Size */
+    /* Lines are shown straight from the file. Big ones get indexed in the background, otherwise only as far as the box is scrolled. */
+    tfb->following = follow;
+    tfb->indexKnown = true;
+    tfb->view = ad_textViewOpen(fileName, follow);
 
-    fseek(inFile, 0, SEEK_END);
-    fileSize = ftell(inFile);
-    fseek(inFile, 0, SEEK_SET);
+    if (tfb->view == NULL) {
+        ad_textFileBoxDestroy(tfb);
+        return NULL;
+    }
 
-    if (ferror(inFile) != 0 || fileSize <= 0) {
-        goto error;
+    if (ad_s_ctx->indexCache.text[0] != 0x00) {
+        ad_textViewLoadIndex(tfb->view, ad_s_ctx->indexCache.text);
     }
 
-    /* Read whole file into buffer */
+    ad_textViewIndexInBackground(tfb->view);
 
-    fileBuffer = malloc((size_t) fileSize + 1);
-    fileBuffer[fileSize] = 0x00;
+    ad_textFileBoxPaint(tfb);
 
-    while (bytesRead < (size_t) fileSize) {
-        bytesRead += fread(&fileBuffer[bytesRead], 1, (size_t) fileSize - bytesRead, inFile);
-        if (ferror(inFile)) {
-            goto error;
+    return tfb;
+}
+
+/* Moves the top of the box up by <rows> rows, as far as the file goes. The lines before are found by scanning back to their starts. */
+static void ad_textFileBoxRowsUp(ad_TextFileBox *tfb, size_t rows) {
+    for (; rows > 0; rows--) {
+        if (tfb->currentRow > 0) {
+            tfb->currentRow--;
+        } else if (ad_textViewPreviousLine(tfb->view, &tfb->top)) {
+            tfb->currentIndex -= tfb->indexKnown ? 1 : 0;
+            tfb->currentRow = ad_textFileBoxRowsOf(tfb, tfb->top) - 1;
+        } else {
+            break;
         }
     }
+}
 
-    fclose(inFile);
-    inFile = NULL;
-
-    /* OK now we can actually do something with this */
+/* Moves the top of the box down by <rows> rows, but not so far that the box isn't full anymore */
+static void ad_textFileBoxRowsDown(ad_TextFileBox *tfb, size_t rows) {
+    ad_FileOffset   next;
+    size_t          left;
+
+    for (; rows > 0; rows--) {
+        next = tfb->top;
+
+        if (tfb->currentRow + 1 < ad_textFileBoxRowsOf(tfb, tfb->top)) {
+            tfb->currentRow++;
+        } else if (ad_textViewNextLine(tfb->view, &next)) {
+            tfb->top = next;
+            tfb->currentIndex += tfb->indexKnown ? 1 : 0;
+            tfb->currentRow = 0;
+        } else {
+            break;
+        }
+    }
 
-    tfb = calloc(1, sizeof(ad_TextFileBox));
+    left = ad_textFileBoxRowsTo(tfb, AD_TEXTFILEBOX_END, (size_t) tfb->linesOnScreen);
 
-    if (tfb == NULL) {
-        goto error;
+    if (left < (size_t) tfb->linesOnScreen) {
+        ad_textFileBoxRowsUp(tfb, (size_t) tfb->linesOnScreen - left);
     }
-    
-    ad_textElementAssign(&tfb->object.title, title);
-    ad_textElementAssign(&tfb->object.footer, AD_FOOTER_TEXTFILEBOX);
-    
-    tfb->lines = ad_multiLineTextCreate(fileBuffer);
+}
+
+/* Shows the line that <offset> is in at the top (with wrapping, the row it is in), or the box as close to the end of the file
+   as it stays full. Its number is only looked up, it is found out later if the index and checkpoints don't reach that far yet. */
+static void ad_textFileBoxScrollTo(ad_TextFileBox *tfb, ad_FileOffset offset) {
+    ad_FileOffset size;
+
+    ad_textViewGetData(tfb->view, &size);
 
-    if (tfb->lines == NULL) {
-        goto error;
+    tfb->top = ad_textViewLineStartAt(tfb->view, offset);
+    tfb->currentRow = 0;
+    tfb->indexKnown = ad_textViewLookupLine(tfb->view, tfb->top, &tfb->currentIndex);
+
+    /* The end of a line that takes up more rows than the box has is brought up from below, not just its start */
+    if (tfb->wrap && ad_textFileBoxRowsOf(tfb, tfb->top) > 0) {
+        tfb->currentRow = (size_t) ((AD_MIN(offset, size) - tfb->top) / tfb->lineWidth);
+        tfb->currentRow = AD_MIN(tfb->currentRow, ad_textFileBoxRowsOf(tfb, tfb->top) - 1);
     }
 
-    ad_textFileBoxPaint(tfb);
+    ad_textFileBoxRowsDown(tfb, 0);
+    ad_textFileBoxRedrawLines(tfb);
+}
 
-    free(fileBuffer);
+/* Unlike any other jump, going to a line number needs all lines before it counted (through the checkpoints) */
+static void ad_textFileBoxScrollToLine(ad_TextFileBox *tfb, size_t index) {
+    size_t lineCount;
 
-    return tfb;
+    if (!ad_textViewIndexTo(tfb->view, index)) {
+        lineCount = ad_textViewGetLineCount(tfb->view, NULL);
+        index = lineCount > 0 ? lineCount - 1 : 0;
+    }
 
-error:
-    fclose(inFile);
-    free(fileBuffer);
-    ad_textFileBoxDestroy(tfb);
-    return NULL;
+    tfb->top = ad_textViewGetLineStart(tfb->view, index);
+    tfb->currentIndex = index;
+    tfb->indexKnown = true;
+    tfb->currentRow = 0;
 
+    ad_textFileBoxRowsDown(tfb, 0);
+    ad_textFileBoxRedrawLines(tfb);
 }
 
 static void ad_textFileBoxMove(ad_TextFileBox *tpb, int32_t positionsToMoveV) {
-    tpb->currentIndex += positionsToMoveV;
-
-    /* Clip in both directions */
-    tpb->currentIndex = AD_MAX(tpb->currentIndex, 0);
-    tpb->currentIndex = AD_MIN(tpb->currentIndex, tpb->highestIndex);
+    if (positionsToMoveV < 0) {
+        ad_textFileBoxRowsUp(tpb, (size_t) -positionsToMoveV);
+    } else {
+        ad_textFileBoxRowsDown(tpb, (size_t) positionsToMoveV);
+    }
 
     ad_textFileBoxRedrawLines(tpb);
 }
 
+/* LEFT / RIGHT: Half a box at a time, like less. Right only goes on while some line on the screen is cut off. */
+static void ad_textFileBoxMoveSideways(ad_TextFileBox *tfb, bool right) {
+    size_t          step    = AD_MAX((size_t) tfb->lineWidth / 2, 1);
+    ad_FileOffset   pos     = tfb->top;
+    bool            more    = true;
+    size_t          length;
+    size_t          i;
+
+    if (tfb->wrap) {
+        return;
+    }
+
+    if (!right) {
+        tfb->column -= AD_MIN(tfb->column, step);
+    } else {
+        for (i = 0; more && i < (size_t) tfb->linesOnScreen; i++) {
+            if (ad_textViewGetLineAt(tfb->view, pos, &length) != NULL && length > tfb->column + tfb->lineWidth) {
+                tfb->column += step;
+                break;
+            }
+
+            more = ad_textViewNextLine(tfb->view, &pos);
+        }
+    }
+
+    ad_textFileBoxRedrawLines(tfb);
+}
+
+/* w: Soft wrap on / off. Nothing is worked out up front, so this is instant for any file. */
+static void ad_textFileBoxToggleWrap(ad_TextFileBox *tfb) {
+    tfb->wrap = !tfb->wrap;
+    tfb->column = 0;
+    tfb->currentRow = 0;
+    ad_textFileBoxRowsDown(tfb, 0);
+    ad_textFileBoxRedrawLines(tfb);
+}
+
+/* Like less, the line with the byte at <percent> of the file is found by scanning back to its start, no lines are counted */
+static void ad_textFileBoxGoToPercent(ad_TextFileBox *tfb, size_t percent) {
+    ad_FileOffset size;
+
+    ad_textViewGetData(tfb->view, &size);
+    /* Split up so it can't overflow */
+    ad_textFileBoxScrollTo(tfb, size / 100 * percent + size % 100 * percent / 100);
+}
+
+static void ad_textFileBoxGoToBegin(ad_TextFileBox *tfb) {
+    tfb->gotoEditing = true;
+    tfb->gotoLength = 0;
+    tfb->gotoText.text[0] = 0x00;
+
+    ad_textFileBoxUpdateFooter(tfb);
+    ad_present();
+}
+
+/* Handles a key while the line number (or percentage, ending with %) to go to is typed */
+static void ad_textFileBoxGoToKey(ad_TextFileBox *tfb, uint32_t ch) {
+    bool    percent = tfb->gotoLength > 0 && tfb->gotoText.text[tfb->gotoLength - 1] == '%';
+    size_t  number  = 0;
+    size_t  i;
+
+    if (ch == AD_KEY_ENTER || ch == AD_KEY_ESC) {
+        tfb->gotoEditing = false;
+
+        /* Way past the end is as good as the end, as long as the lines after it can still be counted */
+        for (i = 0; ch == AD_KEY_ENTER && i < tfb->gotoLength && tfb->gotoText.text[i] != '%'; i++) {
+            number = AD_MIN(number * 10 + (size_t) (tfb->gotoText.text[i] - '0'), SIZE_MAX / 16);
+        }
+
+        if (i == 0) {
+            ad_textFileBoxRedrawLines(tfb);
+        } else if (percent) {
+            ad_textFileBoxGoToPercent(tfb, AD_MIN(number, 100));
+        } else {
+            ad_textFileBoxScrollToLine(tfb, number > 0 ? number - 1 : 0);
+        }
+
+        return;
+    }
+
+    if (AD_IS_BACKSPACE(ch) && tfb->gotoLength > 0) {
+        tfb->gotoLength--;
+    } else if (!percent && ((ch >= '0' && ch <= '9') || (ch == '%' && tfb->gotoLength > 0)) && tfb->gotoLength < AD_TEXT_ELEMENT_SIZE - 1) {
+        tfb->gotoText.text[tfb->gotoLength++] = (char) ch;
+    } else {
+        return;
+    }
+
+    tfb->gotoText.text[tfb->gotoLength] = 0x00;
+    ad_textFileBoxUpdateFooter(tfb);
+    ad_present();
+}
+
+static void ad_textFileBoxSearchStop(ad_TextFileBox *tfb) {
+    ad_textSearchDestroy(tfb->find);
+    ad_textSearchDestroy(tfb->count);
+    tfb->find = NULL;
+    tfb->count = NULL;
+}
+
+/* Goes to the hit once the search has found it. Like less, the line with the hit becomes the top one (with wrapping, the row). */
+static void ad_textFileBoxSearchPoll(ad_TextFileBox *tfb) {
+    ad_FileOffset   lineStart;
+    size_t          start;
+    size_t          hitRow;
+
+    if (tfb->find == NULL || !ad_textSearchIsDone(tfb->find)) {
+        return;
+    }
+
+    tfb->hasHit = ad_textSearchGetHit(tfb->find, &tfb->hit);
+    ad_textSearchDestroy(tfb->find);
+    tfb->find = NULL;
+
+    if (tfb->hasHit) {
+        lineStart = ad_textViewLineStartAt(tfb->view, tfb->hit);
+
+        /* A hit beyond the edges of a cut off line is brought into the middle of the box */
+        if (!tfb->wrap) {
+            start = (size_t) (tfb->hit - lineStart);
+
+            if (start < tfb->column || start + tfb->searchLength + 3 > tfb->column + tfb->lineWidth) {
+                tfb->column = start - AD_MIN(start, (size_t) tfb->lineWidth / 2);
+            }
+        }
+
+        /* With wrapping, it's the row with the hit that has to be on the screen */
+        hitRow = tfb->wrap ? (size_t) (tfb->hit - lineStart) / tfb->lineWidth : 0;
+
+        if (lineStart < tfb->top || (lineStart == tfb->top && hitRow < tfb->currentRow)
+            || ad_textFileBoxRowsTo(tfb, lineStart, (size_t) tfb->linesOnScreen) + hitRow - (lineStart == tfb->top ? tfb->currentRow : 0) >= (size_t) tfb->linesOnScreen) {
+            ad_textFileBoxScrollTo(tfb, tfb->hit);
+            return;
+        }
+    } else if (tfb->searchEditing) {
+        /* While typing, the box only shows hits, so without one it goes back to where it was */
+        ad_textFileBoxScrollTo(tfb, tfb->searchOrigin);
+        return;
+    }
+
+    ad_textFileBoxRedrawLines(tfb);
+}
+
+/* Looks for the search text again from <origin> on. Hits are counted in the background meanwhile if <recount>. */
+static void ad_textFileBoxSearchFrom(ad_TextFileBox *tfb, ad_FileOffset origin, bool backward, bool recount) {
+    ad_textSearchDestroy(tfb->find);
+    tfb->find = ad_textSearchFind(tfb->view, tfb->searchText.text, tfb->searchLength, origin, backward);
+
+    if (recount) {
+        ad_textSearchDestroy(tfb->count);
+        tfb->count = ad_textSearchCount(tfb->view, tfb->searchText.text, tfb->searchLength);
+    }
+
+    ad_textFileBoxSearchPoll(tfb);
+}
+
+static void ad_textFileBoxSearchBegin(ad_TextFileBox *tfb, bool backward) {
+    ad_textFileBoxSearchStop(tfb);
+
+    tfb->searchEditing = true;
+    tfb->searchBackward = backward;
+    tfb->searchLength = 0;
+    tfb->searchText.text[0] = 0x00;
+    tfb->hasHit = false;
+    tfb->searchOrigin = tfb->top;
+
+    ad_textFileBoxRedrawLines(tfb);
+}
+
+/* Handles a key while the search text is typed. Every change starts the search over from where typing started. */
+static void ad_textFileBoxSearchKey(ad_TextFileBox *tfb, uint32_t ch) {
+    if (ch == AD_KEY_ENTER) {
+        tfb->searchEditing = false;
+        ad_textFileBoxRedrawLines(tfb);
+        return;
+    }
+
+    if (ch == AD_KEY_ESC) {
+        ad_textFileBoxSearchStop(tfb);
+        tfb->searchEditing = false;
+        tfb->searchLength = 0;
+        tfb->hasHit = false;
+        ad_textFileBoxScrollTo(tfb, tfb->searchOrigin);
+        return;
+    }
+
+    if (AD_IS_BACKSPACE(ch) && tfb->searchLength > 0) {
+        tfb->searchLength--;
+    } else if (ch >= 0x20 && ch < 0x7F && tfb->searchLength < AD_TEXT_ELEMENT_SIZE - 1) {
+        tfb->searchText.text[tfb->searchLength++] = (char) ch;
+    } else {
+        return;
+    }
+
+    tfb->searchText.text[tfb->searchLength] = 0x00;
+    tfb->hasHit = false;
+
+    if (tfb->searchLength == 0) {
+        ad_textFileBoxSearchStop(tfb);
+        ad_textFileBoxScrollTo(tfb, tfb->searchOrigin);
+    } else {
+        ad_textFileBoxSearchFrom(tfb, tfb->searchOrigin, tfb->searchBackward, true);
+        ad_textFileBoxRedrawLines(tfb);
+    }
+}
+
+/* n / N: Next hit in the direction of the search, or the other one if <reverse> */
+static void ad_textFileBoxSearchNext(ad_TextFileBox *tfb, bool reverse) {
+    bool            backward    = tfb->searchBackward != reverse;
+    ad_FileOffset   origin;
+
+    if (tfb->searchLength == 0) {
+        return;
+    }
+
+    /* A hit that is still being looked for is where this one goes on from */
+    if (tfb->find != NULL) {
+        ad_textSearchWait(tfb->find);
+        ad_textFileBoxSearchPoll(tfb);
+    }
+
+    /* Going forward past the whole hit, n and N go through the same hits that are counted and highlighted */
+    if (tfb->hasHit) {
+        origin = backward ? tfb->hit : tfb->hit + tfb->searchLength;
+    } else {
+        origin = tfb->top;
+    }
+
+    ad_textFileBoxSearchFrom(tfb, origin, backward, false);
+}
+
+/* Takes in what was appended to a followed file. If the end of the file was on the screen, the box scrolls along.
+   Any other file is only checked for something having cut it short, before it gets drawn again. */
+static void ad_textFileBoxFollowUpdate(ad_TextFileBox *tfb) {
+    bool                atEnd;
+    ad_TextViewChange   change;
+
+    atEnd = tfb->following && ad_textFileBoxRowsTo(tfb, AD_TEXTFILEBOX_END, (size_t) tfb->linesOnScreen + 1) <= (size_t) tfb->linesOnScreen;
+
+    /* The file data can only move while no search is reading it */
+    change = ad_textViewCheckFile(tfb->view, tfb->find == NULL && ad_textSearchIsDone(tfb->count));
+
+    /* Cut short under the searches: they are stopped, as nothing can be drawn from the file before it is taken in again */
+    if (change == AD_TEXT_VIEW_BLOCKED) {
+        ad_textFileBoxSearchStop(tfb);
+        change = ad_textViewCheckFile(tfb->view, true);
+    }
+
+    if (change == AD_TEXT_VIEW_UNCHANGED || change == AD_TEXT_VIEW_BLOCKED) {
+        return;
+    }
+
+    /* Old hits and counts are meaningless in a file that started over */
+    if (change == AD_TEXT_VIEW_RELOADED) {
+        tfb->hasHit = false;
+        ad_textSearchDestroy(tfb->count);
+        tfb->count = (tfb->searchLength > 0) ? ad_textSearchCount(tfb->view, tfb->searchText.text, tfb->searchLength) : NULL;
+    }
+
+    ad_textFileBoxScrollTo(tfb, atEnd ? AD_TEXTFILEBOX_END : tfb->top + (ad_FileOffset) tfb->currentRow * tfb->lineWidth);
+}
+
+static bool ad_textFileBoxIsBusy(ad_TextFileBox *tfb) {
+    return tfb->following || ad_textViewIsIndexing(tfb->view) || tfb->find != NULL || !ad_textSearchIsDone(tfb->count);
+}
+
 static int32_t ad_textFileBoxExecute(ad_TextFileBox *tfb) {
-    uint32_t ch;
+    uint32_t    ch;
+    bool        busy    = false;
+    bool        wasBusy;
 
     AD_RETURN_ON_NULL(tfb, AD_ERROR);
 
     ad_textFileBoxRedrawLines(tfb);
 
     while (true) {
-        ch = hal_getKey();
+        wasBusy = busy;
+        busy    = ad_textFileBoxIsBusy(tfb);
+
+        /* Until a key comes, the footer keeps up with the indexing and searching */
+        /* The file is checked first, a search that finished may draw the box */
+        if (busy && !hal_waitForKey(AD_TEXTFILEBOX_REFRESH_MS)) {
+            ad_textFileBoxFollowUpdate(tfb);
+            ad_textFileBoxSearchPoll(tfb);
+            ad_textFileBoxUpdateFooter(tfb);
+            continue;
+        }
 
-        if          (ch == AD_KEY_UP) {
+        ad_textFileBoxSearchPoll(tfb);
+
+        /* Whatever finished after the last footer update has to show before the box waits for good */
+        if (wasBusy && !busy) {
+            ad_textFileBoxUpdateFooter(tfb);
+        }
+
+        ch = hal_getKey();
+        /* The file may have changed while the key was waited for */
+        ad_textFileBoxFollowUpdate(tfb);
+
+        if (tfb->gotoEditing) {
+            ad_textFileBoxGoToKey(tfb, ch);
+        } else if   (tfb->searchEditing) {
+            ad_textFileBoxSearchKey(tfb, ch);
+        } else if   (ch == AD_KEY_UP) {
             ad_textFileBoxMove(tfb, -1);
         } else if   (ch == AD_KEY_DOWN) {
             ad_textFileBoxMove(tfb, +1);
@@ -516,6 +1153,20 @@ static int32_t ad_textFileBoxExecute(ad_TextFileBox *tfb) {
             ad_textFileBoxMove(tfb, -tfb->linesOnScreen);
         } else if   (ch == AD_KEY_PGDN) {
             ad_textFileBoxMove(tfb, +tfb->linesOnScreen);
+        } else if   (ch == AD_KEY_LEFT || ch == AD_KEY_RIGHT) {
+            ad_textFileBoxMoveSideways(tfb, ch == AD_KEY_RIGHT);
+        } else if   (ch == 'w') {
+            ad_textFileBoxToggleWrap(tfb);
+        } else if   (ch == AD_KEY_HOME || ch == 'g') {
+            ad_textFileBoxScrollTo(tfb, 0);
+        } else if   (ch == AD_KEY_END || ch == 'G') {
+            ad_textFileBoxGoToPercent(tfb, 100);
+        } else if   (ch == ':') {
+            ad_textFileBoxGoToBegin(tfb);
+        } else if   (ch == '/' || ch == '?') {
+            ad_textFileBoxSearchBegin(tfb, ch == '?');
+        } else if   (ch == 'n' || ch == 'N') {
+            ad_textFileBoxSearchNext(tfb, ch == 'N');
         } else if   (ch == AD_KEY_ENTER) {
             return 0;
         } /*else if   (menu->cancelable && (ch == AD_KEY_ESCAPE || ch == AD_KEY_ESCAPE2)) {
@@ -533,14 +1184,20 @@ static int32_t ad_textFileBoxExecute(ad_TextFileBox *tfb) {
 
 static void ad_textFileBoxDestroy(ad_TextFileBox *tfb) {
     if (tfb) {
-        ad_multiLineTextDestroy(tfb->lines);
+        ad_textFileBoxSearchStop(tfb);
+
+        if (tfb->view != NULL && ad_s_ctx->indexCache.text[0] != 0x00) {
+            ad_textViewStoreIndex(tfb->view, ad_s_ctx->indexCache.text);
+        }
+
+        ad_textViewClose(tfb->view);
         ad_objectUnpaint(&tfb->object);
         free(tfb);
     }
 }
 
 int32_t ad_textFileBox(const char *title, const char *fileName) {
-    ad_TextFileBox *tfb = ad_textFileBoxCreate(title, fileName);
+    ad_TextFileBox *tfb = ad_textFileBoxCreate(title, fileName, false);
     int ret;
     AD_RETURN_ON_NULL(tfb, AD_ERROR);
     ret = ad_textFileBoxExecute(tfb);
@@ -548,6 +1205,19 @@ int32_t ad_textFileBox(const char *title, const char *fileName) {
     return ret;
 }
 
+int32_t ad_textFileBoxFollow(const char *title, const char *fileName) {
+    ad_TextFileBox *tfb = ad_textFileBoxCreate(title, fileName, true);
+    int ret;
+    AD_RETURN_ON_NULL(tfb, AD_ERROR);
+    ret = ad_textFileBoxExecute(tfb);
+    ad_textFileBoxDestroy(tfb);
+    return ret;
+}
+
+void ad_textFileBoxSetIndexCache(const char *directory) {
+    ad_textElementAssign(&ad_s_ctx->indexCache, directory != NULL ? directory : "");
+}
+
 #if defined(AD_HAL_HAS_POPEN)
 
 static void ad_commandBoxRedraw(const ad_TextElement *lines, size_t lineCount, uint16_t contentWidth, size_t index, uint16_t x, uint16_t y) {
@@ -557,6 +1227,8 @@ static void ad_commandBoxRedraw(const ad_TextElement *lines, size_t lineCount, u
         ad_displayStringCropped(lines[index % lineCount].text, x, y + curLine, contentWidth, ad_s_con.objectBg, ad_s_con.objectFg);
         index++;
     }
+
+    ad_present();
 }
 
 #ifndef WEXITSTATUS
@@ -578,6 +1250,7 @@ int32_t ad_runCommandBox(const char *title, const char *command) {
     AD_RETURN_ON_NULL(command, AD_ERROR);
     AD_RETURN_ON_NULL(title, AD_ERROR);
 
+    memset(&obj, 0, sizeof(obj));
     ad_textElementAssign(&obj.title, title);
     ad_textElementAssignFormatted(&obj.footer, "Running: '%s'...", command);
     ad_objectInitialize(&obj, lineWidth, visibleLines);
@@ -645,7 +1318,7 @@ static void ad_displayMultiSelectorOptions(ad_MultiSelector *menu) {
         ad_displayStringCropped(menu->itemOptions[i].options[selectedIndex].text, x, y, maximumWidth, ad_s_con.objectBg, ad_s_con.objectFg);
         y++;
     }
-    hal_flush();
+    ad_present();
 }
 
 static const char *ad_multiSelectorOptionText(ad_MultiSelector *menu, size_t itemIndex) {
@@ -659,7 +1332,7 @@ static void ad_multiSelectorSelectOptionAndDraw(ad_MultiSelector *menu, size_t n
     ad_displayStringCropped(ad_multiSelectorOptionText(menu, menu->currentSelection),   menu->optionX, menu->optionY + menu->currentSelection, menu->optionWidth, ad_s_con.objectBg, ad_s_con.objectFg);
     ad_displayStringCropped(ad_multiSelectorOptionText(menu, newSelection),             menu->optionX, menu->optionY + newSelection,           menu->optionWidth, ad_s_con.objectFg, ad_s_con.objectBg);
     menu->currentSelection = newSelection;
-    hal_flush();
+    ad_present();
 }
 
 
@@ -682,7 +1355,7 @@ static bool ad_multiSelectorPaint(ad_MultiSelector *menu) {
 
     /* Factor in the prompt length into window width calculation */
     if (menu->prompt) {
-        maximumPromptWidth = ad_textElementArrayGetLongestLength(menu->prompt->lineCount, menu->prompt->lines);
+        maximumPromptWidth = menu->prompt->longestLine;
         windowContentWidth = AD_MAX(windowContentWidth, maximumPromptWidth);
     }
 
@@ -703,7 +1376,7 @@ static bool ad_multiSelectorPaint(ad_MultiSelector *menu) {
     /* Print prompt if it exists */
     if (menu->prompt) {   
         uint16_t promptX = ad_objectGetContentX(&menu->object);
-        ad_displayTextElementArray(promptX, menu->itemY, ad_objectGetContentWidth(&menu->object), menu->prompt->lineCount, menu->prompt->lines);
+        ad_displayMultiLineText(promptX, menu->itemY, ad_objectGetContentWidth(&menu->object), menu->prompt, 0, menu->prompt->lineCount);
         menu->itemY   += 1 + menu->prompt->lineCount;
         menu->optionY += 1 + menu->prompt->lineCount;
     }
@@ -16,17 +16,28 @@
 #include <string.h>
 #include <assert.h>
 #include <signal.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
 
 #include "anbui.h"
 #include "ad_priv.h"
 #include "ad_hal.h"
 
-ad_ConsoleConfig ad_s_con;
-ad_TextElement ad_s_title;
+static ad_Context s_defaultContext = { &hal_platform, { 0 }, { { 0 } }, NULL, NULL, { { 0 } } };
+AD_THREAD_LOCAL ad_Context *ad_s_ctx = &s_defaultContext;
 
 void ad_init(const char *title) {
+    ad_initWithHal(title, NULL);
+}
+
+void ad_initWithHal(const char *title, ad_Hal *hal) {
     assert(title);
 
+    ad_s_hal = (hal != NULL) ? hal : &hal_platform;
+
     ad_s_con.width          = 0;
     ad_s_con.height         = 0;
     ad_s_con.headerBg       = COLOR_RED;
@@ -47,10 +58,79 @@ void ad_init(const char *title) {
 }
 
 void ad_restore(void) {
-    hal_restoreConsole();
+    /* With a render thread running, only it may touch the console */
+    if (!ad_asyncRestoreConsole()) {
+        hal_restoreConsole();
+        ad_screenInvalidate();
+    }
     ad_drawBackground(ad_s_title.text);
 }
 
 void ad_deinit() {
     ad_deinitConsole();
 }
+
+ad_Context *ad_contextCreate(void) {
+    ad_Context *ret = calloc(1, sizeof(ad_Context));
+    AD_RETURN_ON_NULL(ret, NULL);
+    ret->hal = &hal_platform;
+    return ret;
+}
+
+void ad_contextDestroy(ad_Context *ctx) {
+    if (ctx == NULL || ctx == &s_defaultContext) {
+        return;
+    }
+
+    if (ctx->screen != NULL) {
+        ad_contextDeinit(ctx);
+    }
+
+    if (ad_s_ctx == ctx) {
+        ad_s_ctx = &s_defaultContext;
+    }
+
+    free(ctx);
+}
+
+void ad_contextMakeCurrent(ad_Context *ctx) {
+    ad_s_ctx = (ctx != NULL) ? ctx : &s_defaultContext;
+}
+
+ad_Context *ad_contextGetCurrent(void) {
+    return ad_s_ctx;
+}
+
+void ad_contextInit(ad_Context *ctx, const char *title, ad_Hal *hal) {
+    ad_Context *previous = ad_s_ctx;
+    ad_contextMakeCurrent(ctx);
+    ad_initWithHal(title, hal);
+    ad_s_ctx = previous;
+}
+
+void ad_contextRestore(ad_Context *ctx) {
+    ad_Context *previous = ad_s_ctx;
+    ad_contextMakeCurrent(ctx);
+    ad_restore();
+    ad_s_ctx = previous;
+}
+
+void ad_contextDeinit(ad_Context *ctx) {
+    ad_Context *previous = ad_s_ctx;
+    ad_contextMakeCurrent(ctx);
+    ad_deinit();
+    ad_s_ctx = previous;
+}
+
+uint32_t ad_getMilliseconds(void) {
+#if defined(__unix__) || defined(__APPLE__)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) ts.tv_sec * 1000 + (uint32_t) (ts.tv_nsec / 1000000);
+#elif defined(_WIN32)
+    return (uint32_t) GetTickCount();
+#else
+    /* On DOS this is the timer tick count, i.e. wall time */
+    return (uint32_t) ((double) clock() * 1000.0 / (double) CLOCKS_PER_SEC);
+#endif
+}
@@ -45,15 +45,36 @@ typedef struct ad_ProgressBox   ad_ProgressBox;
 typedef struct ad_Menu          ad_Menu;
 typedef struct ad_MultiSelector ad_MultiSelector;
 typedef struct ad_ConsoleConfig ad_ConsoleConfig;
+typedef struct ad_Hal           ad_Hal;
+typedef struct ad_Context       ad_Context;
 
 /*  Initializes AnbUI.
     This call is REQUIRED before using *ANY* other functions declared here. */
 void            ad_init                 (const char *title);
+/*  Same as ad_init, but draws through the given HAL instead of the platform's console (NULL = platform console).
+    This allows e.g. rendering into memory or wrapping the output for tracing/profiling. See ad_hal.h */
+void            ad_initWithHal          (const char *title, ad_Hal *hal);
 /*  Restores AnbUI's text frontend.
     This is helpful if the user intends to run other commands in the same text display which outputs text on the screen. */
 void            ad_restore              (void);
 /*  Deinitializes AnbUI and restores the system's original text console state. */
 void            ad_deinit               (void);
+
+/*  Contexts: Each context is a UI of its own with its own console settings, screen and HAL,
+    so one process can drive several consoles (e.g. one per pty), each from its own thread.
+    All functions in this header work on the calling thread's current context.
+    Threads start out with the default context, which is all that's needed for a single UI. */
+ad_Context     *ad_contextCreate        (void);
+/*  Destroys a context, deinitializing it first if needed. The default context can't be destroyed. */
+void            ad_contextDestroy       (ad_Context *ctx);
+/*  Makes <ctx> the calling thread's current context. NULL selects the default context. */
+void            ad_contextMakeCurrent   (ad_Context *ctx);
+ad_Context     *ad_contextGetCurrent    (void);
+/*  Same as ad_initWithHal, ad_restore and ad_deinit, but on <ctx> instead of the current context */
+void            ad_contextInit          (ad_Context *ctx, const char *title, ad_Hal *hal);
+void            ad_contextRestore       (ad_Context *ctx);
+void            ad_contextDeinit        (ad_Context *ctx);
+
 /*  Sets the footer text on the screen */
 void            ad_setFooterText        (const char *footer);
 /*  Clears the footer on the screen*/
@@ -112,8 +133,25 @@ void            ad_progressBoxAddItem   (ad_ProgressBox *pb, const char *label,
 bool            ad_progressBoxPaint     (ad_ProgressBox *pb);
 /*  Updates the progress box with the given progress value. The fill level is calculated as progress-out-of-maxProgress. */
 void            ad_progressBoxUpdate    (ad_ProgressBox *pb, uint32_t progress);
-/*  Updates the n-th progress box with the given progress value. The fill level is calculated as progress-out-of-maxProgress. */
+/*  Updates the n-th progress box with the given progress value. The fill level is calculated as progress-out-of-maxProgress.
+    This overwrites the published value of the bar, so don't use it on a bar that worker threads publish to. */
 void            ad_progressBoxMultiUpdate(ad_ProgressBox *pb, size_t index, uint32_t progress);
+/*  Limits how often the progress box is redrawn. Updates in between only record the value, which is cheap,
+    so they can be called as often as desired (e.g. per copied block). 0 (default) redraws on every update.
+    Whatever is pending gets drawn by ad_progressBoxRefresh or at the latest by ad_progressBoxDestroy. */
+void            ad_progressBoxSetRefreshRate(ad_ProgressBox *pb, uint32_t refreshesPerSecond);
+/*  Draws the latest progress values of all bars right now */
+void            ad_progressBoxRefresh   (ad_ProgressBox *pb);
+/*  Thread-safe progress: These can be called from any thread, any number of threads at once. They only
+    publish the value (lock-free, no I/O), the screen is updated by ad_progressBoxSample on the UI thread.
+    All bars must have been added before publishing starts and publishing must stop before ad_progressBoxDestroy.
+    Needs atomics (C11, MSVC, GCC or clang), without them publish only from the UI thread. */
+void            ad_progressBoxPublish   (ad_ProgressBox *pb, size_t index, uint32_t progress);
+void            ad_progressBoxPublishAdd(ad_ProgressBox *pb, size_t index, uint32_t delta);
+void            ad_progressBoxPublishMaxProgress(ad_ProgressBox *pb, size_t index, uint32_t maxProgress);
+/*  UI thread: Picks up the published progress values and redraws, honoring ad_progressBoxSetRefreshRate.
+    Returns true if anything was published since the last call. */
+bool            ad_progressBoxSample    (ad_ProgressBox *pb);
 /*  Intended for multi-item progress bars. Sets the maximum progress value for the bar at <index>.
     Example: useful if the total size of a file copy isnt known at the box's creation */
 void            ad_progressBoxSetMaxProgress(ad_ProgressBox *obj, size_t index, uint32_t maxProgress);
@@ -121,23 +159,67 @@ void            ad_progressBoxSetMaxProgress(ad_ProgressBox *obj, size_t index,
 void            ad_progressBoxSetCharAndColor(char fillChar, uint8_t colorBlankBg, uint8_t colorBlankFg, uint8_t colorFillBg, uint8_t colorFillFg);
 
 /*  Displays a scrollable display box which contains the contents of the text file pointed to by fileName.
-    It does NOT support horizontal scrolling, lines that are too long will be cut off and truncated with a "..." suffix.
+    Lines that are too long are cut off with a "..." suffix, LEFT / RIGHT scroll sideways, 'w' wraps them onto the rows below instead.
     The file should not contain unicode characters, as I'm too lazy to handle these correctly.
-    The entire file will be loaded into memory, so be mindful with the sizes.
+    '/' and '?' search forward / backward as you type, 'n' and 'N' go to the next / previous hit.
+    HOME / END (or 'g' / 'G') go to the start / end, ':' goes to a line number, or to a percentage of the file if it ends with '%'.
+    The end and percentages are there right away in any file, the footer shows the line number once the indexing got that far.
+    The file is not loaded into memory, only the lines that are shown are read, so it can be of any size.
+    NOTE:   The file is mapped into memory. If another program makes it shorter while the box is open, the box
+            notices before it draws again and reads in what is left of it instead, but a search or background
+            indexing that is running at that very moment can still crash on the part that is gone.
     Returns AD_ERROR if there was a problem (bad file, allocation failure, etc.) */
 int32_t         ad_textFileBox          (const char *title, const char *fileName);
+/*  Same as ad_textFileBox, but the box keeps showing what gets appended to the file while it is open (like tail -f).
+    If the end of the file is on the screen, the box scrolls along. Only the new data is ever read.
+    On DOS this is the same as ad_textFileBox. */
+int32_t         ad_textFileBoxFollow    (const char *title, const char *fileName);
+/*  Keeps the line indexes of big files shown in text file boxes in <directory>, so showing the same file again
+    doesn't have to look through it for its lines again. The directory must exist. NULL turns this off (the default).
+    Only indexes that were complete when the box was closed get kept. Not available on DOS. */
+void            ad_textFileBoxSetIndexCache(const char *directory);
 /*  Displays a display box that shows the output of the given command line (which includes all parameters)
     NOTE:   This is ONLY available on platforms which support pipes and popen!
             (aka. pretty much everything other than DOS) */
 int32_t         ad_runCommandBox        (const char *title, const char *command);
 
-/*  Save the screen state internally so it can be recalled later. Doing this twice will overwrite the first backup.
+/*  Save the screen state internally so it can be recalled later.
+    Saved states are stacked, so this can be nested as deep as needed. Each call needs a matching ad_screenLoadState.
     This can be used to, for example, display an error message box and restore the previously displayed UI
     after the error was handled. */
 void            ad_screenSaveState      (void);
-/*  Restores the screen after a previous "screenSaveState" call. */
+/*  Like ad_screenSaveState, but only saves the given rectangle of the screen.
+    Cheaper if it is known which part of the screen is about to be drawn over. */
+void            ad_screenSaveRegion     (uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+/*  Restores the screen (or region) saved by the most recent ad_screenSaveState / ad_screenSaveRegion call. */
 void            ad_screenLoadState      (void);
 
+/*  Sends everything that was drawn since the last call to the screen. Only cells that actually changed are sent.
+    All UI components do this on their own, so this is only needed after drawing through the lower level helpers. */
+void            ad_present              (void);
+
+/*  What ad_present does when the render thread can't keep up */
+typedef enum {
+    AD_ASYNC_BLOCK = 0,         /* Wait for a free slot in the queue (backpressure) */
+    AD_ASYNC_DROP_FRAMES        /* Never wait, frames that were not shown yet get replaced by newer ones */
+} ad_AsyncPolicy;
+
+typedef struct {
+    uint32_t    framesSubmitted;
+    uint32_t    framesRendered;
+    uint32_t    framesDropped;
+    uint32_t    producerWaits;  /* Times ad_present had to wait for a free slot */
+} ad_AsyncStats;
+
+/*  Starts a render thread: From now on, ad_present only hands a copy of the screen to it through a
+    lock-free queue of <queueLength> entries and the render thread writes it to the console.
+    Drawing happens on the calling thread as before, the UI must still only be used from one thread.
+    Returns false if threads are not available on this platform; everything then stays synchronous. */
+bool            ad_asyncStart           (ad_AsyncPolicy policy, size_t queueLength);
+/*  Shows everything still queued and stops the render thread. Also done by ad_deinit. */
+void            ad_asyncStop            (void);
+void            ad_asyncGetStats        (ad_AsyncStats *stats);
+
 /*  Create a multi selector menu with given title and prompt.
     Cancelable means the menu can be cancelled using the ESC key.
     Must be deallocated with ad_multiSelectorDestroy */
@@ -61,7 +61,7 @@ static inline void pl_dos_advanceCursor(uint16_t count) {
     }
 }
 
-static inline void pl_dos_putString(const char *str, uint16_t length) {
+static inline void pl_dos_putStringWithLength(const char *str, uint16_t length) {
     while (length--) {
         s_cursorPtr->c = *str;
         s_cursorPtr->attr = s_biosColor;
@@ -121,10 +121,13 @@ static bool pl_dos_getVGADynamicStateTable(uint8_t _far *table) {
     return retAl == 0x1B;
 }
 
-void hal_initConsole(ad_ConsoleConfig *cfg) {
+static void pl_dos_restoreConsole(ad_Hal *hal);
+
+static void pl_dos_initConsole(ad_Hal *hal, ad_ConsoleConfig *cfg) {
     uint8_t   dynamicVGAInfo[64];
     uint16_t *biosWidth  = (uint16_t *) &dynamicVGAInfo[0x05];
     uint8_t  *biosHeight = (uint8_t *)  &dynamicVGAInfo[0x22];
+    AD_UNUSED_PARAMETER(hal);
 
     pl_dos_saveCursorSize();
 
@@ -142,11 +145,12 @@ void hal_initConsole(ad_ConsoleConfig *cfg) {
 
     memset(s_printBuffer, 0x00, sizeof(s_printBuffer));
 
-    hal_restoreConsole();
+    pl_dos_restoreConsole(hal);
 
 }
 
-void hal_restoreConsole(void) {
+static void pl_dos_restoreConsole(ad_Hal *hal) {
+    AD_UNUSED_PARAMETER(hal);
     s_vgaMemory = MK_FP(0xB800, 0x0000);
     s_vgaMemoryUpperBound = s_vgaMemory + s_consoleH * s_consoleW * 2;
     s_cursorPtr = s_vgaMemory;
@@ -158,27 +162,32 @@ void hal_restoreConsole(void) {
     pl_dos_disableCursor();
 }
 
-void hal_deinitConsole(void) {
+static void pl_dos_deinitConsole(ad_Hal *hal) {
+    AD_UNUSED_PARAMETER(hal);
     pl_dos_restoreCursor();
 }
 
-void hal_setColor(uint8_t bg, uint8_t fg) {
+static void pl_dos_setColor(ad_Hal *hal, uint8_t bg, uint8_t fg) {
+    AD_UNUSED_PARAMETER(hal);
     s_biosColor = (bg & 0x07) << 4 | fg & 0x0F;
 }
 
-void hal_setCursorPosition(uint16_t x, uint16_t y) {
+static void pl_dos_setCursorPosition(ad_Hal *hal, uint16_t x, uint16_t y) {
+    AD_UNUSED_PARAMETER(hal);
     s_cursorPtr = &s_vgaMemory[x];
     while (y--) {
         s_cursorPtr = &s_cursorPtr[s_consoleW];
     }
 }
 
-void hal_putString(const char *str) {
-    pl_dos_putString(str, (uint16_t) strlen(str));
+static void pl_dos_putString(ad_Hal *hal, const char *str) {
+    AD_UNUSED_PARAMETER(hal);
+    pl_dos_putStringWithLength(str, (uint16_t) strlen(str));
 }
 
-void hal_putChar(char c, size_t count) {
+static void pl_dos_putChar(ad_Hal *hal, char c, size_t count) {
     pl_dos_BiosChar bc;
+    AD_UNUSED_PARAMETER(hal);
     bc.c = c;
     bc.attr = s_biosColor;
     while (count--) {
@@ -187,12 +196,52 @@ void hal_putChar(char c, size_t count) {
     pl_dos_advanceCursor(0);
 }    
 
-void hal_flush(void) {
+static void pl_dos_putSpan(ad_Hal *hal, const ad_Char *cells, size_t count) {
+    AD_UNUSED_PARAMETER(hal);
+    while (count--) {
+        s_biosColor = (ad_cellShownBg(cells) & 0x07) << 4 | ad_cellShownFg(cells) & 0x0F;
+        s_cursorPtr->c = (char) cells->ascii;
+        s_cursorPtr->attr = s_biosColor;
+        s_cursorPtr++;
+        cells++;
+    }
+    pl_dos_advanceCursor(0);
+}
+
+static bool pl_dos_scrollRows(ad_Hal *hal, uint16_t top, uint16_t bottom, int lines) {
+    uint16_t shift = (uint16_t) (lines < 0 ? -lines : lines);
+    uint16_t rows  = bottom - top - shift;
+    AD_UNUSED_PARAMETER(hal);
+
+    /* It's all in video memory, so this is just a move */
+    if (lines > 0) {
+        _fmemmove(&s_vgaMemory[top * s_consoleW], &s_vgaMemory[(top + shift) * s_consoleW], rows * s_consoleW * sizeof(pl_dos_BiosChar));
+    } else {
+        _fmemmove(&s_vgaMemory[(top + shift) * s_consoleW], &s_vgaMemory[top * s_consoleW], rows * s_consoleW * sizeof(pl_dos_BiosChar));
+    }
+
+    return true;
+}
+
+static bool pl_dos_canScrollRows(ad_Hal *hal) {
+    AD_UNUSED_PARAMETER(hal);
+    return true;
+}
+
+static void pl_dos_flush(ad_Hal *hal) {
+    AD_UNUSED_PARAMETER(hal);
     /* Nothing on DOS, it always displays everything immediately */
 }
 
-uint32_t hal_getKey(void) {
+static void pl_dos_getOutputStats(ad_Hal *hal, ad_OutputStats *stats) {
+    AD_UNUSED_PARAMETER(hal);
+    /* Not tracked here */
+    memset(stats, 0, sizeof(ad_OutputStats));
+}
+
+static uint32_t pl_dos_getKey(ad_Hal *hal) {
     uint32_t c = (uint32_t) getch();
+    AD_UNUSED_PARAMETER(hal);
 
     /* Extended function */
     if (c == 0) { c = ((uint32_t) getch()) << 16L; }
@@ -202,6 +251,8 @@ uint32_t hal_getKey(void) {
         case 0x0000000d: return AD_KEY_ENTER;
         case 0x00490000: return AD_KEY_PGUP;
         case 0x00510000: return AD_KEY_PGDN;
+        case 0x00470000: return AD_KEY_HOME;
+        case 0x004F0000: return AD_KEY_END;
         case 0x00480000: return AD_KEY_UP;
         case 0x00500000: return AD_KEY_DOWN;
         case 0x004B0000: return AD_KEY_LEFT;
@@ -210,3 +261,28 @@ uint32_t hal_getKey(void) {
         default: return c;
     }    
 }
+
+static bool pl_dos_waitForKey(ad_Hal *hal, uint32_t milliseconds) {
+    /* Nothing runs in the background on DOS that could use the time, so just let getKey block */
+    AD_UNUSED_PARAMETER(hal);
+    AD_UNUSED_PARAMETER(milliseconds);
+    return true;
+}
+
+ad_Hal hal_platform = {
+    pl_dos_initConsole,
+    pl_dos_restoreConsole,
+    pl_dos_deinitConsole,
+    pl_dos_setColor,
+    pl_dos_setCursorPosition,
+    pl_dos_flush,
+    pl_dos_getOutputStats,
+    pl_dos_putString,
+    pl_dos_putChar,
+    pl_dos_putSpan,
+    pl_dos_scrollRows,
+    pl_dos_canScrollRows,
+    pl_dos_getKey,
+    pl_dos_waitForKey,
+    NULL
+};
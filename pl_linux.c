@@ -16,6 +16,8 @@
 #include <sys/ioctl.h>
 #include <poll.h>
 #include <sched.h>
+#include <errno.h>
+#include <stdlib.h>
 
 #include "ad_priv.h"
 #include "ad_hal.h"
@@ -41,6 +43,13 @@
 #define PL_LINUX_PAGE_U       0x001b5b35
 #define PL_LINUX_PAGE_D       0x001b5b36
 
+#define PL_LINUX_HOME         0x001b5b48    /* xterm */
+#define PL_LINUX_END          0x001b5b46
+#define PL_LINUX_HOME_SS3     0x001b4f48    /* xterm with application cursor keys */
+#define PL_LINUX_END_SS3      0x001b4f46
+#define PL_LINUX_HOME_VT      0x1b5b317e    /* Linux console, screen, tmux */
+#define PL_LINUX_END_VT       0x001b5b34
+
 #define PL_LINUX_KEY_F1       0x001b4f50
 #define PL_LINUX_KEY_F2       0x001b4f51
 #define PL_LINUX_KEY_F3       0x001b4f52
@@ -58,76 +67,400 @@
 #define PL_LINUX_KEY_ESCAPE   0x00001b1b
 #define PL_LINUX_KEY_ESCAPE2  0x0000001b
 
-static struct termios s_originalTermios;
 static const uint8_t colorLookup[]     = { 0, 4, 2, 6, 1, 5, 3, 7, 0, 4, 2, 6, 1, 5, 3, 7 };
 static const uint8_t attributeLookup[] = { 22, 22, 22, 22, 22, 22, 22, 22, 1, 1, 1, 1, 1, 1, 1, 1 };
 
-void hal_initConsole(ad_ConsoleConfig *cfg) {
+// SGR codes to switch cell attribute flags on and off. Bold is done through attributeLookup.
+static const struct { uint8_t flag; uint8_t on; uint8_t off; } flagLookup[] = {
+    { AD_ATTR_UNDERLINE,    4, 24 },
+    { AD_ATTR_BLINK,        5, 25 },
+    { AD_ATTR_REVERSE,      7, 27 },
+};
+
+// Output gets collected here and sent with a single write() per frame on hal_flush
+#define PL_LINUX_OUT_INITIAL_SIZE 4096
+
+// Everything about one terminal. The platform HAL is stdin/stdout, ad_halTerminalCreate makes more.
+typedef struct {
+    ad_Hal          hal;
+    int             inFd;
+    int             outFd;
+    struct termios  originalTermios;
+
+    // SGR state the terminal is currently in, so we only send what actually changes
+    bool            sgrValid;
+    uint8_t         sgrBg;
+    uint8_t         sgrFg;
+    uint8_t         sgrAttr;
+    uint8_t         sgrFlags;
+
+    // Where the terminal cursor really is, so we can pick the cheapest way to move it
+    bool            cursorValid;
+    uint16_t        cursorX;
+    uint16_t        cursorY;
+    uint16_t        consoleW;
+
+    // Size used if the output isn't a terminal that can tell its own (0 = 80x25)
+    uint16_t        fixedW;
+    uint16_t        fixedH;
+
+    char           *out;
+    size_t          outLength;
+    size_t          outCapacity;
+    ad_OutputStats  outStats;
+} pl_linux_Terminal;
+
+static pl_linux_Terminal s_platform = { .inFd = STDIN_FILENO, .outFd = STDOUT_FILENO };
+
+static inline pl_linux_Terminal *pl_linux_term(ad_Hal *hal) {
+    return (hal == &hal_platform) ? &s_platform : (pl_linux_Terminal *) hal;
+}
+
+static void pl_linux_restoreConsole(ad_Hal *hal);
+static void pl_linux_flush(ad_Hal *hal);
+
+// Makes sure the output buffer can take <length> more bytes
+static bool pl_linux_outReserve(pl_linux_Terminal *t, size_t length) {
+    size_t newCapacity = t->outCapacity ? t->outCapacity : PL_LINUX_OUT_INITIAL_SIZE;
+    char  *newOut;
+
+    if (t->outLength + length <= t->outCapacity) {
+        return true;
+    }
+
+    while (newCapacity < t->outLength + length) {
+        newCapacity *= 2;
+    }
+
+    newOut = realloc(t->out, newCapacity);
+
+    if (newOut == NULL) {
+        return false;
+    }
+
+    t->out = newOut;
+    t->outCapacity = newCapacity;
+    return true;
+}
+
+// Returns the number of write() calls it took
+static uint32_t pl_linux_writeAll(pl_linux_Terminal *t, const char *data, size_t length) {
+    uint32_t writes = 0;
+
+    while (length > 0) {
+        ssize_t written = write(t->outFd, data, length);
+
+        writes++;
+
+        if (written < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                struct pollfd pfd;
+                pfd.fd = t->outFd;
+                pfd.events = POLLOUT;
+                pfd.revents = 0;
+                poll(&pfd, 1, -1);
+            } else if (errno != EINTR) {
+                return writes;
+            }
+            continue;
+        }
+
+        data += written;
+        length -= (size_t) written;
+    }
+
+    return writes;
+}
+
+static void pl_linux_out(pl_linux_Terminal *t, const char *data, size_t length) {
+    if (!pl_linux_outReserve(t, length)) {
+        // Out of memory, get rid of what we have and send this directly. It's no frame, but it still counts.
+        pl_linux_flush(&t->hal);
+        t->outStats.totalWrites += pl_linux_writeAll(t, data, length);
+        t->outStats.totalBytes += (uint32_t) length;
+        return;
+    }
+
+    memcpy(&t->out[t->outLength], data, length);
+    t->outLength += length;
+}
+
+static void pl_linux_outString(pl_linux_Terminal *t, const char *str) {
+    pl_linux_out(t, str, strlen(str));
+}
+
+static void pl_linux_initConsole(ad_Hal *hal, ad_ConsoleConfig *cfg) {
+    pl_linux_Terminal *t = pl_linux_term(hal);
     struct winsize w;
 
-    cfg->width = 80;
-    cfg->height = 25;
+    cfg->width = t->fixedW ? t->fixedW : 80;
+    cfg->height = t->fixedH ? t->fixedH : 25;
 
-    tcgetattr(STDIN_FILENO, &s_originalTermios);
+    tcgetattr(t->inFd, &t->originalTermios);
 
-    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0) {
+    if (ioctl(t->outFd, TIOCGWINSZ, &w) == 0) {
         cfg->width = w.ws_col;
         cfg->height = w.ws_row;
     }
 
-    hal_restoreConsole();
+    t->consoleW = cfg->width;
+
+    pl_linux_restoreConsole(hal);
 }
 
-void hal_restoreConsole(void) {
+static void pl_linux_restoreConsole(ad_Hal *hal) {
+    pl_linux_Terminal *t = pl_linux_term(hal);
     struct termios term;
-    tcgetattr(STDIN_FILENO, &term);
+    tcgetattr(t->inFd, &term);
     term.c_lflag &= ~(ICANON | ECHO);
-    tcsetattr(STDIN_FILENO, TCSANOW, &term);
-    printf(PL_LINUX_CL_HID);
+    tcsetattr(t->inFd, TCSANOW, &term);
+    pl_linux_outString(t, PL_LINUX_CL_HID);
+    // Someone else may have used the terminal in the meantime
+    t->sgrValid = false;
+    t->cursorValid = false;
 }
 
-void hal_deinitConsole(void) {
-    tcsetattr(STDIN_FILENO, TCSANOW, &s_originalTermios);
-    printf(PL_LINUX_CL_SHW);
-    printf("\n");
+static void pl_linux_deinitConsole(ad_Hal *hal) {
+    pl_linux_Terminal *t = pl_linux_term(hal);
+    tcsetattr(t->inFd, TCSANOW, &t->originalTermios);
+    pl_linux_outString(t, PL_LINUX_CL_SHW);
+    pl_linux_outString(t, "\n");
+    pl_linux_flush(hal);
+    free(t->out);
+    t->out = NULL;
+    t->outLength = 0;
+    t->outCapacity = 0;
 }
 
-inline void hal_setColor(uint8_t bg, uint8_t fg) {
-    AD_UNUSED_PARAMETER(attributeLookup);
-    printf("\033[%u;%um\033[%u;%um", 0, colorLookup[bg] + 40, attributeLookup[fg], colorLookup[fg] + 30);
+// Sets colors and AD_ATTR_* flags
+static void pl_linux_setStyle(pl_linux_Terminal *t, uint8_t bg, uint8_t fg, uint8_t flags) {
+    uint8_t newBg   = colorLookup[bg & 0x0F] + 40;
+    uint8_t newFg   = colorLookup[fg & 0x0F] + 30;
+    uint8_t newAttr = (flags & AD_ATTR_BOLD) ? 1 : attributeLookup[fg & 0x0F];
+    uint8_t changed = flags;
+    char    seq[48];
+    char   *p       = seq;
+    size_t  i;
+
+    if (!t->sgrValid) {
+        // Unknown state, reset everything in one sequence
+        p += sprintf(p, "0;%u;%u;%u;", newAttr, newBg, newFg);
+    } else {
+        if (newAttr != t->sgrAttr)  p += sprintf(p, "%u;", newAttr);
+        if (newBg   != t->sgrBg)    p += sprintf(p, "%u;", newBg);
+        if (newFg   != t->sgrFg)    p += sprintf(p, "%u;", newFg);
+        changed ^= t->sgrFlags;
+    }
+
+    for (i = 0; i < AD_ARRAY_SIZE(flagLookup); i++) {
+        if (changed & flagLookup[i].flag) {
+            p += sprintf(p, "%u;", (flags & flagLookup[i].flag) ? flagLookup[i].on : flagLookup[i].off);
+        }
+    }
+
+    if (p == seq) {
+        return;
+    }
+
+    p[-1] = 'm'; // Replace trailing separator
+    pl_linux_out(t, "\033[", 2);
+    pl_linux_out(t, seq, (size_t) (p - seq));
+
+    t->sgrBg = newBg;
+    t->sgrFg = newFg;
+    t->sgrAttr = newAttr;
+    t->sgrFlags = flags;
+    t->sgrValid = true;
 }
 
-inline void hal_setCursorPosition(uint16_t x, uint16_t y) { 
-    printf("\033[%u;%uH", (y + 1), (x + 1));
+static void pl_linux_setColor(ad_Hal *hal, uint8_t bg, uint8_t fg) {
+    pl_linux_setStyle(pl_linux_term(hal), bg, fg, 0);
 }
 
-inline void hal_flush(void) { 
-    fflush(stdout); 
+// Appends a relative cursor movement ("\033[<n><dir>"), count 1 doesn't need the number
+static inline char *pl_linux_appendMove(char *p, uint16_t count, char dir) {
+    return (count == 1) ? p + sprintf(p, "\033[%c", dir) : p + sprintf(p, "\033[%u%c", count, dir);
 }
 
-inline void hal_putString(const char *str) {
-    fputs(str, stdout);
+// Picks the shortest of the given sequence candidates
+static inline void pl_linux_keepShortest(char *best, const char *candidate) {
+    if (strlen(candidate) < strlen(best)) {
+        strcpy(best, candidate);
+    }
 }
 
-inline void hal_putChar(char c, size_t count) {
-    while (count--) {
-        putchar(c);
+static void pl_linux_setCursorPosition(ad_Hal *hal, uint16_t x, uint16_t y) { 
+    pl_linux_Terminal *t = pl_linux_term(hal);
+    char best[32];
+    char candidate[32];
+    char *p;
+
+    if (t->cursorValid && x == t->cursorX && y == t->cursorY) {
+        return;
+    }
+
+    // Absolute position always works
+    if (x == 0 && y == 0) {
+        strcpy(best, "\033[H");
+    } else {
+        sprintf(best, "\033[%u;%uH", (y + 1), (x + 1));
+    }
+
+    if (t->cursorValid) {
+        p = candidate;
+
+        // Vertical part
+        if (x == 0 && y == t->cursorY + 1) {
+            // CR + LF is also fine if the terminal maps LF to CR LF
+            p += sprintf(p, "\r\n");
+        } else {
+            if (y > t->cursorY) p = pl_linux_appendMove(p, y - t->cursorY, 'B');
+            if (y < t->cursorY) p = pl_linux_appendMove(p, t->cursorY - y, 'A');
+
+            // Horizontal part
+            if (x == 0 && x != t->cursorX) {
+                p += sprintf(p, "\r");
+            } else if (x == t->cursorX - 1) {
+                p += sprintf(p, "\b");
+            } else if (x > t->cursorX) {
+                p = pl_linux_appendMove(p, x - t->cursorX, 'C');
+            } else if (x < t->cursorX) {
+                p = pl_linux_appendMove(p, t->cursorX - x, 'D');
+            }
+        }
+
+        pl_linux_keepShortest(best, candidate);
+
+        // Same row: Absolute column might still be shorter
+        if (y == t->cursorY) {
+            sprintf(candidate, "\033[%uG", (x + 1));
+            pl_linux_keepShortest(best, candidate);
+        }
     }
+
+    pl_linux_outString(t, best);
+
+    t->cursorX = x;
+    t->cursorY = y;
+    t->cursorValid = true;
+}
+
+// Cursor moves right after printing. At the end of the line it's up to the terminal what happens.
+static inline void pl_linux_advanceCursor(pl_linux_Terminal *t, size_t count) {
+    if ((size_t) t->cursorX + count >= t->consoleW) {
+        t->cursorValid = false;
+    } else {
+        t->cursorX += (uint16_t) count;
+    }
+}
+
+static void pl_linux_flush(ad_Hal *hal) { 
+    pl_linux_Terminal *t = pl_linux_term(hal);
+
+    if (t->outLength == 0) {
+        return;
+    }
+
+    t->outStats.lastFrameBytes = (uint32_t) t->outLength;
+    t->outStats.lastFrameWrites = pl_linux_writeAll(t, t->out, t->outLength);
+    t->outLength = 0;
+
+    t->outStats.frames++;
+    t->outStats.totalBytes += t->outStats.lastFrameBytes;
+    t->outStats.totalWrites += t->outStats.lastFrameWrites;
+}
+
+static void pl_linux_getOutputStats(ad_Hal *hal, ad_OutputStats *stats) {
+    *stats = pl_linux_term(hal)->outStats;
 }
 
-static inline bool keyAvailable(void) {
+static void pl_linux_putString(ad_Hal *hal, const char *str) {
+    pl_linux_Terminal *t = pl_linux_term(hal);
+    size_t length = strlen(str);
+    pl_linux_out(t, str, length);
+    pl_linux_advanceCursor(t, length);
+}
+
+static void pl_linux_putChar(ad_Hal *hal, char c, size_t count) {
+    pl_linux_Terminal *t = pl_linux_term(hal);
+    pl_linux_advanceCursor(t, count);
+
+    if (!pl_linux_outReserve(t, count)) {
+        while (count--) {
+            pl_linux_out(t, &c, 1);
+        }
+        return;
+    }
+
+    memset(&t->out[t->outLength], c, count);
+    t->outLength += count;
+}
+
+static void pl_linux_putSpan(ad_Hal *hal, const ad_Char *cells, size_t count) {
+    pl_linux_Terminal *t = pl_linux_term(hal);
+    size_t i;
+
+    // Worst case every cell needs a color change, reserve for the characters only
+    pl_linux_outReserve(t, count);
+
+    for (i = 0; i < count; i++) {
+        if (i == 0 || cells[i].color.bg != cells[i-1].color.bg || cells[i].color.fg != cells[i-1].color.fg || cells[i].attr != cells[i-1].attr) {
+            pl_linux_setStyle(t, cells[i].color.bg, cells[i].color.fg, cells[i].attr);
+        }
+
+        if (t->outLength < t->outCapacity) {
+            t->out[t->outLength++] = (char) cells[i].ascii;
+        } else {
+            pl_linux_out(t, (const char *) &cells[i].ascii, 1);
+        }
+    }
+
+    pl_linux_advanceCursor(t, count);
+}
+
+// Sets a scroll region and runs the cursor off its bottom (index) or top (reverse index)
+static bool pl_linux_scrollRows(ad_Hal *hal, uint16_t top, uint16_t bottom, int lines) {
+    pl_linux_Terminal *t = pl_linux_term(hal);
+    char seq[32];
+    int  i;
+
+    sprintf(seq, "\033[%u;%ur", top + 1, bottom);
+    pl_linux_outString(t, seq);
+
+    if (lines > 0) {
+        sprintf(seq, "\033[%u;1H", bottom);
+        pl_linux_outString(t, seq);
+        for (i = 0; i < lines; i++) pl_linux_out(t, "\033D", 2);
+    } else {
+        sprintf(seq, "\033[%u;1H", top + 1);
+        pl_linux_outString(t, seq);
+        for (i = 0; i < -lines; i++) pl_linux_out(t, "\033M", 2);
+    }
+
+    // Back to the full screen, this also homes the cursor
+    pl_linux_outString(t, "\033[r");
+    t->cursorValid = false;
+    return true;
+}
+
+static bool pl_linux_canScrollRows(ad_Hal *hal) {
+    AD_UNUSED_PARAMETER(hal);
+    return true;
+}
+
+static inline bool keyAvailable(pl_linux_Terminal *t) {
     struct pollfd pfd;
 
-    pfd.fd = STDIN_FILENO;
+    pfd.fd = t->inFd;
     pfd.events = POLLIN;
     pfd.revents = 0;
 
     return poll(&pfd, 1, 0) > 0;
 }
 
-static inline uint32_t getChar(void) {
+static inline uint32_t getChar(pl_linux_Terminal *t) {
     uint8_t ch = 0;
-    while (read(STDIN_FILENO, &ch, 1) != 1) {
+    while (read(t->inFd, &ch, 1) != 1) {
         sched_yield();
     }
     return ch;
@@ -135,39 +468,42 @@ static inline uint32_t getChar(void) {
 
 // Shifts ch to the left by 8 bits and puts a new scancode in the lowest 8 bits
 // Can be called with NULL to just consume a scancode if available
-static inline void pushBackCharIfAvailable(uint32_t *ch) {
-    if (keyAvailable()) {
-        uint8_t new = getChar();
+static inline void pushBackCharIfAvailable(pl_linux_Terminal *t, uint32_t *ch) {
+    if (keyAvailable(t)) {
+        uint8_t new = getChar(t);
         if (ch != NULL) {
             *ch = (*ch << 8) | new;
         }
     }
 }
 
-uint32_t hal_getKey(void) {
-    uint32_t ch = getChar();
+static uint32_t pl_linux_getKey(ad_Hal *hal) {
+    pl_linux_Terminal *t = pl_linux_term(hal);
+    uint32_t ch = getChar(t);
 
     if (ch == PL_LINUX_KEY_ESCAPE2) {
-        pushBackCharIfAvailable(&ch);
+        pushBackCharIfAvailable(t, &ch);
 
         // We are in an escape sequence, can be cursor, pgupdown, maybe f5-f12
         if (ch == PL_LINUX_CH_SEQSTART) {
-            pushBackCharIfAvailable(&ch);
+            pushBackCharIfAvailable(t, &ch);
 
             uint8_t last = (ch & 0xff);
 
-            if (last == 0x35 || last == 0x36) {
-                /* Special case for PGUp and Down, they have another 7e keycode at the end... */
-                pushBackCharIfAvailable(NULL);
+            if (last == 0x34 || last == 0x35 || last == 0x36) {
+                /* Special case for PGUp and Down (and VT End), they have another 7e keycode at the end... */
+                pushBackCharIfAvailable(t, NULL);
             } else if (last == 0x31 || last == 0x32) {
-                /* F5 - F12, get last character + extra 7e at the end*/
-                pushBackCharIfAvailable(&ch);
-                pushBackCharIfAvailable(NULL);
+                /* F5 - F12, get last character + extra 7e at the end. VT Home is just 1 and the 7e. */
+                pushBackCharIfAvailable(t, &ch);
+                if ((ch & 0xff) != 0x7e) {
+                    pushBackCharIfAvailable(t, NULL);
+                }
             }
 
         } else if (ch == PL_LINUX_F1234_SEQSTART) {
             // This is F1 to F4 potentially
-            pushBackCharIfAvailable(&ch);
+            pushBackCharIfAvailable(t, &ch);
         }
     }
 
@@ -177,6 +513,12 @@ uint32_t hal_getKey(void) {
         case PL_LINUX_KEY_ENTER:    return AD_KEY_ENTER;
         case PL_LINUX_PAGE_U:       return AD_KEY_PGUP;
         case PL_LINUX_PAGE_D:       return AD_KEY_PGDN;
+        case PL_LINUX_HOME:         return AD_KEY_HOME;
+        case PL_LINUX_HOME_SS3:     return AD_KEY_HOME;
+        case PL_LINUX_HOME_VT:      return AD_KEY_HOME;
+        case PL_LINUX_END:          return AD_KEY_END;
+        case PL_LINUX_END_SS3:      return AD_KEY_END;
+        case PL_LINUX_END_VT:       return AD_KEY_END;
         case PL_LINUX_CURSOR_U:     return AD_KEY_UP;
         case PL_LINUX_CURSOR_D:     return AD_KEY_DOWN;
         case PL_LINUX_CURSOR_L:     return AD_KEY_LEFT;
@@ -197,3 +539,54 @@ uint32_t hal_getKey(void) {
         default: return ch;
     }
 }
+
+static bool pl_linux_waitForKey(ad_Hal *hal, uint32_t milliseconds) {
+    struct pollfd pfd;
+
+    pfd.fd = pl_linux_term(hal)->inFd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    return poll(&pfd, 1, (int) milliseconds) > 0;
+}
+
+static void pl_linux_destroy(ad_Hal *hal) {
+    free(pl_linux_term(hal)->out);
+    free(hal);
+}
+
+ad_Hal hal_platform = {
+    pl_linux_initConsole,
+    pl_linux_restoreConsole,
+    pl_linux_deinitConsole,
+    pl_linux_setColor,
+    pl_linux_setCursorPosition,
+    pl_linux_flush,
+    pl_linux_getOutputStats,
+    pl_linux_putString,
+    pl_linux_putChar,
+    pl_linux_putSpan,
+    pl_linux_scrollRows,
+    pl_linux_canScrollRows,
+    pl_linux_getKey,
+    pl_linux_waitForKey,
+    NULL
+};
+
+ad_Hal *ad_halTerminalCreate(int inFd, int outFd) {
+    pl_linux_Terminal *ret = calloc(1, sizeof(pl_linux_Terminal));
+    AD_RETURN_ON_NULL(ret, NULL);
+
+    ret->hal            = hal_platform;
+    ret->hal.destroy    = pl_linux_destroy;
+    ret->inFd           = inFd;
+    ret->outFd          = outFd;
+
+    return &ret->hal;
+}
+
+void ad_halTerminalSetSize(ad_Hal *hal, uint16_t width, uint16_t height) {
+    pl_linux_Terminal *t = pl_linux_term(hal);
+    t->fixedW = width;
+    t->fixedH = height;
+}
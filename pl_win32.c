@@ -27,8 +27,11 @@ static void pl_win32_showCursor(bool show) {
     SetConsoleCursorInfo(pl_win32_consoleHandle, &pl_win32_cursorInfo);
 }
 
-void hal_initConsole(ad_ConsoleConfig *cfg) {
+static void pl_win32_restoreConsole(ad_Hal *hal);
+
+static void pl_win32_initConsole(ad_Hal *hal, ad_ConsoleConfig *cfg) {
     CONSOLE_SCREEN_BUFFER_INFO screenInfo;
+    AD_UNUSED_PARAMETER(hal);
 
     pl_win32_consoleHandle = GetStdHandle(STD_OUTPUT_HANDLE);
 
@@ -42,47 +45,107 @@ void hal_initConsole(ad_ConsoleConfig *cfg) {
 
     GetConsoleMode(pl_win32_consoleHandle, &pl_win32_oldConsoleMode);
 
-    hal_restoreConsole();
+    pl_win32_restoreConsole(hal);
 }
 
-void hal_restoreConsole(void) {
+static void pl_win32_restoreConsole(ad_Hal *hal) {
     DWORD newConsoleMode = pl_win32_oldConsoleMode & ~ENABLE_ECHO_INPUT & ~ENABLE_LINE_INPUT & ~ENABLE_VIRTUAL_TERMINAL_INPUT & ~ENABLE_WRAP_AT_EOL_OUTPUT;
+    AD_UNUSED_PARAMETER(hal);
     SetConsoleMode(pl_win32_consoleHandle, newConsoleMode);
     pl_win32_showCursor(false);
 }
 
-void hal_deinitConsole() {
+static void pl_win32_deinitConsole(ad_Hal *hal) {
+    AD_UNUSED_PARAMETER(hal);
     SetConsoleMode(pl_win32_consoleHandle, pl_win32_oldConsoleMode);
     pl_win32_showCursor(true);
 }
 
-inline void hal_setColor(uint8_t bg, uint8_t fg) {
+static void pl_win32_setColor(ad_Hal *hal, uint8_t bg, uint8_t fg) {
+    AD_UNUSED_PARAMETER(hal);
     SetConsoleTextAttribute(pl_win32_consoleHandle, ((bg & 0x07) << 4) | (fg & 0x0F));
 }
 
-inline void hal_setCursorPosition(uint16_t x, uint16_t y) { 
+static void pl_win32_setCursorPosition(ad_Hal *hal, uint16_t x, uint16_t y) { 
     COORD pos;
+    AD_UNUSED_PARAMETER(hal);
     pos.X = x;
     pos.Y = y;
     SetConsoleCursorPosition(pl_win32_consoleHandle, pos);
 }
 
-inline void hal_flush(void) {
+static void pl_win32_flush(ad_Hal *hal) {
+    AD_UNUSED_PARAMETER(hal);
     fflush(stdout); 
 }
 
-inline void hal_putString(const char *str) {
+static void pl_win32_getOutputStats(ad_Hal *hal, ad_OutputStats *stats) {
+    AD_UNUSED_PARAMETER(hal);
+    /* Not tracked here */
+    memset(stats, 0, sizeof(ad_OutputStats));
+}
+
+static void pl_win32_putString(ad_Hal *hal, const char *str) {
+    AD_UNUSED_PARAMETER(hal);
     fputs(str, stdout);
 }
 
-inline void hal_putChar(char c, size_t count) {
+static void pl_win32_putChar(ad_Hal *hal, char c, size_t count) {
+    AD_UNUSED_PARAMETER(hal);
     while (count--) {
         putchar(c);
     }
 }
 
-uint32_t hal_getKey(void) {
+static void pl_win32_putSpan(ad_Hal *hal, const ad_Char *cells, size_t count) {
+    char    run[256];
+    size_t  runLength = 0;
+    size_t  i;
+    AD_UNUSED_PARAMETER(hal);
+
+    /* Console attributes can only be set between writes, so write runs of the same color */
+    for (i = 0; i < count; i++) {
+        if (i == 0 || cells[i].color.bg != cells[i-1].color.bg || cells[i].color.fg != cells[i-1].color.fg || cells[i].attr != cells[i-1].attr || runLength == sizeof(run)) {
+            fwrite(run, 1, runLength, stdout);
+            fflush(stdout);
+            runLength = 0;
+            pl_win32_setColor(hal, ad_cellShownBg(&cells[i]), ad_cellShownFg(&cells[i]));
+        }
+        run[runLength++] = (char) cells[i].ascii;
+    }
+
+    fwrite(run, 1, runLength, stdout);
+}
+
+static bool pl_win32_scrollRows(ad_Hal *hal, uint16_t top, uint16_t bottom, int lines) {
+    SMALL_RECT  region;
+    COORD       destination;
+    CHAR_INFO   fill;
+    AD_UNUSED_PARAMETER(hal);
+
+    /* Everything written so far has to be on the console before it gets moved */
+    fflush(stdout);
+
+    region.Left         = 0;
+    region.Right        = pl_win32_consoleSize.X - 1;
+    region.Top          = top;
+    region.Bottom       = bottom - 1;
+    destination.X       = 0;
+    destination.Y       = (SHORT) (top - lines);
+    fill.Char.AsciiChar = ' ';
+    fill.Attributes     = 0;
+
+    return ScrollConsoleScreenBuffer(pl_win32_consoleHandle, &region, &region, destination, &fill) != 0;
+}
+
+static bool pl_win32_canScrollRows(ad_Hal *hal) {
+    AD_UNUSED_PARAMETER(hal);
+    return true;
+}
+
+static uint32_t pl_win32_getKey(ad_Hal *hal) {
     uint32_t c = (uint32_t) getch();
+    AD_UNUSED_PARAMETER(hal);
 
     /* Extended function */
     if (c == 0 || c == 0xe0) { c = ((uint32_t) getch()) << 16L; }
@@ -92,6 +155,8 @@ uint32_t hal_getKey(void) {
         case 0x0000000d: return AD_KEY_ENTER;
         case 0x00490000: return AD_KEY_PGUP;
         case 0x00510000: return AD_KEY_PGDN;
+        case 0x00470000: return AD_KEY_HOME;
+        case 0x004F0000: return AD_KEY_END;
         case 0x00480000: return AD_KEY_UP;
         case 0x00500000: return AD_KEY_DOWN;
         case 0x004B0000: return AD_KEY_LEFT;
@@ -100,3 +165,35 @@ uint32_t hal_getKey(void) {
         default: return c;
     }    
 }
+
+static bool pl_win32_waitForKey(ad_Hal *hal, uint32_t milliseconds) {
+    DWORD start = GetTickCount();
+    AD_UNUSED_PARAMETER(hal);
+
+    while (!kbhit()) {
+        if (GetTickCount() - start >= milliseconds) {
+            return false;
+        }
+        Sleep(10);
+    }
+
+    return true;
+}
+
+ad_Hal hal_platform = {
+    pl_win32_initConsole,
+    pl_win32_restoreConsole,
+    pl_win32_deinitConsole,
+    pl_win32_setColor,
+    pl_win32_setCursorPosition,
+    pl_win32_flush,
+    pl_win32_getOutputStats,
+    pl_win32_putString,
+    pl_win32_putChar,
+    pl_win32_putSpan,
+    pl_win32_scrollRows,
+    pl_win32_canScrollRows,
+    pl_win32_getKey,
+    pl_win32_waitForKey,
+    NULL
+};